@@ -17,6 +17,7 @@ class Top extends Module {
   val cpu = Module(new CPU)
   cpu.io.debug_read_address := io.debug_read_address
   io.debug_read_data        := cpu.io.debug_read_data
+  io.retire                 := cpu.io.retire
 
   // Device selection for potential peripheral access
   io.deviceSelect := cpu.io.deviceSelect
@@ -15,4 +15,7 @@ class CPUBundle extends Bundle {
   val deviceSelect        = Output(UInt(Parameters.SlaveDeviceCountBits.W))
   val debug_read_address  = Input(UInt(Parameters.PhysicalRegisterAddrWidth))
   val debug_read_data     = Output(UInt(Parameters.DataWidth))
+
+  // One record per retired instruction, for commit logs and lockstep checking
+  val retire = new RetirementBundle
 }
@@ -99,4 +99,19 @@ class CPU extends Module {
   wb.io.alu_result          := ex.io.mem_alu_result
   wb.io.memory_read_data    := mem.io.wb_memory_read_data
   wb.io.regs_write_source   := id.io.wb_reg_write_source
+
+  // Retirement port: the instruction retires in the cycle it executes
+  val retire_rd = Mux(id.io.reg_write_enable, id.io.reg_write_address, 0.U)
+  io.retire.valid               := io.instruction_valid
+  io.retire.pc                  := inst_fetch.io.instruction_address
+  io.retire.instruction         := inst_fetch.io.instruction
+  io.retire.rd_address          := retire_rd
+  io.retire.rd_data             := Mux(retire_rd =/= 0.U, wb.io.regs_write_data, 0.U)
+  io.retire.memory_address      := mem.io.memory_bundle.address
+  io.retire.memory_read         := id.io.memory_read_enable
+  io.retire.memory_read_data    := io.memory_bundle.read_data
+  io.retire.memory_write_strobe := Mux(mem.io.memory_bundle.write_enable, mem.io.memory_bundle.write_strobe.asUInt, 0.U)
+  io.retire.memory_write_data   := mem.io.memory_bundle.write_data
+  io.retire.trap                := false.B
+  io.retire.interrupt           := false.B
 }
@@ -1,5 +1,7 @@
 #include <verilated.h>
+#if VM_TRACE
 #include <verilated_vcd_c.h>
+#endif
 
 #include <algorithm>
 #include <fstream>
@@ -8,15 +10,26 @@
 #include <string>
 #include <vector>
 
+#include "../../../common/verilator/rv32_commit_log.h"
+#include "../../../common/verilator/rv32_mem_trace.h"
+#include "../../../common/verilator/rv32_probe.h"
+#include "../../../common/verilator/rv32_profile.h"
+#include "../../../common/verilator/rv32_shared_memory.h"
 #include "VTop.h"  // From Verilating "top.v"
 
 
 class Memory
 {
-    std::vector<uint32_t> memory;
+    rv32::SharedMemory memory;
 
 public:
-    Memory(size_t size) : memory(size, 0) {}
+    Memory(size_t size, std::string const &shm_name = "")
+        : memory(size, shm_name)
+    {
+    }
+
+    rv32::SharedMemory &storage() { return memory; }
+
     uint32_t read(size_t address)
     {
         address = address / 4;
@@ -82,6 +95,7 @@ public:
     }
 };
 
+#if VM_TRACE
 class VCDTracer
 {
     VerilatedVcdC *tfp = nullptr;
@@ -116,6 +130,20 @@ public:
         }
     }
 };
+#else
+// Model built without --trace (e.g. benchmark builds): nothing to dump
+class VCDTracer
+{
+public:
+    void enable(std::string const &filename, VTop &)
+    {
+        throw std::runtime_error("Cannot write " + filename +
+                                 ": model was built without --trace");
+    }
+
+    void dump(vluint64_t) {}
+};
+#endif
 
 uint32_t parse_number(std::string const &str)
 {
@@ -128,6 +156,39 @@ uint32_t parse_number(std::string const &str)
     return std::stoul(str);
 }
 
+// Top-level ports -probe can sample
+rv32::ProbePorts probe_ports(VTop const &top)
+{
+    rv32::ProbePorts ports;
+#define PROBE(port) ports.add(#port, &top.port)
+    PROBE(io_instruction_address);
+    PROBE(io_instruction);
+    PROBE(io_instruction_valid);
+    PROBE(io_memory_bundle_address);
+    PROBE(io_memory_bundle_read_data);
+    PROBE(io_memory_bundle_write_data);
+    PROBE(io_memory_bundle_write_enable);
+    PROBE(io_memory_bundle_write_strobe_0);
+    PROBE(io_memory_bundle_write_strobe_1);
+    PROBE(io_memory_bundle_write_strobe_2);
+    PROBE(io_memory_bundle_write_strobe_3);
+    PROBE(io_deviceSelect);
+    PROBE(io_retire_valid);
+    PROBE(io_retire_pc);
+    PROBE(io_retire_instruction);
+    PROBE(io_retire_rd_address);
+    PROBE(io_retire_rd_data);
+    PROBE(io_retire_memory_address);
+    PROBE(io_retire_memory_read);
+    PROBE(io_retire_memory_read_data);
+    PROBE(io_retire_memory_write_data);
+    PROBE(io_retire_memory_write_strobe);
+    PROBE(io_retire_trap);
+    PROBE(io_retire_interrupt);
+#undef PROBE
+    return ports;
+}
+
 class Simulator
 {
     vluint64_t main_time = 0;
@@ -138,10 +199,23 @@ class Simulator
     std::unique_ptr<VTop> top;
     std::unique_ptr<VCDTracer> vcd_tracer;
     std::unique_ptr<Memory> memory;
+    std::string shm_name;
+    rv32::SharedMemory *shared_memory = nullptr;
     bool dump_signature = false;
     unsigned long signature_begin, signature_end;
     std::string signature_filename;
     std::string instruction_filename;
+    std::string commit_log_filename;
+    std::unique_ptr<rv32::CommitLogWriter> commit_log;
+    std::string profile_filename;
+    std::string elf_filename;
+    std::unique_ptr<rv32::Profiler> profiler;
+    std::string mem_trace_filename;
+    std::unique_ptr<rv32::MemTraceWriter> mem_trace;
+    std::string probe_filename;
+    std::string probe_signals = "*";
+    uint64_t probe_interval = 1;
+    std::unique_ptr<rv32::ProbeWriter> probes;
 
 public:
     void parse_args(std::vector<std::string> const &args)
@@ -178,6 +252,61 @@ public:
         if (it != args.end()) {
             instruction_filename = *(it + 1);
         }
+
+        // Guest memory in /dev/shm/NAME (or a memfd for memfd:NAME) that
+        // tools map while the core runs (scripts/guestmem.py)
+        it = std::find(args.begin(), args.end(), "-shm");
+        if (it != args.end()) {
+            shm_name = *(it + 1);
+        }
+
+        // Binary log of every retired instruction (scripts/commitlog.py)
+        it = std::find(args.begin(), args.end(), "-commit-log");
+        if (it != args.end()) {
+            commit_log_filename = *(it + 1);
+            commit_log =
+                std::make_unique<rv32::CommitLogWriter>(commit_log_filename);
+        }
+
+        // Cycles per PC, function and call path; -elf names them
+        it = std::find(args.begin(), args.end(), "-profile");
+        if (it != args.end()) {
+            profile_filename = *(it + 1);
+            profiler = std::make_unique<rv32::Profiler>();
+        }
+
+        it = std::find(args.begin(), args.end(), "-elf");
+        if (it != args.end()) {
+            elf_filename = *(it + 1);
+        }
+
+        // Fetch and data access stream for tools/cachesim
+        it = std::find(args.begin(), args.end(), "-mem-trace");
+        if (it != args.end()) {
+            mem_trace_filename = *(it + 1);
+            mem_trace =
+                std::make_unique<rv32::MemTraceWriter>(mem_trace_filename);
+        }
+
+        // Columns of port values (scripts/probes.py); -probe-signals takes
+        // comma-separated names or patterns such as io_memory_bundle_*
+        it = std::find(args.begin(), args.end(), "-probe-signals");
+        if (it != args.end()) {
+            probe_signals = *(it + 1);
+        }
+
+        it = std::find(args.begin(), args.end(), "-probe-interval");
+        if (it != args.end()) {
+            probe_interval = std::stoull(*(it + 1));
+        }
+
+        it = std::find(args.begin(), args.end(), "-probe");
+        if (it != args.end()) {
+            probe_filename = *(it + 1);
+            probes = std::make_unique<rv32::ProbeWriter>(
+                probe_filename, probe_ports(*top).select(probe_signals),
+                probe_interval);
+        }
     }
 
     Simulator(std::vector<std::string> const &args)
@@ -185,7 +314,12 @@ public:
           vcd_tracer(std::make_unique<VCDTracer>())
     {
         parse_args(args);
-        memory = std::make_unique<Memory>(memory_words);
+        memory = std::make_unique<Memory>(memory_words, shm_name);
+        if (memory->storage().shared()) {
+            shared_memory = &memory->storage();
+            std::cerr << "Guest memory shared at " << shared_memory->path()
+                      << std::endl;
+        }
         if (!instruction_filename.empty()) {
             memory->load_binary(instruction_filename);
         }
@@ -203,12 +337,18 @@ public:
         uint32_t counter = 0;
         uint32_t clocktime = 1;
         bool memory_write_strobe[4] = {false};
+        uint64_t cycle = 0;
         int uart_write_time_counter = 0,
             uart_write_time_limit =
                 4;  // every limit, an UART write completes; this is tricky part
+        if (shared_memory) {
+            shared_memory->set_status(rv32::SHM_RUNNING);
+        }
+        bool halted = false;
         while (main_time < max_sim_time && !Verilated::gotFinish()) {
             ++main_time;
             ++counter;
+            bool clock_before = top->clock;
             if (counter > clocktime) {
                 top->clock = !top->clock;
                 counter = 0;
@@ -220,6 +360,26 @@ public:
             top->io_memory_bundle_read_data = data_memory_read_word;
             top->io_instruction = inst_memory_read_word;
             top->clock = !top->clock;
+            // The instruction retires on the rising edge: log it while its
+            // results are still on the retirement port
+            if (!clock_before && top->clock && !top->reset) {
+                if (commit_log) {
+                    commit_log->sample(cycle, *top);
+                }
+                if (profiler) {
+                    profiler->sample(cycle, *top);
+                }
+                if (mem_trace) {
+                    mem_trace->sample(cycle, *top);
+                }
+                if (probes) {
+                    probes->sample(cycle);
+                }
+                if (shared_memory) {
+                    shared_memory->sample(cycle, *top);
+                }
+                ++cycle;
+            }
             top->eval();
 
             if (top->io_deviceSelect == 2 &&
@@ -249,18 +409,59 @@ public:
             vcd_tracer->dump(main_time);
             if (halt_address) {
                 if (memory->read(halt_address) == 0xBABECAFE) {
+                    halted = true;
                     break;
                 }
             }
 
             // print simulation progress in percentage every 10%
-            if (main_time % (max_sim_time / 10) == 0 && main_time > 0) {
+            if (main_time % std::max<vluint64_t>(1, max_sim_time / 10) == 0 &&
+                main_time > 0) {
                 std::cerr << "Simulation progress: "
                           << (main_time * 100 / max_sim_time) << "%"
                           << std::endl;
             }
         }
 
+        if (shared_memory) {
+            shared_memory->set_status(halted ? rv32::SHM_HALTED
+                                             : rv32::SHM_EXITED);
+        }
+
+        if (commit_log) {
+            commit_log->finish();
+            std::cout << "Commit log: " << commit_log->written()
+                      << " instructions written to " << commit_log_filename
+                      << std::endl;
+        }
+
+        if (mem_trace) {
+            mem_trace->finish();
+            std::cout << "Memory trace: " << mem_trace->instructions()
+                      << " fetches, " << mem_trace->accesses()
+                      << " data accesses written to " << mem_trace_filename
+                      << std::endl;
+        }
+
+        if (probes) {
+            probes->finish();
+            std::cout << "Probes: " << probes->rows() << " samples of "
+                      << probes->signals() << " signals written to "
+                      << probe_filename << std::endl;
+        }
+
+        if (profiler) {
+            std::unique_ptr<rv32::ElfSymbols> elf;
+            if (!elf_filename.empty()) {
+                elf = std::make_unique<rv32::ElfSymbols>(elf_filename);
+            }
+            profiler->write(profile_filename, elf.get());
+            std::cout << "Profile: " << profiler->cycles() << " cycles, "
+                      << profiler->instructions()
+                      << " instructions written to " << profile_filename
+                      << std::endl;
+        }
+
         if (dump_signature) {
             char data[9] = {0};
             std::ofstream signature_file(signature_filename);
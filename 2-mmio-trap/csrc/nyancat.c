@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MIT
 // Nyancat animation program for VGA peripheral
-// Uses delta-RLE compression for superior compression ratio
+// Uses delta-RLE compression for superior compression ratio, and flips
+// double-buffered frames in the VGA vblank interrupt
 
 #include <stdint.h>
 
@@ -36,17 +37,53 @@ void *memcpy(void *dest, const void *src, size_t n) {
 #define VGA_ID (VGA_BASE + 0x00)
 #define VGA_CTRL (VGA_BASE + 0x04)
 #define VGA_STATUS (VGA_BASE + 0x08)
+#define VGA_INTR_STATUS (VGA_BASE + 0x0C)
 #define VGA_UPLOAD_ADDR (VGA_BASE + 0x10)
 #define VGA_STREAM_DATA (VGA_BASE + 0x14)
+#define VGA_DMA_SRC (VGA_BASE + 0x18)
+#define VGA_DMA_CTRL (VGA_BASE + 0x1C)
 #define VGA_PALETTE(n) (VGA_BASE + 0x20 + ((n) << 2))
+#define VGA_BLIT (VGA_BASE + 0x60)
 
 // Animation constants
 #define FRAME_SIZE 4096    // 64×64 pixels
 #define FRAME_COUNT 12     // Total animation frames
 #define PIXELS_PER_WORD 8  // 8 4-bit pixels per 32-bit word
+#define WORDS_PER_FRAME (FRAME_SIZE / PIXELS_PER_WORD)
 #define PALETTE_SIZE 14    // Nyancat color count
 #define PALETTE_MAX 16     // VGA palette entries
 
+// VGA_CTRL and VGA_INTR_STATUS bits
+#define VGA_CTRL_EN 0x01          // Display enable
+#define VGA_CTRL_VBLANK_IE 0x100  // Vblank interrupt enable
+#define VGA_INTR_VBLANK 0x01      // Vblank interrupt pending (W1C)
+
+// Machine CSR bits for the vblank interrupt
+#define MSTATUS_MIE (1u << 3)
+#define MIE_MEIE (1u << 11)
+
+// Animation frame every VBLANKS_PER_FRAME vblanks
+#ifndef VBLANKS_PER_FRAME
+#define VBLANKS_PER_FRAME 1
+#endif
+
+// VGA_STATUS bits
+#define VGA_STATUS_DMA_BUSY 0x04   // DMA transfer in progress
+#define VGA_STATUS_BLIT_BUSY 0x08  // Blitter commands pending
+#define VGA_STATUS_BLIT_FULL 0x10  // Blitter queue full
+
+// Blitter commands; FILL and SKIP start at VGA_UPLOAD_ADDR and advance it
+#define BLIT_FILL(color, n) (((uint32_t) (n) << 4) | ((color) & 0xF))
+#define BLIT_SKIP(n) ((1u << 30) | ((uint32_t) (n) << 4))
+#define BLIT_COPY_FRAME(src, dst) \
+    ((2u << 30) | (63u << 20) | (7u << 11) | ((dst) << 4) | (src))
+
+// Decode opcodes into blitter commands (1), or into pixels in software that
+// the DMA engine then uploads (0)
+#ifndef NYANCAT_BLIT
+#define NYANCAT_BLIT 1
+#endif
+
 // Opcode format constants
 #define OPCODE_MASK 0xF0   // Extract opcode type
 #define PARAM_MASK 0x0F    // Extract opcode parameter
@@ -118,12 +155,166 @@ void vga_init_palette(void)
     }
 }
 
+// Wait until every frame upload has reached the framebuffer
+static inline void vga_upload_wait(void)
+{
+    while (vga_read32(VGA_STATUS) &
+           (VGA_STATUS_DMA_BUSY | VGA_STATUS_BLIT_BUSY))
+        ;
+}
+
+static inline void vga_blit(uint32_t command)
+{
+    while (vga_read32(VGA_STATUS) & VGA_STATUS_BLIT_FULL)
+        ;
+    vga_write32(VGA_BLIT, command);
+}
+
+#if NYANCAT_COMPRESSION_WORD
+
+// Word commands (gen-nyancat-data.py --word), in 8-pixel words
+#define WORD_SKIP 0            // Keep [12:0] words of the copied frame
+#define WORD_FILL 1            // [12:0] words of color [19:16]
+#define WORD_RUN 2             // The next word, [12:0] times
+#define WORD_COPY 0x20000000u  // Start from a copy of the previous frame
+#define WORD_COUNT_MASK 0x1FFF
+
+// Stream a frame of pre-packed words straight to the VGA: runs of one color
+// and skips become single blitter commands, other words go to STREAM_DATA
+// as they are, so nothing is unpacked or repacked on the CPU. The previous
+// frame is in the other slot.
+void vga_upload_frame_words(int frame_index, uint32_t slot)
+{
+    const uint32_t *p = &nyancat_word_data[nyancat_frame_offsets[frame_index]];
+
+    vga_write32(VGA_UPLOAD_ADDR, slot << 16);
+    if (*p == WORD_COPY) {
+        // STREAM_DATA stores take the framebuffer port ahead of the
+        // blitter, so the copy has to land before they overwrite it
+        p++;
+        vga_blit(BLIT_COPY_FRAME(slot ^ 1, slot));
+        vga_upload_wait();
+    }
+
+    for (uint32_t command; (command = *p++) != 0;) {
+        uint32_t count = command & WORD_COUNT_MASK;
+        switch (command >> 30) {
+        case WORD_SKIP:
+            vga_blit(BLIT_SKIP(count * PIXELS_PER_WORD));
+            break;
+        case WORD_FILL:
+            vga_blit(BLIT_FILL(command >> 16, count * PIXELS_PER_WORD));
+            break;
+        case WORD_RUN:
+            for (uint32_t word = *p++; count--;)
+                vga_write32(VGA_STREAM_DATA, word);
+            break;
+        default:  // Literal words
+            while (count--)
+                vga_write32(VGA_STREAM_DATA, *p++);
+            break;
+        }
+    }
+}
+
+#elif NYANCAT_BLIT
+
+// Upload compressed data size (defined in header)
+extern const uint8_t nyancat_compressed_data[];
+
+// Decode a frame straight into blitter commands: SetColor stays in a
+// register, Repeat becomes FILL and Skip becomes SKIP, and a delta frame
+// starts as a COPY of the previous one in the other slot, so no pixel passes
+// through the CPU. Opcodes as in vga_upload_frame_delta and
+// vga_upload_frame_rle below.
+void vga_blit_frame(int frame_index, uint32_t slot)
+{
+    vga_write32(VGA_UPLOAD_ADDR, slot << 16);
+
+    uint16_t offset = nyancat_frame_offsets[frame_index];
+    uint16_t next_offset = (frame_index < FRAME_COUNT - 1)
+                               ? nyancat_frame_offsets[frame_index + 1]
+                               : sizeof(nyancat_compressed_data);
+    const uint8_t *p = &nyancat_compressed_data[offset];
+    const uint8_t *data_end = &nyancat_compressed_data[next_offset];
+    int delta = NYANCAT_COMPRESSION_DELTA && frame_index > 0;
+
+    if (delta)
+        vga_blit(BLIT_COPY_FRAME(slot ^ 1, slot));
+
+    int pos = 0;
+    uint8_t current_color = 0;
+    while (pos < FRAME_SIZE && p < data_end) {
+        uint8_t opcode = *p++;
+        if (opcode == END_OF_FRAME)
+            break;
+        int op = opcode & OPCODE_MASK;
+        int count = (opcode & PARAM_MASK) + 1;
+        int fill = 1;
+        if (op == OP_SET_COLOR) {
+            current_color = opcode & PARAM_MASK;
+            continue;
+        } else if (op == OP_REPEAT_1) {
+        } else if (op == OP_REPEAT_16 && !delta) {
+            count *= 16;
+        } else if (op == OP_SKIP_1 && delta) {
+            fill = 0;
+        } else if (op == OP_SKIP_16 && delta) {
+            count *= 16;
+            fill = 0;
+        } else if (op == OP_REPEAT_16_DELTA && delta) {
+            count *= 16;
+        } else if (op == OP_SKIP_64 && delta) {
+            count *= 64;
+            fill = 0;
+        } else {
+            continue;
+        }
+        if (count > FRAME_SIZE - pos)
+            count = FRAME_SIZE - pos;
+        pos += count;
+        if (fill)
+            vga_blit(BLIT_FILL(current_color, count));
+        else
+            vga_blit(BLIT_SKIP(count));
+    }
+
+    // Fill remaining with background if a baseline frame is incomplete
+    if (!delta && pos < FRAME_SIZE)
+        vga_blit(BLIT_FILL(0, FRAME_SIZE - pos));
+}
+
+#else
+
+// Upload compressed data size (defined in header)
+extern const uint8_t nyancat_compressed_data[];
+
 // Frame buffers for delta decompression
 static uint8_t frame_buffer[FRAME_SIZE];       // Current frame buffer
 static uint8_t prev_frame_buffer[FRAME_SIZE];  // Previous frame for delta
 
-// Upload compressed data size (defined in header)
-extern const uint8_t nyancat_compressed_data[];
+// Packed frame for the VGA DMA engine
+static uint32_t dma_buffer[WORDS_PER_FRAME];
+
+static inline void vga_dma_wait(void)
+{
+    while (vga_read32(VGA_STATUS) & VGA_STATUS_DMA_BUSY)
+        ;
+}
+
+// Pack a decoded frame and let the DMA engine copy it into the framebuffer,
+// instead of 512 STREAM_DATA stores
+static void vga_upload_packed(uint32_t slot, const uint8_t *pixels)
+{
+    uint32_t *words = dma_buffer;
+    for (int i = 0; i < WORDS_PER_FRAME; i++)
+        words[i] = pack8_pixels(&pixels[i * PIXELS_PER_WORD]);
+
+    vga_dma_wait();
+    vga_write32(VGA_DMA_SRC, (uint32_t) words);
+    vga_write32(VGA_DMA_CTRL, ((uint32_t) WORDS_PER_FRAME << 16) |
+                                  (slot & 0xF));
+}
 
 #if NYANCAT_COMPRESSION_DELTA
 
@@ -132,11 +323,8 @@ extern const uint8_t nyancat_compressed_data[];
 // Frame 1-11 (delta): 0x0X=SetColor, 0x1Y=Skip(1-16), 0x2Y=Repeat(1-16),
 //                      0x3Y=Skip*16(16-256), 0x4Y=Repeat*16(16-256),
 //                      0x5Y=Skip*64(64-1024)
-void vga_upload_frame_delta(int frame_index)
+void vga_upload_frame_delta(int frame_index, uint32_t slot)
 {
-    // Set upload address to start of frame
-    vga_write32(VGA_UPLOAD_ADDR, ((uint32_t) (frame_index & 0xF) << 16) | 0);
-
     // Get compressed data for this frame with bounds
     uint16_t offset = nyancat_frame_offsets[frame_index];
     uint16_t next_offset = (frame_index < FRAME_COUNT - 1)
@@ -220,20 +408,14 @@ void vga_upload_frame_delta(int frame_index)
     copy_buffer(prev_frame_buffer, frame_buffer, FRAME_SIZE);
 
     // Upload decompressed frame to VGA (512 words = 4096 pixels / 8)
-    for (int i = 0; i < FRAME_SIZE; i += PIXELS_PER_WORD) {
-        uint32_t packed = pack8_pixels(&frame_buffer[i]);
-        vga_write32(VGA_STREAM_DATA, packed);
-    }
+    vga_upload_packed(slot, frame_buffer);
 }
 
 #else
 
 // Fallback: baseline opcode-RLE decompression
-void vga_upload_frame_rle(int frame_index)
+void vga_upload_frame_rle(int frame_index, uint32_t slot)
 {
-    // Set upload address to start of frame
-    vga_write32(VGA_UPLOAD_ADDR, ((uint32_t) (frame_index & 0xF) << 16) | 0);
-
     // Get compressed data for this frame with bounds
     uint16_t offset = nyancat_frame_offsets[frame_index];
     uint16_t next_offset = (frame_index < FRAME_COUNT - 1)
@@ -271,20 +453,42 @@ void vga_upload_frame_rle(int frame_index)
         frame_buffer[output_index++] = 0;
 
     // Upload decompressed frame to VGA
-    for (int i = 0; i < FRAME_SIZE; i += PIXELS_PER_WORD) {
-        uint32_t packed = pack8_pixels(&frame_buffer[i]);
-        vga_write32(VGA_STREAM_DATA, packed);
-    }
+    vga_upload_packed(slot, frame_buffer);
 }
 
 #endif
+#endif
+
+// Frame scheduler: main decodes the next frame into the back slot while the
+// front slot scans out, and the vblank interrupt flips them, so frames change
+// on a vblank at a steady rate however long a decode takes (up to a period)
+static volatile uint32_t front_slot;  // Slot 0 is blank until the 1st flip
+static volatile uint32_t back_ready;  // Back slot holds the next frame
+static uint32_t vblank_ticks;
+
+static inline void vga_show(uint32_t slot)
+{
+    vga_write32(VGA_CTRL, VGA_CTRL_EN | VGA_CTRL_VBLANK_IE | (slot << 4));
+}
+
+// Vblank interrupt (machine external, see board/verilator/Top.scala)
+__attribute__((interrupt("machine"))) void vga_vblank_isr(void)
+{
+    vga_write32(VGA_INTR_STATUS, VGA_INTR_VBLANK);  // W1C
+    if (++vblank_ticks < VBLANKS_PER_FRAME || !back_ready)
+        return;  // Not due yet, or a late frame: keep showing this one
+    vblank_ticks = 0;
+    front_slot ^= 1;
+    vga_show(front_slot);
+    back_ready = 0;
+}
 
-// Simple delay function (~20Hz frame rate)
-// Use inline assembly to prevent compiler optimization
-static inline void delay(uint32_t cycles)
+static void vga_vblank_irq_enable(void)
 {
-    for (uint32_t i = 0; i < cycles; i++)
-        __asm__ volatile("nop");
+    __asm__ volatile("csrw mtvec, %0" ::"r"(vga_vblank_isr));
+    __asm__ volatile("csrs mie, %0" ::"r"(MIE_MEIE));
+    vga_show(front_slot);
+    __asm__ volatile("csrs mstatus, %0" ::"r"(MSTATUS_MIE));
 }
 
 int main(void)
@@ -294,37 +498,26 @@ int main(void)
     if (id != 0x56474131)
         return 1;
 
-    // Initialize palette and enable display
+    // Initialize palette, then scan out while frames are decoded
     vga_init_palette();
-    vga_write32(VGA_CTRL, 0x01);
-
-#if NYANCAT_COMPRESSION_DELTA
-    // Upload all frames (delta decompression)
-    for (int frame = 0; frame < FRAME_COUNT; frame++) {
-        vga_upload_frame_delta(frame);
-        vga_write32(VGA_CTRL,
-                    (frame << 4) | 0x01);  // Display frame as we upload
-    }
-
-    // Animate: cycle through frames infinitely
-    for (uint32_t frame = 0;;) {
-        vga_write32(VGA_CTRL, (frame << 4) | 0x01);
-        delay(50000);
-        frame = (frame + 1 < FRAME_COUNT) ? frame + 1 : 0;
-    }
+    vga_vblank_irq_enable();
+
+    for (int frame = 0;; frame = (frame + 1 < FRAME_COUNT) ? frame + 1 : 0) {
+        uint32_t back_slot = front_slot ^ 1;
+#if NYANCAT_COMPRESSION_WORD
+        vga_upload_frame_words(frame, back_slot);
+#elif NYANCAT_BLIT
+        vga_blit_frame(frame, back_slot);
+#elif NYANCAT_COMPRESSION_DELTA
+        vga_upload_frame_delta(frame, back_slot);
 #else
-    // Upload all frames (baseline RLE)
-    for (int frame = 0; frame < FRAME_COUNT; frame++) {
-        vga_upload_frame_rle(frame);
-        vga_write32(VGA_CTRL,
-                    (frame << 4) | 0x01);  // Display frame as we upload
-    }
+        vga_upload_frame_rle(frame, back_slot);
+#endif
+        vga_upload_wait();
 
-    // Animate: cycle through frames infinitely
-    for (uint32_t frame = 0;;) {
-        vga_write32(VGA_CTRL, (frame << 4) | 0x01);
-        delay(50000);
-        frame = (frame + 1 < FRAME_COUNT) ? frame + 1 : 0;
+        // Hand the slot to the ISR and sleep until it has flipped
+        back_ready = 1;
+        while (back_ready)
+            __asm__ volatile("wfi");
     }
-#endif
 }
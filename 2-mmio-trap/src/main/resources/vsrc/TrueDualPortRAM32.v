@@ -1,17 +1,19 @@
 // SPDX-License-Identifier: MIT
 // True dual-port, dual-clock RAM behavioral model
-// Port A: Write port (CPU clock domain)
+// Port A: Read/write port with nibble write mask (CPU clock domain)
 // Port B: Read port (Pixel clock domain)
 
 module TrueDualPortRAM32 #(
     parameter DEPTH = 6144,       // Number of 32-bit words
     parameter ADDR_WIDTH = 13     // Address width in bits
 ) (
-    // Port A: Write port (CPU clock domain)
+    // Port A: Read/write port (CPU clock domain)
     input wire clka,
     input wire wea,
+    input wire [7:0] wmaska,          // One bit per 4-bit pixel
     input wire [ADDR_WIDTH-1:0] addra,
     input wire [31:0] dina,
+    output reg [31:0] douta,
 
     // Port B: Read port (Pixel clock domain)
     input wire clkb,
@@ -22,11 +24,17 @@ module TrueDualPortRAM32 #(
     // RAM storage
     reg [31:0] mem [0:DEPTH-1];
 
-    // Port A: Write port
+    // Port A: Masked write, read-before-write
+    integer n;
     always @(posedge clka) begin
         if (wea) begin
-            mem[addra] <= dina;
+            for (n = 0; n < 8; n = n + 1) begin
+                if (wmaska[n]) begin
+                    mem[addra][n*4 +: 4] <= dina[n*4 +: 4];
+                end
+            end
         end
+        douta <= mem[addra];
     end
 
     // Port B: Read port
@@ -8,6 +8,7 @@ import chisel3._
 import chisel3.stage.ChiselStage
 import peripheral._
 import riscv.core.CPU
+import riscv.core.InterruptCode
 import riscv.CPUBundle
 import riscv.Parameters
 
@@ -20,6 +21,11 @@ class TopBundle extends CPUBundle {
   val vga_activevideo = Output(Bool())     // Active display region
   val vga_x_pos       = Output(UInt(10.W)) // Current pixel X position
   val vga_y_pos       = Output(UInt(10.W)) // Current pixel Y position
+
+  // VGA DMA read port into main memory (served by the testbench)
+  val vga_dma_address   = Output(UInt(Parameters.AddrWidth))
+  val vga_dma_read      = Output(Bool())
+  val vga_dma_read_data = Input(UInt(Parameters.DataWidth))
 }
 
 class Top extends Module {
@@ -33,6 +39,10 @@ class Top extends Module {
   cpu.io.csr_regs_debug_read_address := io.csr_regs_debug_read_address
   io.csr_regs_debug_read_data        := cpu.io.csr_regs_debug_read_data
   io.regs_debug_read_data            := cpu.io.regs_debug_read_data
+  io.regs_debug_write_enable         := cpu.io.regs_debug_write_enable
+  io.regs_debug_write_address        := cpu.io.regs_debug_write_address
+  io.regs_debug_write_data           := cpu.io.regs_debug_write_data
+  io.retire                          := cpu.io.retire
 
   // Export deviceSelect for external MMIO routing
   io.deviceSelect := cpu.io.deviceSelect
@@ -41,7 +51,14 @@ class Top extends Module {
   io.instruction_address   := cpu.io.instruction_address
   cpu.io.instruction       := io.instruction
   cpu.io.instruction_valid := io.instruction_valid
-  cpu.io.interrupt_flag    := io.interrupt_flag
+
+  // Interrupts: the testbench's lines, else the VGA (vblank, DMA done) as a
+  // machine external interrupt (mcause 11) until software clears INTR_STATUS
+  cpu.io.interrupt_flag := Mux(
+    io.interrupt_flag =/= InterruptCode.None,
+    io.interrupt_flag,
+    Mux(vga.io.intr, InterruptCode.External, InterruptCode.None)
+  )
 
   // Memory/MMIO routing: deviceSelect determines routing
   // deviceSelect=1: VGA (0x20000000-0x2FFFFFFF)
@@ -66,6 +83,9 @@ class Top extends Module {
   io.vga_activevideo         := vga.io.activevideo
   io.vga_x_pos               := vga.io.x_pos
   io.vga_y_pos               := vga.io.y_pos
+  io.vga_dma_address         := vga.io.dma.address
+  io.vga_dma_read            := vga.io.dma.read
+  vga.io.dma.read_data       := io.vga_dma_read_data
 
   // VGA MMIO routing
   vga.io.bundle.address      := cpu.io.memory_bundle.address
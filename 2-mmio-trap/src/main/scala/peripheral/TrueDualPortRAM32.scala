@@ -11,7 +11,7 @@ import chisel3.util._
 /**
  * True dual-port, dual-clock RAM with 32-bit data width
  *
- * Port A: Write port (CPU clock domain)
+ * Port A: Read/write port with a write mask per 4-bit pixel (CPU clock domain)
  * Port B: Read port (Pixel clock domain)
  *
  * For synthesis: vendor-specific implementation
@@ -31,11 +31,13 @@ class TrueDualPortRAM32(depth: Int, addrWidth: Int)
     with HasBlackBoxResource {
 
   val io = IO(new Bundle {
-    // Port A: Write port (CPU clock domain)
-    val clka  = Input(Clock())
-    val wea   = Input(Bool())
-    val addra = Input(UInt(addrWidth.W))
-    val dina  = Input(UInt(32.W))
+    // Port A: Read/write port (CPU clock domain), read data 1 cycle later
+    val clka   = Input(Clock())
+    val wea    = Input(Bool())
+    val wmaska = Input(UInt(8.W))
+    val addra  = Input(UInt(addrWidth.W))
+    val dina   = Input(UInt(32.W))
+    val douta  = Output(UInt(32.W))
 
     // Port B: Read port (Pixel clock domain)
     val clkb  = Input(Clock())
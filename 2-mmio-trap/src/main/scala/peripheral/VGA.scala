@@ -18,7 +18,13 @@ import riscv.Parameters
  *   0x0C: INTR_STATUS - Vblank interrupt flag (W1C)
  *   0x10: UPLOAD_ADDR - Framebuffer upload address (nibble index + frame)
  *   0x14: STREAM_DATA - 8 pixels packed in 32-bit word (auto-increment)
+ *   0x18: DMA_SRC     - DMA source byte address in main memory
+ *   0x1C: DMA_CTRL    - DMA start (write: frame index, length) / words left (read)
  *   0x20-0x5C: PALETTE[0-15] - 6-bit VGA colors (RRGGBB)
+ *   0x60: BLIT        - 2D command: fill or skip pixels at the upload address, copy a rectangle
+ *   0x64: TILE_ADDR   - Tile memory address (0x000-0x0FF patterns, 0x100-0x13F map)
+ *   0x68: TILE_DATA   - Tile pattern row or map entry (auto-increment)
+ *   0x6C-0x78: SPRITE[0-3] - Sprite x, y, tile and enable
  *
  * VGA timing: 640×480 @ 72Hz
  *   H_TOTAL=832, V_TOTAL=520, pixel clock=31.5 MHz
@@ -27,10 +33,30 @@ import riscv.Parameters
  *   Display: 6× scaled to 384×384 (centered in 640×480)
  *   Left margin: 128, Top margin: 48
  *
+ * Tile and sprite layer (CTRL bit 10 enables the tiles, SPRITE bit 31 each sprite):
+ *   32 patterns of 8×8 pixels, one 32-bit word per row like the framebuffer
+ *   8×8 tile map covering the 64×64 frame
+ *   4 sprites of one pattern each, at signed 8-bit frame coordinates
+ *   Composited before palette lookup: sprite 0 over sprite 3 over tiles over
+ *   framebuffer, with palette index 0 transparent in sprites and tiles
+ *
  * Clock domains:
- *   - CPU clock (sysclk): MMIO registers, palette, upload logic
+ *   - CPU clock (sysclk): MMIO registers, palette, upload logic, DMA
  *   - Pixel clock (pixclk): VGA sync generator, framebuffer read, rendering
  */
+
+/**
+ * Read port into main memory for the VGA DMA engine
+ *
+ * Like the CPU's memory bundle, read_data answers address in the same cycle;
+ * main memory serves it next to the instruction and data ports.
+ */
+class VGADMABundle extends Bundle {
+  val address   = Output(UInt(Parameters.AddrWidth))
+  val read      = Output(Bool())
+  val read_data = Input(UInt(Parameters.DataWidth))
+}
+
 class VGA extends Module {
   val io = IO(new Bundle {
     val bundle      = new RAMBundle      // MMIO interface (CPU clock domain)
@@ -39,7 +65,8 @@ class VGA extends Module {
     val vsync       = Output(Bool())     // Vertical sync
     val rrggbb      = Output(UInt(6.W))  // 6-bit color output
     val activevideo = Output(Bool())     // Active display region
-    val intr        = Output(Bool())     // Interrupt output (vblank)
+    val intr        = Output(Bool())     // Interrupt output (vblank, DMA done)
+    val dma         = new VGADMABundle   // Frame fetches from main memory
     val x_pos       = Output(UInt(10.W)) // Current pixel X position
     val y_pos       = Output(UInt(10.W)) // Current pixel Y position
   })
@@ -75,10 +102,22 @@ class VGA extends Module {
   val TOTAL_WORDS      = NUM_FRAMES * WORDS_PER_FRAME  // 6144 words
   val ADDR_WIDTH       = 13                            // log2(6144) rounded up
 
+  // Tile and sprite parameters
+  val TILE_SIZE      = 8
+  val NUM_TILES      = 32                              // Patterns, one word per row
+  val TILE_WORDS     = NUM_TILES * TILE_SIZE           // 256 words
+  val TILE_MAP_SIZE  = FRAME_WIDTH / TILE_SIZE         // 8×8 map entries
+  val TILE_MAP_BASE  = TILE_WORDS                      // TILE_ADDR of map entry 0
+  val TILE_ADDR_END  = TILE_MAP_BASE + TILE_MAP_SIZE * TILE_MAP_SIZE
+  val NUM_SPRITES    = 4
+
   // ============ Framebuffer RAM ============
   // Dual-port, dual-clock RAM: Write on CPU clock, Read on Pixel clock
   val framebuffer = Module(new TrueDualPortRAM32(TOTAL_WORDS, ADDR_WIDTH))
 
+  // Tile patterns: written by the CPU, read per pixel and per sprite row
+  val tiles = Module(new TrueDualPortRAM32(TILE_WORDS, log2Ceil(TILE_WORDS)))
+
   // ============ CPU Clock Domain (sysclk) ============
   val sysClk = clock
 
@@ -86,6 +125,12 @@ class VGA extends Module {
   val ctrlReg       = RegInit(0.U(32.W)) // CTRL register
   val intrStatusReg = RegInit(0.U(32.W)) // INTR_STATUS register (W1C)
   val uploadAddrReg = RegInit(0.U(32.W)) // UPLOAD_ADDR register
+  val dmaSrcReg     = RegInit(0.U(32.W)) // DMA_SRC register, advances per word
+  val tileAddrReg   = RegInit(0.U(32.W)) // TILE_ADDR register
+
+  // Tile map (pattern per 8×8 cell) and sprites ([7:0] x, [15:8] y, [20:16] pattern, [31] enable)
+  val tileMapReg = RegInit(VecInit(Seq.fill(TILE_MAP_SIZE * TILE_MAP_SIZE)(0.U(5.W))))
+  val spriteReg  = RegInit(VecInit(Seq.fill(NUM_SPRITES)(0.U(32.W))))
 
   // Color palette (16 entries × 6-bit)
   val paletteReg = Reg(Vec(16, UInt(6.W)))
@@ -96,6 +141,8 @@ class VGA extends Module {
   val ctrl_swap_req  = ctrlReg(2)
   val ctrl_frame_sel = ctrlReg(7, 4)
   val ctrl_vblank_ie = ctrlReg(8)
+  val ctrl_dma_ie    = ctrlReg(9)
+  val ctrl_tile_en   = ctrlReg(10)
 
   // Cross-clock-domain wires (declared at module scope for CDC)
   val wire_in_vblank  = Wire(Bool())
@@ -108,15 +155,22 @@ class VGA extends Module {
     val upload_frame    = uploadAddrReg(19, 16)
 
     // MMIO address decode (mask to get offset within peripheral)
-    val addr             = io.bundle.address & 0xff.U // VGA registers at 0x00-0x5F
+    val addr             = io.bundle.address & 0xff.U // VGA registers at 0x00-0x7B
     val addr_id          = addr === 0x00.U
     val addr_ctrl        = addr === 0x04.U
     val addr_status      = addr === 0x08.U
     val addr_intr_status = addr === 0x0c.U
     val addr_upload_addr = addr === 0x10.U
     val addr_stream_data = addr === 0x14.U
+    val addr_dma_src     = addr === 0x18.U
+    val addr_dma_ctrl    = addr === 0x1c.U
     val addr_palette     = (addr >= 0x20.U) && (addr < 0x60.U)
+    val addr_blit        = addr === 0x60.U
+    val addr_tile_addr   = addr === 0x64.U
+    val addr_tile_data   = addr === 0x68.U
+    val addr_sprite      = (addr >= 0x6c.U) && (addr < 0x7c.U)
     val palette_idx      = (addr - 0x20.U) >> 2
+    val sprite_idx       = (addr - 0x6c.U) >> 2
 
     // CDC: Synchronize status signals from pixel domain to CPU domain
     val vblank_sync1      = RegNext(wire_in_vblank)
@@ -124,21 +178,144 @@ class VGA extends Module {
     val curr_frame_sync1  = RegNext(wire_curr_frame)
     val curr_frame_synced = RegNext(curr_frame_sync1)
 
+    // DMA engine: copies words from main memory into the framebuffer, one
+    // per cycle. The framebuffer write port is shared with STREAM_DATA, which
+    // wins; the transfer then resumes on the next cycle.
+    val dma_dst       = RegInit(0.U(ADDR_WIDTH.W))       // Next framebuffer word
+    val dma_remaining = RegInit(0.U((ADDR_WIDTH + 1).W)) // Words left to copy
+    val dma_busy      = dma_remaining =/= 0.U
+    val stream_write  = io.bundle.write_enable && addr_stream_data
+    val dma_step      = dma_busy && !stream_write
+    val dma_done      = dma_step && dma_remaining === 1.U
+
+    io.dma.address := dmaSrcReg
+    io.dma.read    := dma_step
+
+    when(dma_step) {
+      dmaSrcReg     := dmaSrcReg + 4.U
+      dma_dst       := dma_dst + 1.U
+      dma_remaining := dma_remaining - 1.U
+    }
+
+    // Blitter: one BLIT write per command
+    //   [31:30] = 0 FILL: [16:4] pixels, [3:0] palette index
+    //   [31:30] = 1 SKIP: [16:4] pixels
+    //   [31:30] = 2 COPY: [3:0] source frame, [7:4] destination frame,
+    //                     [10:8] x / 8, [13:11] width / 8 - 1, [19:14] y, [25:20] height - 1
+    // FILL and SKIP work at the upload address like STREAM_DATA and move it
+    // on at once (wrapping within the frame), so SKIP costs nothing and
+    // software may queue the next command right away. FILL and COPY run from
+    // a queue, a word per cycle (COPY: a read and a write per word) in cycles
+    // the CPU and DMA leave the framebuffer port free. Commands written while
+    // the queue is full are dropped, see STATUS bits 3-4.
+    val BLIT_FILL = 0.U(2.W)
+    val BLIT_SKIP = 1.U(2.W)
+    val BLIT_COPY = 2.U(2.W)
+
+    val blit_write   = io.bundle.write_enable && addr_blit
+    val blit_op      = io.bundle.write_data(31, 30)
+    val blit_pixels  = io.bundle.write_data(16, 4)
+    val blit_fill    = blit_op === BLIT_FILL && blit_pixels =/= 0.U
+    val blit_copy_ok = blit_op === BLIT_COPY &&
+      io.bundle.write_data(3, 0) < NUM_FRAMES.U && io.bundle.write_data(7, 4) < NUM_FRAMES.U
+    // Queue entry: [47:44] frame and [43:32] pixel of the upload address, [31:0] command
+    val blit_queue = Module(new Queue(UInt(48.W), 16))
+    blit_queue.io.enq.valid := blit_write && (blit_fill || blit_copy_ok)
+    blit_queue.io.enq.bits  := Cat(upload_frame, upload_pix_addr(11, 0), io.bundle.write_data)
+
+    // Command in progress
+    val blit_active = RegInit(false.B)
+    val blit_copy   = Reg(Bool())
+    val blit_cmd    = Reg(UInt(32.W))
+    val fill_frame  = Reg(UInt(4.W))
+    val fill_pix    = Reg(UInt(12.W))
+    val fill_left   = Reg(UInt(13.W))
+    val copy_row    = Reg(UInt(7.W))
+    val copy_col    = Reg(UInt(4.W))
+    val copy_read   = RegInit(true.B) // Read phase, else write phase
+    val copy_word   = Reg(UInt(32.W))
+
+    val copy_src     = blit_cmd(3, 0)
+    val copy_dst     = blit_cmd(7, 4)
+    val copy_x0      = blit_cmd(10, 8)
+    val copy_col_end = blit_cmd(10, 8) +& blit_cmd(13, 11) +& 1.U
+    val copy_row_end = blit_cmd(19, 14) +& blit_cmd(25, 20) +& 1.U
+
+    blit_queue.io.deq.ready := !blit_active
+    when(blit_queue.io.deq.fire) {
+      val entry = blit_queue.io.deq.bits
+      blit_active := true.B
+      blit_copy   := entry(31, 30) === BLIT_COPY
+      blit_cmd    := entry(31, 0)
+      fill_frame  := entry(47, 44)
+      fill_pix    := entry(43, 32)
+      fill_left   := entry(16, 4)
+      copy_row    := entry(19, 14)
+      copy_col    := entry(10, 8)
+      copy_read   := true.B
+    }
+
+    // The framebuffer port goes to STREAM_DATA first, then DMA
+    val blit_port = blit_active && !stream_write && !dma_busy
+
+    // FILL: the pixels of one word per cycle, under a nibble mask
+    val fill_offset = fill_pix(2, 0)
+    val fill_room   = 8.U(4.W) - fill_offset
+    val fill_count  = Mux(fill_left < fill_room, fill_left(3, 0), fill_room)
+    val fill_mask   = ((1.U(9.W) << fill_count) - 1.U)(7, 0) << fill_offset
+    val fill_step   = blit_port && !blit_copy
+
+    when(fill_step) {
+      fill_pix  := fill_pix + fill_count // Wraps within the frame
+      fill_left := fill_left - fill_count
+      when(fill_left === fill_count) {
+        blit_active := false.B
+      }
+    }
+
+    // COPY: the read data arrives the cycle after the read
+    val copy_index = Cat(copy_row(5, 0), copy_col(2, 0))
+    val copy_step  = blit_port && blit_copy
+    val copy_fresh = RegNext(copy_step && copy_read, false.B)
+    val copy_data  = Mux(copy_fresh, framebuffer.io.douta, copy_word)
+
+    when(copy_fresh) {
+      copy_word := framebuffer.io.douta
+    }
+    when(copy_step) {
+      copy_read := !copy_read
+      when(!copy_read) {
+        when(copy_col + 1.U === copy_col_end || copy_col === 7.U) {
+          copy_col := copy_x0
+          copy_row := copy_row + 1.U
+          when(copy_row + 1.U === copy_row_end || copy_row === 63.U) {
+            blit_active := false.B
+          }
+        }.otherwise {
+          copy_col := copy_col + 1.U
+        }
+      }
+    }
+
     // Status signals for MMIO reads
     val status_in_vblank    = vblank_synced
     val status_safe_to_swap = vblank_synced // Safe to swap during vblank
-    val status_upload_busy  = false.B       // Upload is never busy (write-through)
+    val status_upload_busy  = dma_busy      // STREAM_DATA is write-through
     val status_curr_frame   = curr_frame_synced
+    val status_blit_busy    = blit_active || blit_queue.io.deq.valid
+    val status_blit_full    = !blit_queue.io.enq.ready
 
     // Vblank interrupt: Edge detection
     val vblank_prev        = RegNext(vblank_synced)
     val vblank_rising_edge = vblank_synced && !vblank_prev
 
-    when(vblank_rising_edge && ctrl_vblank_ie) {
-      intrStatusReg := 1.U // Set vblank interrupt flag
+    // Interrupt flags: bit 0 vblank, bit 1 DMA done
+    val intr_set = Cat(dma_done && ctrl_dma_ie, vblank_rising_edge && ctrl_vblank_ie)
+    when(intr_set =/= 0.U) {
+      intrStatusReg := intrStatusReg | intr_set
     }
 
-    io.intr := (intrStatusReg =/= 0.U) && ctrl_vblank_ie
+    io.intr := (intrStatusReg(0) && ctrl_vblank_ie) || (intrStatusReg(1) && ctrl_dma_ie)
 
     // MMIO Read
     io.bundle.read_data := MuxLookup(addr, 0.U)(
@@ -148,14 +325,19 @@ class VGA extends Module {
         0x08.U -> Cat(
           0.U(24.W),
           status_curr_frame,
-          0.U(2.W),
+          status_blit_full,
+          status_blit_busy,
           status_upload_busy,
           status_safe_to_swap,
           status_in_vblank
         ),
         0x0c.U -> intrStatusReg,
-        0x10.U -> uploadAddrReg
+        0x10.U -> uploadAddrReg,
+        0x18.U -> dmaSrcReg,
+        0x1c.U -> Cat(dma_remaining, 0.U(16.W)),
+        0x64.U -> tileAddrReg
       ) ++ (0 until 16).map(i => (0x20 + i * 4).U -> paletteReg(i))
+        ++ (0 until NUM_SPRITES).map(i => (0x6c + i * 4).U -> spriteReg(i))
     )
 
     // Framebuffer write port (CPU clock domain)
@@ -163,9 +345,18 @@ class VGA extends Module {
 
     // Calculate framebuffer write signals
     val fb_write_en   = WireDefault(false.B)
+    val fb_write_mask = WireDefault("hff".U(8.W))
     val fb_write_addr = WireDefault(0.U(ADDR_WIDTH.W))
     val fb_write_data = WireDefault(0.U(32.W))
 
+    // Tile pattern write port (CPU clock domain)
+    val tile_write_en = WireDefault(false.B)
+    tiles.io.clka   := clock
+    tiles.io.wea    := tile_write_en
+    tiles.io.wmaska := "hff".U
+    tiles.io.addra  := tileAddrReg(7, 0)
+    tiles.io.dina   := io.bundle.write_data
+
     // MMIO Write
     when(io.bundle.write_enable) {
       when(addr_ctrl) {
@@ -180,8 +371,8 @@ class VGA extends Module {
           ctrlReg := Cat(ctrlReg(31, 8), ctrlReg(7, 4), Cat(0.U(3.W), display_enable))
         }
       }.elsewhen(addr_intr_status) {
-        // W1C: Write 1 to Clear
-        intrStatusReg := intrStatusReg & ~io.bundle.write_data
+        // W1C: Write 1 to Clear (flags raised this cycle stay set)
+        intrStatusReg := (intrStatusReg & ~io.bundle.write_data) | intr_set
       }.elsewhen(addr_upload_addr) {
         uploadAddrReg := io.bundle.write_data
       }.elsewhen(addr_stream_data) {
@@ -201,15 +392,72 @@ class VGA extends Module {
         val next_addr    = upload_pix_addr + 8.U
         val wrapped_addr = Mux(next_addr >= PIXELS_PER_FRAME.U, 0.U, next_addr)
         uploadAddrReg := Cat(upload_frame, wrapped_addr)
+      }.elsewhen(addr_dma_src) {
+        when(!dma_busy) {
+          dmaSrcReg := io.bundle.write_data
+        }
+      }.elsewhen(addr_dma_ctrl) {
+        // DMA_CTRL write: bits [3:0] first frame, bits [28:16] length in
+        // words (0 = one frame); a transfer may run on into the following
+        // frames but stops at the end of the framebuffer. Ignored while busy.
+        val dma_frame  = io.bundle.write_data(3, 0)
+        val dma_length = io.bundle.write_data(28, 16)
+        val dma_base   = dma_frame * WORDS_PER_FRAME.U
+        val dma_room   = TOTAL_WORDS.U - dma_base
+        val dma_words  = Mux(dma_length === 0.U, WORDS_PER_FRAME.U, dma_length)
+        when(!dma_busy && dma_frame < NUM_FRAMES.U) {
+          dma_dst       := dma_base
+          dma_remaining := Mux(dma_words > dma_room, dma_room, dma_words)
+        }
+      }.elsewhen(addr_blit) {
+        // FILL and SKIP advance the upload address, wrapping within the frame
+        val moves = blit_op === BLIT_SKIP || blit_op === BLIT_FILL && blit_queue.io.enq.ready
+        when(moves) {
+          uploadAddrReg := Cat(upload_frame, 0.U(4.W), (upload_pix_addr(11, 0) + blit_pixels)(11, 0))
+        }
+      }.elsewhen(addr_tile_addr) {
+        tileAddrReg := io.bundle.write_data
+      }.elsewhen(addr_tile_data) {
+        // Pattern rows go to the tile RAM, map entries to registers
+        when(tileAddrReg < TILE_MAP_BASE.U) {
+          tile_write_en := true.B
+        }.elsewhen(tileAddrReg < TILE_ADDR_END.U) {
+          tileMapReg(tileAddrReg - TILE_MAP_BASE.U) := io.bundle.write_data(4, 0)
+        }
+        val next_tile_addr = tileAddrReg + 1.U
+        tileAddrReg := Mux(next_tile_addr >= TILE_ADDR_END.U, 0.U, next_tile_addr)
       }.elsewhen(addr_palette) {
         paletteReg(palette_idx) := io.bundle.write_data(5, 0)
+      }.elsewhen(addr_sprite) {
+        spriteReg(sprite_idx) := io.bundle.write_data
       }
     }
 
-    // Connect framebuffer write port
-    framebuffer.io.wea   := fb_write_en
-    framebuffer.io.addra := fb_write_addr
-    framebuffer.io.dina  := fb_write_data
+    // DMA words use the write port in cycles without a STREAM_DATA write
+    when(dma_step) {
+      fb_write_en   := true.B
+      fb_write_addr := dma_dst
+      fb_write_data := io.dma.read_data
+    }
+
+    // Blitter words in cycles left free by STREAM_DATA and DMA
+    when(fill_step) {
+      fb_write_en   := true.B
+      fb_write_mask := fill_mask
+      fb_write_addr := fill_frame * WORDS_PER_FRAME.U + fill_pix(11, 3)
+      fb_write_data := Fill(8, blit_cmd(3, 0))
+    }
+    when(copy_step) {
+      fb_write_en   := !copy_read
+      fb_write_addr := Mux(copy_read, copy_src, copy_dst) * WORDS_PER_FRAME.U + copy_index
+      fb_write_data := copy_data
+    }
+
+    // Connect framebuffer port A
+    framebuffer.io.wea    := fb_write_en
+    framebuffer.io.wmaska := fb_write_mask
+    framebuffer.io.addra  := fb_write_addr
+    framebuffer.io.dina   := fb_write_data
   }
 
   // ============ Pixel Clock Domain (pixclk) ============
@@ -291,6 +539,14 @@ class VGA extends Module {
     // Second synchronizer stage for metastability prevention
     val palette_sync = RegNext(palette_sync1)
 
+    // CDC: Tile layer state, quasi-static like the palette
+    val tile_en_sync1  = RegNext(ctrl_tile_en)
+    val tile_en        = RegNext(tile_en_sync1)
+    val tile_map_sync1 = RegNext(tileMapReg)
+    val tile_map_sync  = RegNext(tile_map_sync1)
+    val sprite_sync1   = RegNext(spriteReg)
+    val sprite_sync    = RegNext(sprite_sync1)
+
     // Framebuffer read logic
     // Pipeline stage: Delay coordinates and control signals to match pipeline depth
     // Total pipeline: x_px/y_px registration (1 cycle) + RAM read (1 cycle) = 2 cycles
@@ -341,8 +597,45 @@ class VGA extends Module {
       )
     )
 
+    // Tile and sprite layer. The pattern RAM serves the tile under the
+    // pixel during the display area; in the first NUM_SPRITES cycles of the
+    // left margin it fetches each sprite's row for this line instead.
+    def nibble(word: UInt, index: UInt): UInt = VecInit((0 until 8).map(i => word(i * 4 + 3, i * 4)))(index)
+
+    val tile_index       = tile_map_sync(Cat(frame_y(5, 3), frame_x(5, 3)))
+    val sprite_fetch     = x_px < NUM_SPRITES.U
+    val sprite_fetch_idx = x_px(log2Ceil(NUM_SPRITES) - 1, 0)
+    val fetch_sprite     = sprite_sync(sprite_fetch_idx)
+    val fetch_row        = frame_y - fetch_sprite(15, 8) // Wraps for sprites above the frame
+    val fetch_hit        = fetch_sprite(31) && in_display_y && fetch_row < TILE_SIZE.U
+
+    tiles.io.clkb  := io.pixClock
+    tiles.io.addrb := Mux(
+      sprite_fetch,
+      Cat(fetch_sprite(20, 16), fetch_row(2, 0)),
+      Cat(tile_index, frame_y(2, 0))
+    )
+
+    // Sprite rows for the current line, empty when the sprite misses it
+    val sprite_row          = Reg(Vec(NUM_SPRITES, UInt(32.W)))
+    val sprite_fetch_d1     = RegNext(sprite_fetch, false.B)
+    val sprite_fetch_idx_d1 = RegNext(sprite_fetch_idx)
+    val fetch_hit_d1        = RegNext(fetch_hit)
+    when(sprite_fetch_d1) {
+      sprite_row(sprite_fetch_idx_d1) := Mux(fetch_hit_d1, tiles.io.doutb, 0.U)
+    }
+
+    // Composite, first sprite on top, index 0 transparent
+    val tile_pixel    = Mux(tile_en, nibble(tiles.io.doutb, pixel_in_word_d1), 0.U)
+    val layered_pixel = (0 until NUM_SPRITES).foldRight(Mux(tile_pixel =/= 0.U, tile_pixel, pixel_4bit)) {
+      (i, below) =>
+        val column = frame_x_d1 - sprite_sync(i)(7, 0) // Wraps for sprites left of the frame
+        val pixel  = nibble(sprite_row(i), column(2, 0))
+        Mux(column < TILE_SIZE.U && pixel =/= 0.U, pixel, below)
+    }
+
     // Palette lookup
-    val color_from_palette = palette_sync(pixel_4bit)
+    val color_from_palette = palette_sync(layered_pixel)
 
     val output_color = WireDefault(0.U(6.W))
     when(blanking) {
@@ -18,4 +18,12 @@ class CPUBundle extends Bundle {
   val regs_debug_read_data        = Output(UInt(Parameters.DataWidth))
   val csr_regs_debug_read_address = Input(UInt(Parameters.CSRRegisterAddrWidth))
   val csr_regs_debug_read_data    = Output(UInt(Parameters.DataWidth))
+
+  // Register file write port, observed by the simulator to compare retired results
+  val regs_debug_write_enable  = Output(Bool())
+  val regs_debug_write_address = Output(UInt(Parameters.PhysicalRegisterAddrWidth))
+  val regs_debug_write_data    = Output(UInt(Parameters.DataWidth))
+
+  // One record per retired instruction, for commit logs and lockstep checking
+  val retire = new RetirementBundle
 }
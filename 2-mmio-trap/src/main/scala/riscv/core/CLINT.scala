@@ -11,9 +11,10 @@ import riscv.Parameters
 
 // Interrupt cause codes for mcause register
 object InterruptCode {
-  val None   = 0x0.U(8.W)
-  val Timer0 = 0x1.U(8.W)
-  val Ret    = 0xff.U(8.W)
+  val None     = 0x0.U(8.W)
+  val Timer0   = 0x1.U(8.W)
+  val External = 0x2.U(8.W) // Any other non-zero code: machine external interrupt
+  val Ret      = 0xff.U(8.W)
 }
 
 object InterruptEntry {
@@ -91,6 +91,10 @@ class CPU extends Module {
   regs.io.read_address1 := id.io.regs_reg1_read_address
   regs.io.read_address2 := id.io.regs_reg2_read_address
 
+  io.regs_debug_write_enable  := id.io.reg_write_enable
+  io.regs_debug_write_address := id.io.reg_write_address
+  io.regs_debug_write_data    := wb.io.regs_write_data
+
   id.io.instruction := inst_fetch.io.instruction
 
   csr_regs.io.clint_access_bundle <> clint.io.csr_bundle
@@ -134,4 +138,33 @@ class CPU extends Module {
   clint.io.interrupt_flag      := io.interrupt_flag
   clint.io.jump_flag           := ex.io.if_jump_flag
   clint.io.jump_address        := ex.io.if_jump_address
+
+  // Retirement port: the instruction retires in the cycle it executes
+  val retire_rd = Mux(id.io.reg_write_enable, id.io.reg_write_address, 0.U)
+  io.retire.valid               := io.instruction_valid
+  io.retire.pc                  := inst_fetch.io.instruction_address
+  io.retire.instruction         := inst_fetch.io.instruction
+  io.retire.rd_address          := retire_rd
+  io.retire.rd_data             := Mux(retire_rd =/= 0.U, wb.io.regs_write_data, 0.U)
+  io.retire.memory_address      := mem.io.memory_bundle.address
+  io.retire.memory_read         := id.io.memory_read_enable
+  io.retire.memory_read_data    := io.memory_bundle.read_data
+  io.retire.memory_write_strobe := Mux(mem.io.memory_bundle.write_enable, mem.io.memory_bundle.write_strobe.asUInt, 0.U)
+  io.retire.memory_write_data   := mem.io.memory_bundle.write_data
+  io.retire.trap := inst_fetch.io.instruction === InstructionsEnv.ecall ||
+    inst_fetch.io.instruction === InstructionsEnv.ebreak
+
+  // The CLINT lets the current instruction complete and redirects to mtvec,
+  // so the next instruction to retire is the first of the handler
+  val interrupt_taken = io.instruction_valid && clint.io.interrupt_assert &&
+    inst_fetch.io.instruction =/= InstructionsEnv.ecall &&
+    inst_fetch.io.instruction =/= InstructionsEnv.ebreak &&
+    inst_fetch.io.instruction =/= InstructionsRet.mret
+  val interrupt_entry = RegInit(false.B)
+  when(interrupt_taken) {
+    interrupt_entry := true.B
+  }.elsewhen(io.instruction_valid) {
+    interrupt_entry := false.B
+  }
+  io.retire.interrupt := interrupt_entry
 }
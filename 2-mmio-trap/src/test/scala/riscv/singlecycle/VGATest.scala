@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package riscv.singlecycle
+
+import board.verilator.Top
+import chisel3._
+import chiseltest._
+import org.scalatest.flatspec.AnyFlatSpec
+import peripheral.RAMBundle
+import peripheral.VGA
+import peripheral.VGADMABundle
+import riscv.core.CSRRegister
+import riscv.WriteVcdEnabler
+
+// VGA with the pixel clock tied to the system clock, so one test clock steps
+// both domains
+class VGAHarness extends Module {
+  val io = IO(new Bundle {
+    val bundle      = new RAMBundle
+    val dma         = new VGADMABundle
+    val rrggbb      = Output(UInt(6.W))
+    val activevideo = Output(Bool())
+    val intr        = Output(Bool())
+    val x_pos       = Output(UInt(10.W))
+    val y_pos       = Output(UInt(10.W))
+  })
+
+  val vga = Module(new VGA)
+  vga.io.pixClock := clock
+  io.bundle <> vga.io.bundle
+  io.dma <> vga.io.dma
+  io.rrggbb      := vga.io.rrggbb
+  io.activevideo := vga.io.activevideo
+  io.intr        := vga.io.intr
+  io.x_pos       := vga.io.x_pos
+  io.y_pos       := vga.io.y_pos
+}
+
+class VGATest extends AnyFlatSpec with ChiselScalatestTester {
+  // The framebuffer and tile RAMs are Verilog black boxes
+  val annos = Seq(VerilatorBackendAnnotation) ++ WriteVcdEnabler.annos
+
+  val CTRL        = 0x04
+  val STATUS      = 0x08
+  val INTR_STATUS = 0x0c
+  val UPLOAD_ADDR = 0x10
+  val STREAM_DATA = 0x14
+  val DMA_SRC     = 0x18
+  val DMA_CTRL    = 0x1c
+  val PALETTE     = 0x20
+  val BLIT        = 0x60 // STATUS bit 3 while busy
+  val TILE_ADDR   = 0x64
+  val TILE_DATA   = 0x68
+  val SPRITE      = 0x6c
+
+  // Display area of the 64×64 frame, scaled 3× (see VGA.scala)
+  val LEFT_MARGIN = 64
+  val TOP_MARGIN  = 24
+  val SCALE       = 3
+
+  def write(c: VGAHarness, offset: Int, data: Long): Unit = {
+    c.io.bundle.address.poke(offset.U)
+    c.io.bundle.write_data.poke(data.U)
+    c.io.bundle.write_enable.poke(true.B)
+    c.clock.step()
+    c.io.bundle.write_enable.poke(false.B)
+  }
+
+  def read(c: VGAHarness, offset: Int): BigInt = {
+    c.io.bundle.address.poke(offset.U)
+    c.io.bundle.read_data.peek().litValue
+  }
+
+  // Palette index i shows as color i, so the display reads back the indices
+  def setup(c: VGAHarness): Unit = {
+    c.clock.setTimeout(0)
+    c.io.bundle.write_strobe.foreach(_.poke(true.B))
+    c.io.dma.read_data.poke(0.U)
+    for (i <- 0 until 16) {
+      write(c, PALETTE + i * 4, i)
+    }
+  }
+
+  // Show a frame (with extra CTRL bits) and return the palette indices of its
+  // 64×64 pixels, taken from the middle of each scaled pixel
+  def scanFrame(c: VGAHarness, frame: Int, ctrl: Long = 0): Array[Array[Int]] = {
+    write(c, CTRL, ctrl | (frame << 4) | 1)
+    // Start from the top so the whole scan sees the new settings
+    c.clock.step(4)
+    while (c.io.y_pos.peek().litValue != 0 || c.io.x_pos.peek().litValue != 0) {
+      c.clock.step()
+    }
+    val pixels = Array.fill(64, 64)(-1)
+    var y      = 0
+    while (y < TOP_MARGIN + 64 * SCALE) {
+      y = c.io.y_pos.peek().litValue.toInt
+      val x  = c.io.x_pos.peek().litValue.toInt
+      val dx = x - LEFT_MARGIN
+      val dy = y - TOP_MARGIN
+      if (
+        c.io.activevideo.peek().litToBoolean && dx >= 0 && dy >= 0 && dx < 64 * SCALE && dy < 64 * SCALE &&
+        dx % SCALE == 1 && dy % SCALE == 1
+      ) {
+        pixels(dy / SCALE)(dx / SCALE) = c.io.rrggbb.peek().litValue.toInt
+      }
+      c.clock.step()
+    }
+    pixels
+  }
+
+  // Palette index of pixel x of a framebuffer word
+  def nibble(word: Long, x: Int): Int = ((word >> (x * 4)) & 0xf).toInt
+
+  def expectPixels(pixels: Array[Array[Int]])(expected: (Int, Int) => Int): Unit =
+    for (y <- 0 until 64; x <- 0 until 64) {
+      assert(pixels(y)(x) == expected(x, y), s"pixel ($x, $y)")
+    }
+
+  // Frame contents given the words written to it (all others zero)
+  def expectFrame(pixels: Array[Array[Int]], words: Map[Int, Long]): Unit =
+    expectPixels(pixels)((x, y) => nibble(words.getOrElse((y * 64 + x) / 8, 0L), x % 8))
+
+  // BLIT commands
+  def fill(pixels: Int, index: Int): Long = (pixels.toLong << 4) | index
+  def skip(pixels: Int): Long             = (1L << 30) | (pixels.toLong << 4)
+  def copy(src: Int, dst: Int, x: Int, y: Int, width: Int, height: Int): Long =
+    (2L << 30) | ((height - 1).toLong << 20) | (y.toLong << 14) | ((width / 8 - 1).toLong << 11) |
+      ((x / 8).toLong << 8) | (dst << 4) | src
+
+  def blitIdle(c: VGAHarness): Unit =
+    while ((read(c, STATUS) & 0x8) != 0) {
+      c.clock.step()
+    }
+
+  behavior.of("VGA")
+
+  it should "copy words from main memory by DMA, giving way to STREAM_DATA" in {
+    test(new VGAHarness).withAnnotations(annos) { c =>
+      setup(c)
+      // Nibble i of word k is i + k, for eight words
+      def dmaWord(k: Int) = 0x76543210L + k * 0x11111111L
+      val streamWord = 0x9abcdef1L
+
+      write(c, CTRL, 1 << 9) // DMA done interrupt
+      write(c, UPLOAD_ADDR, (2L << 16) | 64) // Frame 2, row 1
+      write(c, DMA_SRC, 0x1000)
+      write(c, DMA_CTRL, (8L << 16) | 2) // 8 words to frame 2
+
+      // A word per cycle, with the words left in DMA_CTRL[29:16]
+      def transfer(first: Int, until: Int): Unit =
+        for (k <- first until until) {
+          assert(read(c, DMA_CTRL) == BigInt(8 - k) << 16)
+          c.io.dma.read.expect(true.B)
+          c.io.dma.address.expect((0x1000 + k * 4).U)
+          c.io.dma.read_data.poke(dmaWord(k).U)
+          c.clock.step()
+        }
+      transfer(0, 3)
+
+      // STREAM_DATA takes the framebuffer port, DMA resumes a cycle later
+      c.io.bundle.address.poke(STREAM_DATA.U)
+      c.io.bundle.write_data.poke(streamWord.U)
+      c.io.bundle.write_enable.poke(true.B)
+      c.io.dma.read.expect(false.B)
+      c.clock.step()
+      c.io.bundle.write_enable.poke(false.B)
+      transfer(3, 8)
+
+      assert(read(c, DMA_CTRL) == 0)
+      c.io.dma.read.expect(false.B)
+      c.io.intr.expect(true.B)
+      assert(read(c, INTR_STATUS) == 2)
+      write(c, INTR_STATUS, 2)
+      c.io.intr.expect(false.B)
+
+      expectFrame(scanFrame(c, 2), (0 until 8).map(k => k -> dmaWord(k)).toMap + (8 -> streamWord))
+    }
+  }
+
+  it should "fill, skip and copy with the blitter" in {
+    test(new VGAHarness).withAnnotations(annos) { c =>
+      setup(c)
+      write(c, UPLOAD_ADDR, 3) // Frame 0, pixel 3
+      write(c, BLIT, fill(10, 5)) // Pixels 3-12, across a word boundary
+      write(c, BLIT, skip(100))
+      write(c, BLIT, fill(20, 7)) // Pixels 113-132
+      // FILL and SKIP move the upload address at once
+      assert(read(c, UPLOAD_ADDR) == 133)
+      // Queued behind the fills, so the copies see them
+      write(c, BLIT, copy(0, 1, 0, 0, 64, 3)) // Rows 0-2 to frame 1
+      write(c, BLIT, copy(1, 1, 0, 0, 64, 2)) // Overlapping: onto itself
+      write(c, BLIT, copy(0, 2, 48, 1, 16, 1)) // Row 1, x 48-63 to frame 2
+      blitIdle(c)
+
+      def frame0(x: Int, y: Int): Int = {
+        val pixel = y * 64 + x
+        if (pixel >= 3 && pixel <= 12) 5
+        else if (pixel >= 113 && pixel <= 132) 7
+        else 0
+      }
+      expectPixels(scanFrame(c, 0))(frame0)
+      expectPixels(scanFrame(c, 1))(frame0)
+      expectPixels(scanFrame(c, 2))((x, y) => if (y == 1 && x >= 48) frame0(x, y) else 0)
+    }
+  }
+
+  it should "composite tiles and sprites over the framebuffer" in {
+    test(new VGAHarness).withAnnotations(annos) { c =>
+      setup(c)
+      write(c, UPLOAD_ADDR, 0)
+      write(c, BLIT, fill(4096, 1)) // Background of index 1
+      blitIdle(c)
+
+      // Patterns 1-3: left half of 2 (right half transparent), 3 but the
+      // first column, solid 4
+      write(c, TILE_ADDR, 8)
+      for (row <- Seq(0x00002222L, 0x33333330L, 0x44444444L); _ <- 0 until 8) {
+        write(c, TILE_DATA, row)
+      }
+      write(c, TILE_ADDR, 0x100 + 9) // Map cell (1, 1), all others pattern 0
+      write(c, TILE_DATA, 1)
+
+      def sprite(x: Int, y: Int, pattern: Int, enable: Boolean = true): Long =
+        (if (enable) 1L << 31 else 0L) | (pattern.toLong << 16) | ((y & 0xff).toLong << 8) | (x & 0xff)
+      write(c, SPRITE, sprite(20, 20, 2))
+      write(c, SPRITE + 4, sprite(16, 20, 3)) // Under sprite 0 at x 20-23
+      write(c, SPRITE + 8, sprite(40, 40, 3, enable = false))
+      write(c, SPRITE + 12, sprite(-4, -2, 3)) // Clipped at the top left
+
+      def inside(v: Int, from: Int): Boolean = v >= from && v < from + 8
+      expectPixels(scanFrame(c, 0, 1 << 10)) { (x, y) =>
+        if (inside(x, 20) && inside(y, 20) && x != 20) 3 // Sprite 0 but its clear column
+        else if (inside(x, 16) && inside(y, 20)) 4
+        else if (x < 4 && y < 6) 4
+        else if (inside(x, 8) && inside(y, 8) && x % 8 < 4) 2 // Tile cell (1, 1)
+        else 1
+      }
+    }
+  }
+
+  it should "interrupt the CPU through Top as a machine external interrupt" in {
+    test(new Top).withAnnotations(annos) { c =>
+      // The DMA done interrupt, which needs no pixel clock
+      val program = Map(
+        0x1000L -> 0x300002b7L, // lui   t0, 0x30000      VGA
+        0x1004L -> 0x00001337L, // lui   t1, 0x1
+        0x1008L -> 0x04030313L, // addi  t1, t1, 64
+        0x100cL -> 0x30531073L, // csrw  mtvec, t1        handler at 0x1040
+        0x1010L -> 0x20000313L, // li    t1, 0x200
+        0x1014L -> 0x0062a223L, // sw    t1, 4(t0)        CTRL: DMA done interrupt
+        0x1018L -> 0x00800313L, // li    t1, 8
+        0x101cL -> 0x30031073L, // csrw  mstatus, t1      MIE
+        0x1020L -> 0x00010337L, // lui   t1, 0x10
+        0x1024L -> 0x0062ae23L, // sw    t1, 28(t0)       DMA_CTRL: one word
+        0x1028L -> 0x0000006fL, // j     .
+        0x1040L -> 0x00200313L, // li    t1, 2
+        0x1044L -> 0x0062a623L, // sw    t1, 12(t0)       INTR_STATUS: clear
+        0x1048L -> 0x0000006fL  // j     .
+      )
+      def run(until: Long): Unit = {
+        var cycles = 0
+        while (c.io.instruction_address.peek().litValue != until) {
+          assert(cycles < 100, s"PC 0x${until.toHexString} not reached")
+          c.io.instruction.poke(program.getOrElse(c.io.instruction_address.peek().litValue.toLong, 0x13L).U)
+          c.clock.step()
+          cycles += 1
+        }
+      }
+
+      c.clock.setTimeout(0)
+      c.io.instruction_valid.poke(true.B)
+      c.io.interrupt_flag.poke(0.U)
+      c.io.memory_bundle.read_data.poke(0.U)
+      c.io.vga_dma_read_data.poke(0.U)
+      run(0x1040)
+      c.io.csr_regs_debug_read_address.poke(CSRRegister.MCAUSE)
+      c.io.csr_regs_debug_read_data.expect(0x8000000bL.U)
+      c.io.csr_regs_debug_read_address.poke(CSRRegister.MEPC)
+      c.io.csr_regs_debug_read_data.expect(0x1028.U)
+      c.io.csr_regs_debug_read_address.poke(CSRRegister.MSTATUS)
+      c.io.csr_regs_debug_read_data.expect(0x80.U) // MPIE set, MIE clear
+      run(0x1048)
+    }
+  }
+}
@@ -1,25 +1,52 @@
 #include <verilated.h>
+#include <verilated_syms.h>
+#if VM_TRACE
 #include <verilated_vcd_c.h>
+#endif
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "../../../common/verilator/rv32_backdoor.h"
+#include "../../../common/verilator/rv32_commit_log.h"
+#include "../../../common/verilator/rv32_lockstep.h"
+#include "../../../common/verilator/rv32_mem_trace.h"
+#include "../../../common/verilator/rv32_probe.h"
+#include "../../../common/verilator/rv32_profile.h"
+#include "../../../common/verilator/rv32_shared_memory.h"
 #include "VTop.h"  // From Verilating "top.v"
 
 #ifdef ENABLE_SDL2
 #include <SDL.h>
+
+#include <atomic>
+#include <exception>
+#include <thread>
 #endif
 
 class Memory
 {
-    std::vector<uint32_t> memory;
+    rv32::SharedMemory memory;
 
 public:
-    Memory(size_t size) : memory(size, 0) {}
+    Memory(size_t size, std::string const &shm_name = "")
+        : memory(size, shm_name)
+    {
+    }
+
+    rv32::SharedMemory &storage() { return memory; }
+
     uint32_t read(size_t address)
     {
         address = address / 4;
@@ -91,6 +118,7 @@ constexpr uint32_t DEVICE_MASK = (1u << DEVICE_SHIFT) - 1u;
 constexpr uint32_t UART_BASE = 0x40000000u;
 constexpr uint32_t TIMER_BASE = 0x80000000u;
 constexpr uint32_t VGA_BASE = 0x30000000u;
+constexpr uint32_t VGA_CTRL = 0x04;
 
 class TimerMMIO
 {
@@ -157,18 +185,26 @@ public:
     }
 };
 
-#ifdef ENABLE_SDL2
-class VGADisplay
+// 640x480 frames rebuilt from the VGA port, in BGRA (SDL's ARGB8888 on a
+// little-endian host), for -vga and -vga-capture. Sampling runs at the pixel
+// clock, so it only stores the 6-bit RRGGBB value into a line buffer; the
+// line is expanded to BGRA once, when the scan moves to the next one.
+class VGAScanout
 {
+public:
     static constexpr int H_RES = 640;
     static constexpr int V_RES = 480;
+    static constexpr size_t FRAME_BYTES = H_RES * V_RES * 4;
 
-    SDL_Window *window = nullptr;
-    SDL_Renderer *renderer = nullptr;
-    SDL_Texture *texture = nullptr;
-    std::vector<uint8_t> framebuffer;
+private:
+    uint8_t *framebuffer;
     bool prev_vsync = true;
-    bool should_quit = false;
+    uint8_t line[H_RES];
+    int line_y = -1;  // row being collected, -1 when none
+    int line_begin = 0;
+    int line_end = 0;
+    uint32_t palette[64];  // RRGGBB -> BGRA word
+    void (*convert)(uint32_t *, uint8_t const *, int, uint32_t const *);
 
     // Color conversion: 2-bit VGA channel → 8-bit RGB
     // Maps 2-bit color values to 8-bit with even spacing:
@@ -178,60 +214,88 @@ class VGADisplay
     //   0b11 → 255 (100%)
     static constexpr uint8_t vga2bit_to_8bit(uint8_t val) { return val * 85; }
 
-public:
-    VGADisplay() : framebuffer(H_RES * V_RES * 4, 0)  // BGRA format
+    static void convert_scalar(uint32_t *out,
+                               uint8_t const *in,
+                               int n,
+                               uint32_t const *palette)
     {
-        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-            throw std::runtime_error(std::string("SDL_Init failed: ") +
-                                     SDL_GetError());
-        }
-
-        window = SDL_CreateWindow(
-            "VGA Display - MyCPU", SDL_WINDOWPOS_UNDEFINED,
-            SDL_WINDOWPOS_UNDEFINED, H_RES, V_RES, SDL_WINDOW_SHOWN);
-        if (!window) {
-            SDL_Quit();
-            throw std::runtime_error(std::string("SDL_CreateWindow failed: ") +
-                                     SDL_GetError());
-        }
-        std::cout << "[SDL2] Window opened: 640x480 'VGA Display - MyCPU'"
-                  << std::endl;
-        std::cout << "[SDL2] Press ESC or close window to stop simulation early"
-                  << std::endl;
+        for (int i = 0; i < n; ++i)
+            out[i] = palette[in[i] & 63];
+    }
 
-        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-        if (!renderer) {
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            throw std::runtime_error(
-                std::string("SDL_CreateRenderer failed: ") + SDL_GetError());
+#if defined(__x86_64__) || defined(__i386__)
+    // 16 pixels per step: pshufb looks each channel up in a 4-entry table,
+    // then the B, G, R and A bytes are interleaved into BGRA words
+    __attribute__((target("ssse3"))) static void convert_ssse3(
+        uint32_t *out,
+        uint8_t const *in,
+        int n,
+        uint32_t const *palette)
+    {
+        __m128i const levels =
+            _mm_setr_epi8(0, 85, -86, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        __m128i const two_bits = _mm_set1_epi8(3);
+        __m128i const alpha = _mm_set1_epi8(-1);
+        int i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+            __m128i b = _mm_shuffle_epi8(levels, _mm_and_si128(v, two_bits));
+            __m128i g = _mm_shuffle_epi8(
+                levels, _mm_and_si128(_mm_srli_epi16(v, 2), two_bits));
+            __m128i r = _mm_shuffle_epi8(
+                levels, _mm_and_si128(_mm_srli_epi16(v, 4), two_bits));
+            __m128i bg_lo = _mm_unpacklo_epi8(b, g);
+            __m128i bg_hi = _mm_unpackhi_epi8(b, g);
+            __m128i ra_lo = _mm_unpacklo_epi8(r, alpha);
+            __m128i ra_hi = _mm_unpackhi_epi8(r, alpha);
+            auto *o = reinterpret_cast<__m128i *>(out + i);
+            _mm_storeu_si128(o, _mm_unpacklo_epi16(bg_lo, ra_lo));
+            _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+            _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+            _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
         }
+        convert_scalar(out + i, in + i, n - i, palette);
+    }
+#endif
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
+    void flush_line()
+    {
+        if (line_y < 0)
+            return;
+        auto *row = reinterpret_cast<uint32_t *>(framebuffer) + line_y * H_RES;
+        convert(row + line_begin, line + line_begin, line_end - line_begin,
+                palette);
+        line_y = -1;
+    }
 
-        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
-                                    SDL_TEXTUREACCESS_STREAMING, H_RES, V_RES);
-        if (!texture) {
-            SDL_DestroyRenderer(renderer);
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            throw std::runtime_error(std::string("SDL_CreateTexture failed: ") +
-                                     SDL_GetError());
-        }
+public:
+    static uint32_t to_bgra(uint8_t rrggbb)
+    {
+        uint8_t bgra[4] = {vga2bit_to_8bit(rrggbb & 0b11),         // B
+                           vga2bit_to_8bit((rrggbb >> 2) & 0b11),  // G
+                           vga2bit_to_8bit((rrggbb >> 4) & 0b11),  // R
+                           255};                                   // A
+        uint32_t word;
+        std::memcpy(&word, bgra, 4);
+        return word;
     }
 
-    ~VGADisplay()
+    explicit VGAScanout(uint8_t *framebuffer)
+        : framebuffer(framebuffer), convert(convert_scalar)
     {
-        if (texture)
-            SDL_DestroyTexture(texture);
-        if (renderer)
-            SDL_DestroyRenderer(renderer);
-        if (window)
-            SDL_DestroyWindow(window);
-        SDL_Quit();
+        for (int v = 0; v < 64; ++v)
+            palette[v] = to_bgra(v);
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("ssse3"))
+            convert = convert_ssse3;
+#endif
     }
 
+    // Draw the following frames into another buffer. Every active pixel is
+    // redrawn each frame, so it needs no clearing.
+    void retarget(uint8_t *buffer) { framebuffer = buffer; }
+
     // Update pixel using hardware-provided positions (Bug #6 fix)
     // Use x_pos/y_pos directly from VGA hardware instead of tracking with
     // hsync/vsync
@@ -243,47 +307,393 @@ public:
         // Use hardware-provided pixel positions (already aligned with VGA
         // timing)
         if (activevideo && x_pos < H_RES && y_pos < V_RES) {
-            int idx = (y_pos * H_RES + x_pos) * 4;
-            // Convert 2-bit per channel (RRGGBB) to 8-bit RGB
-            framebuffer[idx] = vga2bit_to_8bit(rrggbb & 0b11);             // B
-            framebuffer[idx + 1] = vga2bit_to_8bit((rrggbb >> 2) & 0b11);  // G
-            framebuffer[idx + 2] = vga2bit_to_8bit((rrggbb >> 4) & 0b11);  // R
-            framebuffer[idx + 3] = 255;                                    // A
+            if (y_pos != line_y) {
+                flush_line();
+                line_y = y_pos;
+                line_begin = x_pos;
+            }
+            line[x_pos] = rrggbb;
+            line_end = x_pos + 1;
         }
     }
 
-    // Detect vsync falling edge to trigger frame rendering
-    void check_vsync(bool vsync)
+    // Vsync falling edge indicates frame complete
+    bool frame_done(bool vsync)
     {
-        // Vsync falling edge indicates frame complete
-        if (!vsync && prev_vsync)
-            render();
+        bool done = !vsync && prev_vsync;
         prev_vsync = vsync;
+        if (done)
+            flush_line();
+        return done;
     }
+};
+
+// Frames drawn straight from the VGA module's state for -vga-snapshot,
+// instead of rebuilding them from the port at the pixel clock. The
+// framebuffer and tile RAMs, palette, tile map, sprites and CTRL register are
+// read through public signals (vga.vlt, needs --vpi); the selected 64x64 frame
+// is composited with the tile and sprite layer and scaled the way the pixel
+// pipeline does it, into the same 320x240 area VGAScanout fills.
+class VGASnapshot
+{
+    // VGA.scala geometry
+    static constexpr int ACTIVE_W = 320;
+    static constexpr int ACTIVE_H = 240;
+    static constexpr int FRAME_SIZE = 64;
+    static constexpr int DISPLAY_SIZE = FRAME_SIZE * 3;
+    static constexpr int LEFT_MARGIN = (ACTIVE_W - DISPLAY_SIZE) / 2;
+    static constexpr int TOP_MARGIN = (ACTIVE_H - DISPLAY_SIZE) / 2;
+    static constexpr int WORDS_PER_FRAME = FRAME_SIZE * FRAME_SIZE / 8;
+    static constexpr int TILE_MAP_SIZE = FRAME_SIZE / 8;
+    static constexpr int NUM_SPRITES = 4;
+
+    IData const *mem;    // TrueDualPortRAM32 words, 12 frames
+    IData const *tiles;  // 32 patterns of 8 rows
+    IData const *ctrl;
+    CData const *palette[16];
+    CData const *tile_map[TILE_MAP_SIZE * TILE_MAP_SIZE];
+    IData const *sprite[NUM_SPRITES];
+    uint8_t frame_coord[DISPLAY_SIZE];  // display offset -> frame x or y
+
+    static void *find(std::string const &scope,
+                      std::string const &name,
+                      int vltype)
+    {
+        const VerilatedScope *scopep =
+            Verilated::threadContextp()->scopeFind(scope.c_str());
+        VerilatedVar *varp = scopep ? scopep->varFind(name.c_str()) : nullptr;
+        if (!varp || varp->vltype() != vltype)
+            throw std::runtime_error(
+                "No public signal " + scope + "." + name +
+                " (Verilate the model with vga.vlt and --vpi)");
+        return varp->datap();
+    }
+
+public:
+    // One frame of the raster (H_TOTAL x V_TOTAL pixel clocks)
+    static constexpr uint64_t FRAME_CYCLES = 416 * 260;
 
-    // Render framebuffer to SDL window
-    void render()
+    explicit VGASnapshot(std::string const &vga = "TOP.Top.vga")
     {
-        // Handle SDL events
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT)
-                should_quit = true;
-            // Support ESC key to quit as well
-            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
-                should_quit = true;
+        mem = static_cast<IData const *>(
+            find(vga + ".framebuffer", "mem", VLVT_UINT32));
+        tiles = static_cast<IData const *>(
+            find(vga + ".tiles", "mem", VLVT_UINT32));
+        ctrl = static_cast<IData const *>(find(vga, "ctrlReg", VLVT_UINT32));
+        for (int i = 0; i < 16; ++i)
+            palette[i] = static_cast<CData const *>(
+                find(vga, "paletteReg_" + std::to_string(i), VLVT_UINT8));
+        for (int i = 0; i < TILE_MAP_SIZE * TILE_MAP_SIZE; ++i)
+            tile_map[i] = static_cast<CData const *>(
+                find(vga, "tileMapReg_" + std::to_string(i), VLVT_UINT8));
+        for (int i = 0; i < NUM_SPRITES; ++i)
+            sprite[i] = static_cast<IData const *>(
+                find(vga, "spriteReg_" + std::to_string(i), VLVT_UINT32));
+        // Same x * 21845 >> 16 division by 3 as the RTL, clamped to 63
+        for (int d = 0; d < DISPLAY_SIZE; ++d)
+            frame_coord[d] = std::min((d * 21845 >> 16) & 0xff, FRAME_SIZE - 1);
+    }
+
+    void render(uint8_t *framebuffer) const
+    {
+        uint32_t control = *ctrl;
+        bool enabled = control & 1;
+        bool blank = control & 2;
+        // CTRL writes selecting a frame past the 12th are dropped
+        IData const *frame = mem + ((control >> 4) & 0xf) * WORDS_PER_FRAME;
+        uint32_t colors[16];
+        for (int i = 0; i < 16; ++i)
+            colors[i] = VGAScanout::to_bgra(blank ? 0 : *palette[i] & 63);
+        uint32_t background = VGAScanout::to_bgra(blank ? 0 : 0x01);
+
+        // Palette indices after the tile and sprite layer, as composited
+        // by the pixel pipeline before its palette lookup
+        uint8_t pixels[FRAME_SIZE][FRAME_SIZE];
+        bool tiles_on = control & (1 << 10);
+        for (int fy = 0; fy < FRAME_SIZE; ++fy) {
+            for (int fx = 0; fx < FRAME_SIZE; ++fx) {
+                int map = (fy >> 3) * TILE_MAP_SIZE + (fx >> 3);
+                uint32_t row = tiles[(*tile_map[map] & 31) * 8 + (fy & 7)];
+                uint32_t word = frame[fy * FRAME_SIZE / 8 + (fx >> 3)];
+                int index = tiles_on ? row >> 4 * (fx & 7) & 0xf : 0;
+                if (!index)
+                    index = word >> 4 * (fx & 7) & 0xf;
+                for (int i = NUM_SPRITES - 1; i >= 0; --i) {
+                    uint32_t s = *sprite[i];
+                    // 8-bit coordinates wrap, so negative ones work
+                    int column = (fx - s) & 0xff;
+                    int line = (fy - (s >> 8)) & 0xff;
+                    if (!(s >> 31) || column >= 8 || line >= 8)
+                        continue;
+                    uint32_t bits = tiles[(s >> 16 & 31) * 8 + line];
+                    int pixel = bits >> 4 * column & 0xf;
+                    if (pixel)
+                        index = pixel;
+                }
+                pixels[fy][fx] = index;
+            }
+        }
+
+        auto *out = reinterpret_cast<uint32_t *>(framebuffer);
+        for (int y = 0; y < ACTIVE_H; ++y) {
+            uint32_t *row = out + y * VGAScanout::H_RES;
+            std::fill(row, row + ACTIVE_W, background);
+            int dy = y - TOP_MARGIN;
+            if (!enabled || blank || dy < 0 || dy >= DISPLAY_SIZE)
+                continue;
+            uint8_t const *line = pixels[frame_coord[dy]];
+            for (int dx = 0; dx < DISPLAY_SIZE; ++dx)
+                row[LEFT_MARGIN + dx] = colors[line[frame_coord[dx]]];
+        }
+    }
+};
+
+// Headless frame capture: prints a 64-bit hash of every frame, so a visual
+// regression is a diff of the hash lines, and optionally keeps the frames,
+// as one PPM per frame in a directory or as a raw RGB24 stream (a target
+// ending in .rgb; ffmpeg -f rawvideo -pix_fmt rgb24 -s 640x480 reads it)
+class VGACapture
+{
+    std::vector<uint8_t> framebuffer;  // scanout target without a window
+    std::string directory;
+    std::ofstream stream;
+    std::vector<uint8_t> rgb;
+    uint64_t frames = 0;
+
+    void to_rgb(uint8_t const *bgra)
+    {
+        for (size_t i = 0, o = 0; i < VGAScanout::FRAME_BYTES; i += 4) {
+            rgb[o++] = bgra[i + 2];
+            rgb[o++] = bgra[i + 1];
+            rgb[o++] = bgra[i];
         }
+    }
 
-        // Upload framebuffer to texture and display
-        SDL_UpdateTexture(texture, nullptr, framebuffer.data(), H_RES * 4);
-        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-        SDL_RenderPresent(renderer);
+public:
+    // 64-bit multiply-xorshift over 8-byte words; only needs to be stable
+    // and quick (~0.1 ms per frame), not cryptographic
+    static uint64_t hash(uint8_t const *data, size_t size)
+    {
+        uint64_t h = 0x6A09E667F3BCC908ull ^ size;
+        for (size_t i = 0; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+        }
+        for (size_t i = size & ~size_t(7); i < size; ++i)
+            h = (h ^ data[i]) * 0x100000001B3ull;
+        return h ^ (h >> 32);
     }
 
-    bool quit_requested() const { return should_quit; }
+    // target: "hash" for hashes only, a .rgb file, or a directory
+    explicit VGACapture(std::string const &target)
+        : framebuffer(VGAScanout::FRAME_BYTES, 0)
+    {
+        if (target == "hash")
+            return;
+        rgb.resize(VGAScanout::H_RES * VGAScanout::V_RES * 3);
+        if (target.size() > 4 && target.compare(target.size() - 4, 4,
+                                                ".rgb") == 0) {
+            stream.open(target, std::ios::binary);
+            if (!stream)
+                throw std::runtime_error("Could not open " + target);
+            return;
+        }
+        directory = target;
+        std::filesystem::create_directories(directory);
+    }
+
+    uint8_t *buffer() { return framebuffer.data(); }
+    uint64_t captured() const { return frames; }
+
+    void capture(uint8_t const *bgra, uint64_t cycle)
+    {
+        uint64_t h = hash(bgra, VGAScanout::FRAME_BYTES);
+        char line[80];
+        snprintf(line, sizeof(line), "VGA frame %llu at cycle %llu: %016llx",
+                 (unsigned long long) frames, (unsigned long long) cycle,
+                 (unsigned long long) h);
+        std::cout << line << std::endl;
+        if (!rgb.empty())
+            to_rgb(bgra);
+        if (stream.is_open()) {
+            stream.write(reinterpret_cast<char const *>(rgb.data()),
+                         rgb.size());
+        } else if (!directory.empty()) {
+            char name[32];
+            snprintf(name, sizeof(name), "/frame_%05llu.ppm",
+                     (unsigned long long) frames);
+            std::ofstream ppm(directory + name, std::ios::binary);
+            ppm << "P6\n"
+                << VGAScanout::H_RES << " " << VGAScanout::V_RES << "\n255\n";
+            ppm.write(reinterpret_cast<char const *>(rgb.data()), rgb.size());
+            if (!ppm)
+                throw std::runtime_error("Could not write " + directory +
+                                         name);
+        }
+        ++frames;
+    }
+};
+
+#ifdef ENABLE_SDL2
+// Lock-free single-producer, single-consumer handoff of whole frames: the
+// producer fills its back buffer and swaps it with the middle one, the
+// consumer swaps the middle one for its front buffer when a newer frame is
+// there. Neither side ever waits; frames the consumer is too slow for are
+// overwritten in the middle buffer.
+template <typename Frame>
+class TripleBuffer
+{
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;  // middle holds an unread frame
+
+    Frame frames[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;   // producer's
+    uint8_t front = 2;  // consumer's
+
+public:
+    explicit TripleBuffer(Frame const &initial)
+        : frames{initial, initial, initial}
+    {
+    }
+
+    Frame &back_buffer() { return frames[back]; }
+
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) &
+               INDEX;
+    }
+
+    // The newest published frame, or nullptr if none since the last call
+    Frame const *acquire()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return nullptr;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return &frames[front];
+    }
+};
+
+// Window on the VGA output. SDL belongs to the main thread (macOS only
+// delivers window events there), so with a window the simulation runs on a
+// worker thread: it only writes pixels into a frame and publishes it on vsync,
+// while the main thread presents the frames and turns window events into the
+// quit flag. Neither event handling nor a present that waits for the
+// monitor's vsync stalls the RTL.
+class VGADisplay
+{
+    static constexpr int H_RES = VGAScanout::H_RES;
+    static constexpr int V_RES = VGAScanout::V_RES;
+
+    using Frame = std::vector<uint8_t>;
+
+    TripleBuffer<Frame> frames;
+    std::atomic<bool> should_quit{false};
+    std::atomic<bool> stopping{false};
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    SDL_Texture *texture = nullptr;
+
+    void cleanup()
+    {
+        if (texture)
+            SDL_DestroyTexture(texture);
+        if (renderer)
+            SDL_DestroyRenderer(renderer);
+        if (window)
+            SDL_DestroyWindow(window);
+        SDL_Quit();
+    }
+
+    [[noreturn]] void fail(char const *what)
+    {
+        std::string message = std::string(what) + " failed: " +
+                              SDL_GetError();
+        cleanup();
+        throw std::runtime_error(message);
+    }
+
+public:
+    // Opens the window; construct on the main thread
+    VGADisplay() : frames(Frame(VGAScanout::FRAME_BYTES, 0))  // BGRA format
+    {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0)
+            fail("SDL_Init");
+        window = SDL_CreateWindow(
+            "VGA Display - MyCPU", SDL_WINDOWPOS_UNDEFINED,
+            SDL_WINDOWPOS_UNDEFINED, H_RES, V_RES, SDL_WINDOW_SHOWN);
+        if (!window)
+            fail("SDL_CreateWindow");
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        if (!renderer)
+            fail("SDL_CreateRenderer");
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+        SDL_RenderClear(renderer);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_STREAMING, H_RES, V_RES);
+        if (!texture)
+            fail("SDL_CreateTexture");
+        std::cout << "[SDL2] Window opened: 640x480 'VGA Display - MyCPU'"
+                  << std::endl;
+        std::cout << "[SDL2] Press ESC or close window to stop simulation early"
+                  << std::endl;
+    }
+
+    ~VGADisplay() { cleanup(); }
+
+    // Main thread: present frames and handle events until stop(), then
+    // present whatever was published last
+    void show()
+    {
+        bool last = false;
+        while (!last) {
+            last = stopping.load(std::memory_order_acquire);
+            SDL_Event e;
+            // Sleep until an event arrives, but look for frames every 2 ms
+            if (!last && SDL_WaitEventTimeout(&e, 2)) {
+                do {
+                    if (e.type == SDL_QUIT)
+                        should_quit = true;
+                    // Support ESC key to quit as well
+                    if (e.type == SDL_KEYDOWN &&
+                        e.key.keysym.sym == SDLK_ESCAPE)
+                        should_quit = true;
+                } while (SDL_PollEvent(&e));
+            }
+            if (Frame const *frame = frames.acquire()) {
+                // Upload framebuffer to texture and display
+                SDL_UpdateTexture(texture, nullptr, frame->data(), H_RES * 4);
+                SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+                SDL_RenderPresent(renderer);
+            }
+        }
+    }
+
+    // Simulation thread: make show() return
+    void stop() { stopping.store(true, std::memory_order_release); }
+
+    // Frame the simulation draws into next
+    uint8_t *back_buffer() { return frames.back_buffer().data(); }
+
+    // Hand the frame drawn so far to the main thread; returns the buffer
+    // for the next one
+    uint8_t *publish()
+    {
+        frames.publish();
+        return back_buffer();
+    }
+
+    bool quit_requested() const
+    {
+        return should_quit.load(std::memory_order_relaxed);
+    }
 };
 #endif
 
+#if VM_TRACE
 class VCDTracer
 {
     VerilatedVcdC *tfp = nullptr;
@@ -317,6 +727,20 @@ public:
         }
     }
 };
+#else
+// Model built without --trace (e.g. benchmark builds): nothing to dump
+class VCDTracer
+{
+public:
+    void enable(std::string const &filename, VTop &)
+    {
+        throw std::runtime_error("Cannot write " + filename +
+                                 ": model was built without --trace");
+    }
+
+    void dump(vluint64_t) {}
+};
+#endif
 
 uint32_t parse_number(std::string const &str)
 {
@@ -328,27 +752,208 @@ uint32_t parse_number(std::string const &str)
     return std::stoul(str);
 }
 
+// Top-level ports -probe can sample
+rv32::ProbePorts probe_ports(VTop const &top)
+{
+    rv32::ProbePorts ports;
+#define PROBE(port) ports.add(#port, &top.port)
+    PROBE(io_instruction_address);
+    PROBE(io_instruction);
+    PROBE(io_instruction_valid);
+    PROBE(io_memory_bundle_address);
+    PROBE(io_memory_bundle_read_data);
+    PROBE(io_memory_bundle_write_data);
+    PROBE(io_memory_bundle_write_enable);
+    PROBE(io_memory_bundle_write_strobe_0);
+    PROBE(io_memory_bundle_write_strobe_1);
+    PROBE(io_memory_bundle_write_strobe_2);
+    PROBE(io_memory_bundle_write_strobe_3);
+    PROBE(io_deviceSelect);
+    PROBE(io_interrupt_flag);
+    PROBE(io_vga_pixclk);
+    PROBE(io_vga_hsync);
+    PROBE(io_vga_vsync);
+    PROBE(io_vga_activevideo);
+    PROBE(io_vga_x_pos);
+    PROBE(io_vga_y_pos);
+    PROBE(io_vga_rrggbb);
+    PROBE(io_vga_dma_address);
+    PROBE(io_vga_dma_read);
+    PROBE(io_retire_valid);
+    PROBE(io_retire_pc);
+    PROBE(io_retire_instruction);
+    PROBE(io_retire_rd_address);
+    PROBE(io_retire_rd_data);
+    PROBE(io_retire_memory_address);
+    PROBE(io_retire_memory_read);
+    PROBE(io_retire_memory_read_data);
+    PROBE(io_retire_memory_write_data);
+    PROBE(io_retire_memory_write_strobe);
+    PROBE(io_retire_trap);
+    PROBE(io_retire_interrupt);
+#undef PROBE
+    return ports;
+}
+
+// Reference model view of the MMIO map in Simulator::run: device 0 is
+// memory, device stores never reach it and device reads (timer, UART, VGA)
+// are taken from the RTL. While fast-forwarding the model drives the UART
+// and timer itself; VGA registers and framebuffer live in the RTL and miss
+// whatever the skipped instructions wrote to them.
+struct IssBus
+{
+    rv32::SparseMemory memory;
+    UartMMIO *uart = nullptr;
+    TimerMMIO *timer = nullptr;
+
+    IssBus(size_t words) : memory(words) {}
+
+    uint32_t fetch(uint32_t address) { return memory.read(address); }
+
+    uint32_t load(uint32_t address, bool &device)
+    {
+        device = (address >> DEVICE_SHIFT) != 0;
+        if (!device)
+            return memory.read(address);
+        if (uart && (address & 0xF0000000u) == UART_BASE)
+            return uart->read(address - UART_BASE);
+        if (timer && (address & 0xF0000000u) == TIMER_BASE)
+            return timer->read(address - TIMER_BASE);
+        return 0;
+    }
+
+    void store(uint32_t address, uint32_t data, uint32_t mask)
+    {
+        if ((address >> DEVICE_SHIFT) == 0)
+            memory.write(address, data, mask);
+        else if (uart && (address & 0xF0000000u) == UART_BASE)
+            uart->write(address - UART_BASE, data);
+        else if (timer && (address & 0xF0000000u) == TIMER_BASE)
+            timer->write(address - TIMER_BASE, data);
+    }
+};
+
+// Independent clocks on one timeline in picoseconds. advance() jumps to the
+// next edge of any clock and toggles every clock that has an edge there, so
+// the model is only evaluated when a clock actually changes, and clocks whose
+// edges coincide change in the same evaluation.
+class ClockWheel
+{
+    struct Clock
+    {
+        uint64_t half_period;
+        uint64_t next_edge;
+        bool level;
+    };
+    std::vector<Clock> clocks;
+    uint64_t now = 0;
+
+public:
+    static uint64_t half_period_ps(double mhz)
+    {
+        if (!(mhz > 0))
+            throw std::runtime_error("Clock frequency must be positive");
+        return std::max<uint64_t>(1, std::llround(500000.0 / mhz));
+    }
+
+    // A clock that starts low now; returns its bit in advance()'s result
+    uint32_t add(uint64_t half_period)
+    {
+        clocks.push_back({half_period, now + half_period, false});
+        return 1u << (clocks.size() - 1);
+    }
+
+    uint64_t time() const { return now; }
+
+    bool level(uint32_t clock) const
+    {
+        return clocks[__builtin_ctz(clock)].level;
+    }
+
+    // Move to the next edge; returns the bits of the clocks that toggled
+    uint32_t advance()
+    {
+        now = UINT64_MAX;
+        for (Clock const &c : clocks)
+            now = std::min(now, c.next_edge);
+        uint32_t edges = 0;
+        for (size_t i = 0; i < clocks.size(); ++i) {
+            if (clocks[i].next_edge == now) {
+                clocks[i].level = !clocks[i].level;
+                clocks[i].next_edge += clocks[i].half_period;
+                edges |= 1u << i;
+            }
+        }
+        return edges;
+    }
+};
+
 class Simulator
 {
-    vluint64_t main_time = 0;
-    vluint64_t max_sim_time = 10000;
+    vluint64_t max_sim_time = 10000;  // quarter system clock periods
+    double sysclk_mhz = 50;
+    double pixclk_mhz = 31.5;
     uint32_t halt_address = 0;
     size_t memory_words = 1024 * 1024;  // 4MB
     bool dump_vcd = false;
     std::unique_ptr<VTop> top;
     std::unique_ptr<VCDTracer> vcd_tracer;
     std::unique_ptr<Memory> memory;
+    std::string shm_name;
+    rv32::SharedMemory *shared_memory = nullptr;
     bool dump_signature = false;
     unsigned long signature_begin, signature_end;
     std::string signature_filename;
     std::string instruction_filename;
     TimerMMIO timer;
     UartMMIO uart;
+    uint32_t data_memory_read_word = 0;
+    uint32_t inst_memory_read_word = 0;
+    uint32_t dma_read_word = 0;
+    bool check_iss = false;
+    std::unique_ptr<IssBus> iss_bus;
+    std::unique_ptr<rv32::Hart<IssBus>> iss;
+    std::unique_ptr<rv32::LockstepChecker<IssBus>> iss_checker;
+    uint32_t last_retired_pc = 0;  // where the next interrupt is taken
+    bool fast_forward = false;
+    uint64_t ff_instructions = UINT64_MAX;
+    bool has_ff_until = false;
+    uint32_t ff_until = 0;
+    uint64_t ff_retired = 0;
+    uint64_t warmup_cycles = 0;
+    uint64_t warmup_instret = 0;
+    std::string commit_log_filename;
+    std::unique_ptr<rv32::CommitLogWriter> commit_log;
+    std::string profile_filename;
+    std::string elf_filename;
+    std::unique_ptr<rv32::Profiler> profiler;
+    std::string mem_trace_filename;
+    std::unique_ptr<rv32::MemTraceWriter> mem_trace;
+    std::string probe_filename;
+    std::string probe_signals = "*";
+    uint64_t probe_interval = 1;
+    std::unique_ptr<rv32::ProbeWriter> probes;
+    std::unique_ptr<VGAScanout> vga;  // frames for -vga and -vga-capture
+    std::unique_ptr<VGASnapshot> vga_snapshot;  // or drawn from RTL state
+    uint64_t vga_snapshot_cycles = 0;  // one pixel clock frame by default
+    bool use_vga_snapshot = false;
+    bool stub_vga_pixclk = false;
+    uint8_t *vga_frame = nullptr;  // buffer the next frame is drawn into
+    std::string vga_capture_target;
+    std::unique_ptr<VGACapture> vga_capture;
 #ifdef ENABLE_SDL2
     std::unique_ptr<VGADisplay> vga_display;
     bool enable_vga = false;
     uint64_t last_render_time = 0;
+    bool vga_pixclk = true;  // the SDL2 build always clocks the VGA
+#else
+    bool vga_pixclk = false;
 #endif
+    // VGA CTRL as written by software: a vblank interrupt enable starts the
+    // pixel clock even headless, frame select changes count as page flips
+    bool vga_vblank_ie = false;
+    uint32_t vga_frame_sel = 0;
+    uint64_t vga_frame_flips = 0;
 
 public:
     void parse_args(std::vector<std::string> const &args)
@@ -365,6 +970,15 @@ public:
         if (it != args.end())
             max_sim_time = std::stoull(*(it + 1));
 
+        // Clock frequencies; the pixel clock runs on its own edges
+        it = std::find(args.begin(), args.end(), "-sysclk-mhz");
+        if (it != args.end())
+            sysclk_mhz = std::stod(*(it + 1));
+
+        it = std::find(args.begin(), args.end(), "-pixclk-mhz");
+        if (it != args.end())
+            pixclk_mhz = std::stod(*(it + 1));
+
         it = std::find(args.begin(), args.end(), "-vcd");
         if (it != args.end())
             vcd_tracer->enable(*(it + 1), *top);
@@ -381,6 +995,103 @@ public:
         if (it != args.end())
             instruction_filename = *(it + 1);
 
+        // Guest memory in /dev/shm/NAME (or a memfd for memfd:NAME) that
+        // tools map while the core runs (scripts/guestmem.py)
+        it = std::find(args.begin(), args.end(), "-shm");
+        if (it != args.end())
+            shm_name = *(it + 1);
+
+        // Check every register write and store against the built-in ISS
+        it = std::find(args.begin(), args.end(), "-iss");
+        if (it != args.end())
+            check_iss = true;
+
+        // Run the first N instructions, or up to a PC, on the ISS and then
+        // continue on the core; -warmup cycles are left out of the statistics
+        it = std::find(args.begin(), args.end(), "-ff");
+        if (it != args.end()) {
+            fast_forward = true;
+            ff_instructions = std::stoull(*(it + 1));
+        }
+
+        it = std::find(args.begin(), args.end(), "-ff-until");
+        if (it != args.end()) {
+            fast_forward = true;
+            has_ff_until = true;
+            ff_until = parse_number(*(it + 1));
+        }
+
+        it = std::find(args.begin(), args.end(), "-warmup");
+        if (it != args.end())
+            warmup_cycles = std::stoull(*(it + 1));
+
+        // Binary log of every retired instruction (scripts/commitlog.py)
+        it = std::find(args.begin(), args.end(), "-commit-log");
+        if (it != args.end()) {
+            commit_log_filename = *(it + 1);
+            commit_log =
+                std::make_unique<rv32::CommitLogWriter>(commit_log_filename);
+        }
+
+        // Cycles per PC, function and call path; -elf names them
+        it = std::find(args.begin(), args.end(), "-profile");
+        if (it != args.end()) {
+            profile_filename = *(it + 1);
+            profiler = std::make_unique<rv32::Profiler>();
+        }
+
+        it = std::find(args.begin(), args.end(), "-elf");
+        if (it != args.end())
+            elf_filename = *(it + 1);
+
+        // Fetch and data access stream for tools/cachesim
+        it = std::find(args.begin(), args.end(), "-mem-trace");
+        if (it != args.end()) {
+            mem_trace_filename = *(it + 1);
+            mem_trace =
+                std::make_unique<rv32::MemTraceWriter>(mem_trace_filename);
+        }
+
+        // Columns of port values (scripts/probes.py); -probe-signals takes
+        // comma-separated names or patterns such as io_vga_*
+        it = std::find(args.begin(), args.end(), "-probe-signals");
+        if (it != args.end())
+            probe_signals = *(it + 1);
+
+        it = std::find(args.begin(), args.end(), "-probe-interval");
+        if (it != args.end())
+            probe_interval = std::stoull(*(it + 1));
+
+        it = std::find(args.begin(), args.end(), "-probe");
+        if (it != args.end()) {
+            probe_filename = *(it + 1);
+            probes = std::make_unique<rv32::ProbeWriter>(
+                probe_filename, probe_ports(*top).select(probe_signals),
+                probe_interval);
+        }
+
+        // Headless frames: per-frame hashes, plus PPMs in a directory or an
+        // RGB24 stream for a target ending in .rgb ("hash": hashes only)
+        it = std::find(args.begin(), args.end(), "-vga-capture");
+        if (it != args.end())
+            vga_capture_target = *(it + 1);
+
+        // Draw frames from the framebuffer RAM and palette every N system
+        // clock cycles (default one frame) instead of sampling the VGA port
+        it = std::find(args.begin(), args.end(), "-vga-snapshot");
+        if (it != args.end())
+            use_vga_snapshot = true;
+
+        it = std::find(args.begin(), args.end(), "-vga-snapshot-cycles");
+        if (it != args.end())
+            vga_snapshot_cycles = std::stoull(*(it + 1));
+
+        // Snapshots with the pixel clock held low: the raster, VGA_STATUS
+        // vblank and the vblank interrupt stop
+        it = std::find(args.begin(), args.end(), "-vga-no-pixclk");
+        if (it != args.end())
+            use_vga_snapshot = stub_vga_pixclk = true;
+
 #ifdef ENABLE_SDL2
         it = std::find(args.begin(), args.end(), "-vga");
         if (it != args.end())
@@ -393,125 +1104,341 @@ public:
           vcd_tracer(std::make_unique<VCDTracer>())
     {
         parse_args(args);
-        memory = std::make_unique<Memory>(memory_words);
+        memory = std::make_unique<Memory>(memory_words, shm_name);
+        if (memory->storage().shared()) {
+            shared_memory = &memory->storage();
+            std::cerr << "Guest memory shared at " << shared_memory->path()
+                      << std::endl;
+        }
         if (!instruction_filename.empty())
             memory->load_binary(instruction_filename);
+        if (check_iss || fast_forward) {
+            iss_bus = std::make_unique<IssBus>(memory_words);
+            if (!instruction_filename.empty())
+                iss_bus->memory.load_binary(instruction_filename);
+            iss = std::make_unique<rv32::Hart<IssBus>>(*iss_bus);
+        }
+        if (check_iss)
+            iss_checker =
+                std::make_unique<rv32::LockstepChecker<IssBus>>(*iss);
+        if (!vga_capture_target.empty())
+            vga_capture = std::make_unique<VGACapture>(vga_capture_target);
 #ifdef ENABLE_SDL2
-        if (enable_vga)
+        if (enable_vga) {
             vga_display = std::make_unique<VGADisplay>();
+            vga_frame = vga_display->back_buffer();
+        }
 #endif
+        if (vga_capture && !vga_frame)
+            vga_frame = vga_capture->buffer();
+        if (vga_frame && use_vga_snapshot)
+            vga_snapshot = std::make_unique<VGASnapshot>();
+        else if (vga_frame)
+            vga = std::make_unique<VGAScanout>(vga_frame);
+        if (vga_frame)
+            vga_pixclk = true;
+        if (stub_vga_pixclk)
+            vga_pixclk = false;
+        if (!vga_snapshot_cycles)
+            vga_snapshot_cycles =
+                std::llround(VGASnapshot::FRAME_CYCLES * sysclk_mhz /
+                             pixclk_mhz);
     }
 
-    void run()
+    // A whole frame has been drawn: hash or save it, then show it
+    void end_vga_frame(uint64_t cycle)
     {
-        top->reset = 1;
-        top->clock = 0;
-        top->io_instruction_valid = 1;
+        if (vga_capture)
+            vga_capture->capture(vga_frame, cycle);
 #ifdef ENABLE_SDL2
-        // VGA pixel clock (drive with system clock for simplicity)
-        top->io_vga_pixclk = 0;
+        if (vga_display)
+            vga_frame = vga_display->publish();
 #endif
+        if (vga)
+            vga->retarget(vga_frame);
+    }
+
+    // Feed the results the core retires this cycle to the ISS checker; called
+    // just before the rising edge, while the write ports are settled
+    bool check_retired(uint64_t cycle)
+    {
+        if (top->io_retire_valid) {
+            // The first instruction of a handler: the model takes the
+            // interrupt after the instruction retired before it. The harness
+            // drives no interrupt lines, so this is the VGA's machine
+            // external interrupt.
+            if (top->io_retire_interrupt &&
+                !iss_checker->interrupt(cycle, last_retired_pc, 0x8000000B))
+                return false;
+            last_retired_pc = top->io_retire_pc;
+        }
+        if (top->io_regs_debug_write_enable &&
+            top->io_regs_debug_write_address != 0 &&
+            !iss_checker->reg_write(cycle, top->io_regs_debug_write_address,
+                                    top->io_regs_debug_write_data))
+            return false;
+        if (top->io_memory_bundle_write_enable) {
+            uint32_t mask = 0;
+            if (top->io_memory_bundle_write_strobe_0)
+                mask |= 0x000000FF;
+            if (top->io_memory_bundle_write_strobe_1)
+                mask |= 0x0000FF00;
+            if (top->io_memory_bundle_write_strobe_2)
+                mask |= 0x00FF0000;
+            if (top->io_memory_bundle_write_strobe_3)
+                mask |= 0xFF000000;
+            uint32_t address = (top->io_deviceSelect << DEVICE_SHIFT) |
+                               (top->io_memory_bundle_address & DEVICE_MASK);
+            return iss_checker->store(cycle, address,
+                                      top->io_memory_bundle_write_data, mask);
+        }
+        return true;
+    }
+
+    // Run the program on the ISS up to the switch point, then copy memory
+    // into the harness and registers, CSRs and PC into the core. Called while
+    // the core sits in reset.
+    void run_fast_forward()
+    {
+        iss_bus->uart = &uart;
+        iss_bus->timer = &timer;
+        while (ff_retired < ff_instructions &&
+               !(has_ff_until && iss->pc == ff_until)) {
+            rv32::Retired r = iss->step();
+            ++ff_retired;
+            // Nothing left to skip once the program has finished
+            if (rv32::parked(*iss, r))
+                break;
+        }
+        iss_bus->uart = nullptr;
+        iss_bus->timer = nullptr;
+        if (has_ff_until && iss->pc != ff_until)
+            std::cout << "Fast-forward: PC 0x" << std::hex << ff_until
+                      << " not reached" << std::dec << std::endl;
+
+        bool strobe[4] = {true, true, true, true};
+        iss_bus->memory.for_each_word([&](uint32_t address, uint32_t word) {
+            memory->write(address, word, strobe);
+        });
+        rv32::Backdoor("TOP.Top.cpu").load(*iss);
+        std::cout << "Fast-forward: " << ff_retired
+                  << " instructions on the ISS, switching to RTL at PC 0x"
+                  << std::hex << iss->pc << std::dec << std::endl;
+    }
+
+    // Evaluate with the bus answers to the previous evaluation's requests
+    void eval()
+    {
+        top->io_memory_bundle_read_data = data_memory_read_word;
+        top->io_instruction = inst_memory_read_word;
+        top->io_vga_dma_read_data = dma_read_word;
         top->eval();
-        vcd_tracer->dump(main_time);
-        uint32_t data_memory_read_word = 0;
-        uint32_t inst_memory_read_word = 0;
-        uint32_t timer_interrupt = 0;
-        uint32_t counter = 0;
-        uint32_t clocktime = 1;
-        bool memory_write_strobe[4] = {false};
-        while (main_time < max_sim_time && !Verilated::gotFinish()) {
-            ++main_time;
-            ++counter;
-            if (counter > clocktime) {
-                top->clock = !top->clock;
-                counter = 0;
-            }
-            if (main_time > 2)
-                top->reset = 0;
-            // top->io_mem_slave_read_data = memory_read_word;
-            top->io_memory_bundle_read_data = data_memory_read_word;
-            top->io_instruction = inst_memory_read_word;
-#ifdef ENABLE_SDL2
-            // Toggle VGA pixel clock (synchronized with system clock)
-            top->io_vga_pixclk = top->clock;
-#endif
-            top->eval();
-            top->io_interrupt_flag = 0;
-
-            uint32_t device_select = top->io_deviceSelect;
-            uint32_t low_address = top->io_memory_bundle_address & DEVICE_MASK;
-            uint32_t effective_address =
-                (device_select << DEVICE_SHIFT) | low_address;
-            bool is_uart = (effective_address & 0xF0000000u) == UART_BASE;
-            bool is_timer = (effective_address & 0xF0000000u) == TIMER_BASE;
-            bool is_vga = (effective_address & 0xF0000000u) == VGA_BASE;
-
-            if (top->io_memory_bundle_write_enable) {
-                memory_write_strobe[0] = top->io_memory_bundle_write_strobe_0;
-                memory_write_strobe[1] = top->io_memory_bundle_write_strobe_1;
-                memory_write_strobe[2] = top->io_memory_bundle_write_strobe_2;
-                memory_write_strobe[3] = top->io_memory_bundle_write_strobe_3;
-                if (device_select == 0) {
-                    memory->write(effective_address,
-                                  top->io_memory_bundle_write_data,
-                                  memory_write_strobe);
-                } else if (is_uart) {
-                    uart.write(effective_address - UART_BASE,
-                               top->io_memory_bundle_write_data);
-                } else if (is_timer) {
-                    timer.write(effective_address - TIMER_BASE,
-                                top->io_memory_bundle_write_data);
-                } else if (is_vga) {
-                    // VGA is hardware-only, writes are ignored in simulator
-                    // (handled by VGA Chisel module directly)
-                }
-            }
+    }
+
+    // Serve the memory and device accesses the core presents
+    // Follow a CTRL write the way VGA.scala takes it: with an out-of-range
+    // frame index only display enable changes
+    void watch_vga_ctrl(uint32_t ctrl)
+    {
+        uint32_t frame_sel = (ctrl >> 4) & 0xf;
+        if (frame_sel >= 12)
+            return;
+        vga_vblank_ie = ctrl & 0x100;
+        if (frame_sel != vga_frame_sel) {
+            vga_frame_sel = frame_sel;
+            ++vga_frame_flips;
+        }
+    }
 
+    void serve_bus()
+    {
+        uint32_t device_select = top->io_deviceSelect;
+        uint32_t low_address = top->io_memory_bundle_address & DEVICE_MASK;
+        uint32_t effective_address =
+            (device_select << DEVICE_SHIFT) | low_address;
+        bool is_uart = (effective_address & 0xF0000000u) == UART_BASE;
+        bool is_timer = (effective_address & 0xF0000000u) == TIMER_BASE;
+        bool is_vga = (effective_address & 0xF0000000u) == VGA_BASE;
+
+        if (top->io_memory_bundle_write_enable) {
+            bool memory_write_strobe[4] = {
+                bool(top->io_memory_bundle_write_strobe_0),
+                bool(top->io_memory_bundle_write_strobe_1),
+                bool(top->io_memory_bundle_write_strobe_2),
+                bool(top->io_memory_bundle_write_strobe_3)};
             if (device_select == 0) {
-                data_memory_read_word = memory->read(effective_address);
+                memory->write(effective_address,
+                              top->io_memory_bundle_write_data,
+                              memory_write_strobe);
             } else if (is_uart) {
-                data_memory_read_word =
-                    uart.read(effective_address - UART_BASE);
+                uart.write(effective_address - UART_BASE,
+                           top->io_memory_bundle_write_data);
             } else if (is_timer) {
-                data_memory_read_word =
-                    timer.read(effective_address - TIMER_BASE);
+                timer.write(effective_address - TIMER_BASE,
+                            top->io_memory_bundle_write_data);
             } else if (is_vga) {
-                // VGA is hardware-only, reads return 0
-                data_memory_read_word = 0;
-            } else {
-                data_memory_read_word = 0;
+                // VGA is hardware-only (handled by VGA Chisel module
+                // directly); CTRL writes are only watched
+                if (effective_address - VGA_BASE == VGA_CTRL)
+                    watch_vga_ctrl(top->io_memory_bundle_write_data);
             }
-            inst_memory_read_word =
-                memory->readInst(top->io_instruction_address);
-            vcd_tracer->dump(main_time);
+        }
+
+        if (device_select == 0) {
+            data_memory_read_word = memory->read(effective_address);
+        } else if (is_uart) {
+            data_memory_read_word = uart.read(effective_address - UART_BASE);
+        } else if (is_timer) {
+            data_memory_read_word = timer.read(effective_address - TIMER_BASE);
+        } else if (is_vga) {
+            // VGA is hardware-only, reads return 0
+            data_memory_read_word = 0;
+        } else {
+            data_memory_read_word = 0;
+        }
+        inst_memory_read_word = memory->readInst(top->io_instruction_address);
+        // Third read port: the VGA DMA engine fetching frame words
+        if (top->io_vga_dma_read)
+            dma_read_word = memory->read(top->io_vga_dma_address);
+    }
 
+    int run()
+    {
 #ifdef ENABLE_SDL2
-            // Update VGA display using hardware-provided positions (Bug #6 fix)
-            if (vga_display) {
-                vga_display->update_pixel(top->io_vga_rrggbb,
-                                          top->io_vga_activevideo,
-                                          top->io_vga_x_pos, top->io_vga_y_pos);
-                vga_display->check_vsync(top->io_vga_vsync);
-
-                // Check if user requested to quit
-                if (vga_display->quit_requested()) {
-                    std::cout << "\n[SDL2] User closed window or pressed ESC - "
-                                 "stopping simulation"
-                              << std::endl;
-                    break;
+        // The window needs the main thread, so the simulation moves to a
+        // worker for as long as the window is shown
+        if (vga_display) {
+            int status = 0;
+            std::exception_ptr error;
+            std::thread worker([&] {
+                try {
+                    status = simulate();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                vga_display->stop();
+            });
+            vga_display->show();
+            worker.join();
+            if (error)
+                std::rethrow_exception(error);
+            return status;
+        }
+#endif
+        return simulate();
+    }
+
+private:
+    int simulate()
+    {
+        top->reset = 1;
+        top->clock = 0;
+        top->io_instruction_valid = 1;
+        top->io_interrupt_flag = 0;
+        // VGA pixel clock, held low unless it runs below
+        top->io_vga_pixclk = 0;
+        top->eval();
+        vcd_tracer->dump(0);
+
+        // The system clock and, when the VGA output is used, the pixel clock
+        // at their own frequencies, so the CDC paths in VGA.scala see a
+        // realistic ratio
+        ClockWheel clocks;
+        uint64_t sysclk_half = ClockWheel::half_period_ps(sysclk_mhz);
+        uint32_t const sysclk = clocks.add(sysclk_half);
+        uint64_t const pixclk_half = ClockWheel::half_period_ps(pixclk_mhz);
+        uint32_t pixclk = vga_pixclk ? clocks.add(pixclk_half) : 0;
+        uint64_t const end_time = max_sim_time * sysclk_half / 2;
+        uint64_t progress = 0;
+        uint64_t cycle = 0;
+        if (shared_memory)
+            shared_memory->set_status(rv32::SHM_RUNNING);
+        bool halted = false;
+        while (clocks.time() < end_time && !Verilated::gotFinish()) {
+            // Without a display the pixel clock starts once software enables
+            // the vblank interrupt, which would otherwise never come
+            if (!pixclk && vga_vblank_ie && !stub_vga_pixclk)
+                pixclk = clocks.add(pixclk_half);
+            uint32_t edges = clocks.advance();
+            if (edges & pixclk)
+                top->io_vga_pixclk = clocks.level(pixclk);
+            if (edges & sysclk) {
+                top->clock = clocks.level(sysclk);
+                if (top->clock && !top->reset) {
+                    if (commit_log)
+                        commit_log->sample(cycle, *top);
+                    if (profiler)
+                        profiler->sample(cycle, *top);
+                    if (mem_trace)
+                        mem_trace->sample(cycle, *top);
+                    if (probes)
+                        probes->sample(cycle);
+                    if (shared_memory)
+                        shared_memory->sample(cycle, *top);
+                    if (vga_snapshot &&
+                        (cycle + 1) % vga_snapshot_cycles == 0) {
+                        vga_snapshot->render(vga_frame);
+                        end_vga_frame(cycle);
+                    }
+                    if (iss_checker && !check_retired(cycle))
+                        break;
+                    if (++cycle == warmup_cycles && iss)
+                        warmup_instret = iss->instret;
                 }
             }
+            eval();
+
+            // Reset ends after the first rising edge: hand over the ISS state
+            // now so that no reset edge overwrites it
+            if (top->reset && top->clock) {
+                if (fast_forward) {
+                    run_fast_forward();
+                    top->eval();
+                }
+                top->reset = 0;
+            }
+
+            serve_bus();
+            if (edges & sysclk) {
+                // Settle: the fetched instruction selects the data access,
+                // whose answer must reach the core before the next edge
+                eval();
+                serve_bus();
+            }
+            if (cycle >= warmup_cycles)
+                vcd_tracer->dump(clocks.time());
+
+            // Update VGA frames using hardware-provided positions (Bug #6 fix)
+            if (vga && (edges & pixclk)) {
+                vga->update_pixel(top->io_vga_rrggbb, top->io_vga_activevideo,
+                                  top->io_vga_x_pos, top->io_vga_y_pos);
+                if (vga->frame_done(top->io_vga_vsync))
+                    end_vga_frame(cycle);
+            }
+
+#ifdef ENABLE_SDL2
+            // Check if user requested to quit
+            if (vga_display && vga_display->quit_requested()) {
+                std::cout << "\n[SDL2] User closed window or pressed ESC - "
+                             "stopping simulation"
+                          << std::endl;
+                break;
+            }
 #endif
 
             if (halt_address) {
-                if (memory->read(halt_address) == 0xBABECAFE)
+                if (memory->read(halt_address) == 0xBABECAFE) {
+                    halted = true;
                     break;
+                }
             }
 
             // print simulation progress in percentage every 1%
-            if (main_time % (max_sim_time / 100) == 0) {
-                std::cout << "Simulation progress: "
-                          << (main_time * 100 / max_sim_time) << "%"
+            uint64_t percent =
+                std::min<uint64_t>(100, clocks.time() * 100 / end_time);
+            if (percent > progress) {
+                progress = percent;
+                std::cout << "Simulation progress: " << progress << "%"
                           << std::endl;
             }
         }
@@ -529,10 +1456,84 @@ public:
 #ifdef ENABLE_SDL2
         // Final render to display last frame
         if (vga_display)
-            vga_display->render();
+            vga_display->publish();
 #endif
+
+        if (shared_memory)
+            shared_memory->set_status(halted ? rv32::SHM_HALTED
+                                             : rv32::SHM_EXITED);
+
+        if (vga_frame_flips)
+            std::cout << "VGA frame flips: " << vga_frame_flips << std::endl;
+
+        if (vga_capture) {
+            std::cout << "VGA capture: " << vga_capture->captured()
+                      << " frames";
+            if (vga_capture_target != "hash")
+                std::cout << " written to " << vga_capture_target;
+            std::cout << std::endl;
+        }
+
+        if (commit_log) {
+            commit_log->finish();
+            std::cout << "Commit log: " << commit_log->written()
+                      << " instructions written to " << commit_log_filename
+                      << std::endl;
+        }
+
+        if (mem_trace) {
+            mem_trace->finish();
+            std::cout << "Memory trace: " << mem_trace->instructions()
+                      << " fetches, " << mem_trace->accesses()
+                      << " data accesses written to " << mem_trace_filename
+                      << std::endl;
+        }
+
+        if (probes) {
+            probes->finish();
+            std::cout << "Probes: " << probes->rows() << " samples of "
+                      << probes->signals() << " signals written to "
+                      << probe_filename << std::endl;
+        }
+
+        if (profiler) {
+            std::unique_ptr<rv32::ElfSymbols> elf;
+            if (!elf_filename.empty())
+                elf = std::make_unique<rv32::ElfSymbols>(elf_filename);
+            profiler->write(profile_filename, elf.get());
+            std::cout << "Profile: " << profiler->cycles() << " cycles, "
+                      << profiler->instructions()
+                      << " instructions written to " << profile_filename
+                      << std::endl;
+        }
+
+        if (fast_forward || warmup_cycles) {
+            uint64_t measured =
+                cycle > warmup_cycles ? cycle - warmup_cycles : 0;
+            std::cout << "Detailed simulation: " << measured << " cycles";
+            if (warmup_cycles)
+                std::cout << " after " << warmup_cycles << " warm-up cycles";
+            // The checker keeps the ISS in step with the core, so its
+            // instret counts what the core retired
+            uint64_t instructions =
+                iss ? iss->instret - std::max(warmup_instret, ff_retired) : 0;
+            if (iss_checker && measured && instructions)
+                std::cout << ", " << instructions << " instructions (CPI "
+                          << double(measured) / instructions << ")";
+            std::cout << std::endl;
+        }
+
+        if (iss_checker) {
+            std::cout << "ISS check: " << iss_checker->matched()
+                      << " results matched"
+                      << (iss_checker->ok() ? "" : " before the mismatch")
+                      << std::endl;
+            return iss_checker->ok() ? 0 : 1;
+        }
+        return 0;
     }
 
+public:
     ~Simulator()
     {
         if (top)
@@ -545,6 +1546,5 @@ int main(int argc, char **argv)
     Verilated::commandArgs(argc, argv);
     std::vector<std::string> args(argv, argv + argc);
     Simulator simulator(args);
-    simulator.run();
-    return 0;
+    return simulator.run();
 }
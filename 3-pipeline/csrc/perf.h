@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+/**
+ * Hardware Performance Counters (Zicntr/Zihpm)
+ *
+ * The 3-pipeline cores count cycles, retired instructions and eight pipeline
+ * events in 64-bit counters. Each is readable as a user CSR (cycle, instret,
+ * hpmcounterN, with an "h" CSR for the upper half) and read/write as a
+ * machine CSR (mcycle, minstret, mhpmcounterN). Setting bit N of
+ * mcountinhibit stops counter N (bit 0 cycle, bit 2 instret).
+ *
+ * Counter events are fixed; mhpmeventN reads back N:
+ *   3  load-use stall cycles
+ *   4  stall cycles of an ID-stage jump waiting for its operands
+ *   5  RAW stall cycles (FiveStageStall, which has no forwarding)
+ *   6  IF flushes (taken branch, jump, trap or interrupt)
+ *   7  ID flushes for control hazards (stall bubbles not included)
+ *   8  interrupts taken
+ *   9  loads retired
+ *   10 stores retired
+ *
+ * Example: CPI and load-use share of a region
+ *
+ *   struct perf_counters begin, end;
+ *   perf_read(&begin);
+ *   work();
+ *   perf_read(&end);
+ *   cycles = end.cycle - begin.cycle;
+ *   cpi_x100 = cycles * 100 / (end.instret - begin.instret);
+ *   load_use = end.hpm[PERF_LOAD_USE_STALL] - begin.hpm[PERF_LOAD_USE_STALL];
+ *
+ * RV32I has no divide instruction: the division above goes through libgcc.
+ */
+
+#define PERF_LOAD_USE_STALL 3
+#define PERF_JUMP_STALL 4
+#define PERF_DATA_HAZARD_STALL 5
+#define PERF_IF_FLUSH 6
+#define PERF_ID_FLUSH 7
+#define PERF_INTERRUPT 8
+#define PERF_LOAD 9
+#define PERF_STORE 10
+#define PERF_COUNTERS 11
+
+#define csr_read(csr)                               \
+    ({                                              \
+        unsigned int __v;                           \
+        asm volatile("csrr %0, " #csr : "=r"(__v)); \
+        __v;                                        \
+    })
+
+#define csr_write(csr, value) \
+    asm volatile("csrw " #csr ", %0" ::"r"(value))
+
+/* Read a 64-bit counter; retry if the low half wrapped between the reads */
+#define counter_read64(csr)                       \
+    ({                                            \
+        unsigned int __hi, __lo;                  \
+        do {                                      \
+            __hi = csr_read(csr##h);              \
+            __lo = csr_read(csr);                 \
+        } while (__hi != csr_read(csr##h));       \
+        ((unsigned long long) __hi << 32) | __lo; \
+    })
+
+struct perf_counters {
+    unsigned long long cycle;
+    unsigned long long instret;
+    unsigned long long hpm[PERF_COUNTERS]; /* indices 3..10 are valid */
+};
+
+static inline void perf_read(struct perf_counters *p)
+{
+    p->cycle = counter_read64(cycle);
+    p->instret = counter_read64(instret);
+    p->hpm[3] = counter_read64(hpmcounter3);
+    p->hpm[4] = counter_read64(hpmcounter4);
+    p->hpm[5] = counter_read64(hpmcounter5);
+    p->hpm[6] = counter_read64(hpmcounter6);
+    p->hpm[7] = counter_read64(hpmcounter7);
+    p->hpm[8] = counter_read64(hpmcounter8);
+    p->hpm[9] = counter_read64(hpmcounter9);
+    p->hpm[10] = counter_read64(hpmcounter10);
+}
+
+/* Stop (1) or restart (0) all counters, e.g. around reporting code */
+static inline void perf_inhibit(int inhibit)
+{
+    csr_write(mcountinhibit, inhibit ? 0x7fd : 0);
+}
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package board.verilator
+
+import chisel3._
+import chisel3.stage.ChiselStage
+import riscv.core.CPU
+import riscv.core.CPUBundle
+import riscv.ImplementationType
+
+/**
+ * MultiTop: all four pipeline implementations side by side in one model
+ *
+ * Each core gets its own clock and reset so the simulator (multi.cpp) can run
+ * any subset: a core whose clock is held does no work. Cores are indexed by
+ * ImplementationType and share nothing; memory and MMIO live in the harness.
+ */
+class MultiTop extends RawModule {
+  val implementations = Seq(
+    ImplementationType.ThreeStage,
+    ImplementationType.FiveStageStall,
+    ImplementationType.FiveStageForward,
+    ImplementationType.FiveStageFinal
+  )
+
+  val io = IO(new Bundle {
+    val clocks = Input(Vec(implementations.length, Clock()))
+    val resets = Input(Vec(implementations.length, Bool()))
+    val cores  = Vec(implementations.length, new CPUBundle)
+  })
+
+  for ((implementation, i) <- implementations.zipWithIndex) {
+    withClockAndReset(io.clocks(i), io.resets(i)) {
+      val cpu = Module(new CPU(implementation))
+      cpu.io <> io.cores(i)
+    }
+  }
+}
+
+object MultiVerilogGenerator extends App {
+  (new ChiselStage).emitVerilog(
+    new MultiTop(),
+    Array("--target-dir", "3-pipeline/verilog/verilator")
+  )
+}
@@ -21,6 +21,13 @@ class Top extends Module {
   cpu.io.csr_debug_read_address := io.csr_debug_read_address
   io.csr_debug_read_data        := cpu.io.csr_debug_read_data
 
+  io.debug_regs_write_enable  := cpu.io.debug_regs_write_enable
+  io.debug_regs_write_address := cpu.io.debug_regs_write_address
+  io.debug_regs_write_data    := cpu.io.debug_regs_write_data
+  io.retire                   := cpu.io.retire
+  io.hazard                   := cpu.io.hazard
+  io.pipeline                 := cpu.io.pipeline
+
   io.memory_bundle <> cpu.io.memory_bundle
   io.instruction_address := cpu.io.instruction_address
   cpu.io.instruction     := io.instruction
@@ -7,6 +7,7 @@ package riscv.core
 import chisel3._
 import peripheral.RAMBundle
 import riscv.Parameters
+import riscv.RetirementBundle
 
 class CPUBundle extends Bundle {
   val instruction_address    = Output(UInt(Parameters.AddrWidth))
@@ -19,4 +20,18 @@ class CPUBundle extends Bundle {
   val debug_read_data        = Output(UInt(Parameters.DataWidth))
   val csr_debug_read_address = Input(UInt(Parameters.CSRRegisterAddrWidth))
   val csr_debug_read_data    = Output(UInt(Parameters.DataWidth))
+
+  // Register file write port, observed by the simulator to compare retired results
+  val debug_regs_write_enable  = Output(Bool())
+  val debug_regs_write_address = Output(UInt(Parameters.PhysicalRegisterAddrWidth))
+  val debug_regs_write_data    = Output(UInt(Parameters.DataWidth))
+
+  // One record per retired instruction, for commit logs and lockstep checking
+  val retire = new RetirementBundle
+
+  // Stall/flush state and its cause every cycle, for CPI-stack accounting
+  val hazard = new HazardDebugBundle
+
+  // What each pipeline stage holds, for pipeline diagrams
+  val pipeline = new PipelineTraceBundle
 }
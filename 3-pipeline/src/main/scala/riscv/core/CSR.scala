@@ -19,6 +19,20 @@ object CSRRegister {
   val MCAUSE   = 0x342.U(Parameters.CSRRegisterAddrWidth)
   val CycleL   = 0xc00.U(Parameters.CSRRegisterAddrWidth)
   val CycleH   = 0xc80.U(Parameters.CSRRegisterAddrWidth)
+
+  // Zicntr/Zihpm counters: user read-only views at 0xc00 + n / 0xc80 + n,
+  // machine read/write at 0xb00 + n / 0xb80 + n (n = 0 cycle, 2 instret, 3.. hpm)
+  val MCOUNTINHIBIT = 0x320.U(Parameters.CSRRegisterAddrWidth)
+  val MHPMEVENT3    = 0x323
+  val MCYCLE        = 0xb00
+  val MCYCLEH       = 0xb80
+  val UserCounters  = 0xc00
+  val UserCountersH = 0xc80
+  val CycleIndex    = 0
+  val InstretIndex  = 2
+  // Implemented counters: cycle, instret and the hpm counters
+  val MCountInhibitMask =
+    (((1L << (PerformanceEvents.FirstCounter + PerformanceEvents.Counters)) - 1) & ~2L).U(Parameters.DataWidth)
 }
 
 class CSR extends Module {
@@ -33,6 +47,8 @@ class CSR extends Module {
     val debug_reg_read_data = Output(UInt(Parameters.DataWidth))
 
     val clint_access_bundle = Flipped(new CSRDirectAccessBundle)
+
+    val events = Input(new PerformanceEvents)
   })
 
   val mstatus  = RegInit(UInt(Parameters.DataWidth), 0.U)
@@ -42,18 +58,55 @@ class CSR extends Module {
   val mepc     = RegInit(UInt(Parameters.DataWidth), 0.U)
   val mcause   = RegInit(UInt(Parameters.DataWidth), 0.U)
   val cycles   = RegInit(UInt(64.W), 0.U)
+  val instret  = RegInit(UInt(64.W), 0.U)
+  val hpm      = RegInit(VecInit(Seq.fill(PerformanceEvents.Counters)(0.U(64.W))))
+  // Bit n stops counter n; bit 1 (time) is hardwired to zero
+  val mcountinhibit = RegInit(UInt(Parameters.DataWidth), 0.U)
+
+  // Counter index -> (register, event); cycle counts every cycle
+  val counters = Seq(
+    CSRRegister.CycleIndex   -> (cycles, true.B),
+    CSRRegister.InstretIndex -> (instret, io.events.instruction_retired),
+  ) ++ hpm.zip(io.events.hpm).zipWithIndex.map { case ((counter, event), i) =>
+    (PerformanceEvents.FirstCounter + i) -> (counter, event)
+  }
+  val counterLUT = counters.flatMap { case (index, (counter, _)) =>
+    Seq(
+      (CSRRegister.UserCounters + index).U(Parameters.CSRRegisterAddrWidth)  -> counter(31, 0),
+      (CSRRegister.UserCountersH + index).U(Parameters.CSRRegisterAddrWidth) -> counter(63, 32),
+      (CSRRegister.MCYCLE + index).U(Parameters.CSRRegisterAddrWidth)        -> counter(31, 0),
+      (CSRRegister.MCYCLEH + index).U(Parameters.CSRRegisterAddrWidth)       -> counter(63, 32),
+    )
+  }
+  val eventLUT = (0 until PerformanceEvents.Counters).map { i =>
+    (CSRRegister.MHPMEVENT3 + i).U(Parameters.CSRRegisterAddrWidth) -> (PerformanceEvents.FirstCounter + i).U
+  }
   val regLUT =
     IndexedSeq(
-      CSRRegister.MSTATUS  -> mstatus,
-      CSRRegister.MIE      -> mie,
-      CSRRegister.MTVEC    -> mtvec,
-      CSRRegister.MSCRATCH -> mscratch,
-      CSRRegister.MEPC     -> mepc,
-      CSRRegister.MCAUSE   -> mcause,
-      CSRRegister.CycleL   -> cycles(31, 0),
-      CSRRegister.CycleH   -> cycles(63, 32),
-    )
-  cycles := cycles + 1.U
+      CSRRegister.MSTATUS       -> mstatus,
+      CSRRegister.MIE           -> mie,
+      CSRRegister.MTVEC         -> mtvec,
+      CSRRegister.MSCRATCH      -> mscratch,
+      CSRRegister.MEPC          -> mepc,
+      CSRRegister.MCAUSE        -> mcause,
+      CSRRegister.MCOUNTINHIBIT -> mcountinhibit,
+    ) ++ counterLUT ++ eventLUT
+
+  // A CSR write to a machine counter replaces that half; otherwise it counts
+  // its event unless inhibited
+  for ((index, (counter, event)) <- counters) {
+    val write_low = io.reg_write_enable_ex &&
+      io.reg_write_address_ex === (CSRRegister.MCYCLE + index).U(Parameters.CSRRegisterAddrWidth)
+    val write_high = io.reg_write_enable_ex &&
+      io.reg_write_address_ex === (CSRRegister.MCYCLEH + index).U(Parameters.CSRRegisterAddrWidth)
+    when(write_low) {
+      counter := counter(63, 32) ## io.reg_write_data_ex
+    }.elsewhen(write_high) {
+      counter := io.reg_write_data_ex ## counter(31, 0)
+    }.elsewhen(event && !mcountinhibit(index)) {
+      counter := counter + 1.U
+    }
+  }
 
   // If the pipeline and the CLINT are going to read and write the CSR at the same time, let the pipeline write first.
   // This is implemented in a single cycle by passing reg_write_data_ex to clint and writing the data from the CLINT to the CSR.
@@ -107,6 +160,8 @@ class CSR extends Module {
       mtvec := io.reg_write_data_ex
     }.elsewhen(io.reg_write_address_ex === CSRRegister.MSCRATCH) {
       mscratch := io.reg_write_data_ex
+    }.elsewhen(io.reg_write_address_ex === CSRRegister.MCOUNTINHIBIT) {
+      mcountinhibit := io.reg_write_data_ex & CSRRegister.MCountInhibitMask
     }
   }
 }
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package riscv.core
+
+import chisel3._
+import riscv.Parameters
+
+/**
+ * HazardDebugBundle: what Control and the CLINT did this cycle, for cycle accounting
+ *
+ * The simulator samples it every cycle to build a CPI stack and a per-PC table
+ * of lost cycles (common/verilator/rv32_cpi_stack.h).
+ * - pc_stall, if_flush, id_flush, stall_reason: Control outputs as driven
+ * - stall_pc: the instruction held in ID while the front end stalls (the consumer)
+ * - flush_pc: the instruction in the stage that redirects fetch (branch, jump,
+ *   or the instruction the CLINT acts on)
+ * - interrupt_entry, interrupt_exit, trap: the CLINT redirected for an
+ *   asynchronous interrupt, an mret, or an ecall/ebreak
+ */
+class HazardDebugBundle extends Bundle {
+  val pc_stall        = Output(Bool())
+  val if_flush        = Output(Bool())
+  val id_flush        = Output(Bool())
+  val stall_reason    = Output(UInt(StallReason.Width))
+  val stall_pc        = Output(UInt(Parameters.AddrWidth))
+  val flush_pc        = Output(UInt(Parameters.AddrWidth))
+  val interrupt_entry = Output(Bool())
+  val interrupt_exit  = Output(Bool())
+  val trap            = Output(Bool())
+}
+
+object HazardDebug {
+  def connect(
+      port: HazardDebugBundle,
+      pc_stall: Bool,
+      if_flush: Bool,
+      id_flush: Bool,
+      stall_reason: UInt,
+      stall_pc: UInt,
+      flush_pc: UInt,
+      clint_assert: Bool,
+      clint_instruction: UInt
+  ): Unit = {
+    port.pc_stall        := pc_stall
+    port.if_flush        := if_flush
+    port.id_flush        := id_flush
+    port.stall_reason    := stall_reason
+    port.stall_pc        := stall_pc
+    port.flush_pc        := flush_pc
+    port.interrupt_entry := Retirement.interruptTaken(clint_assert, clint_instruction)
+    port.interrupt_exit  := clint_assert && clint_instruction === Retirement.mret
+    port.trap := clint_assert &&
+      (clint_instruction === Retirement.ecall || clint_instruction === Retirement.ebreak)
+  }
+}
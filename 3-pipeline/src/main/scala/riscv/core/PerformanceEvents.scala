@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package riscv.core
+
+import chisel3._
+import riscv.RetirementBundle
+
+// Why Control stalled the front end this cycle (Control.io.stall_reason)
+object StallReason {
+  val Width = 2.W
+
+  val None           = 0.U(Width) // not stalling
+  val LoadUse        = 1.U(Width) // ID needs a load result that is not available yet
+  val JumpDependency = 2.U(Width) // ID-stage jump needs a value still in EX or a load in MEM
+  val DataHazard     = 3.U(Width) // any RAW dependency (no forwarding)
+}
+
+/**
+ * PerformanceEvents: per-cycle events counted by the mhpmcounters
+ *
+ * Counter N (mhpmcounterN/hpmcounterN) counts event N; mhpmeventN reads back
+ * N and is not writable.
+ * - 3 load_use_stall:    cycles stalled on a load-use hazard
+ * - 4 jump_stall:        cycles stalled because an ID-stage jump waits for its operands
+ * - 5 data_hazard_stall: cycles stalled on any RAW hazard (FiveStageStall only)
+ * - 6 if_flush:          cycles IF2ID was flushed (taken branch, jump, trap or interrupt)
+ * - 7 id_flush:          cycles ID2EX was flushed for a control hazard (stall bubbles excluded)
+ * - 8 interrupt_taken:   asynchronous interrupts taken
+ * - 9 memory_read:       retired loads
+ * - 10 memory_write:     retired stores
+ */
+class PerformanceEvents extends Bundle {
+  val instruction_retired = Bool()
+  val load_use_stall      = Bool()
+  val jump_stall          = Bool()
+  val data_hazard_stall   = Bool()
+  val if_flush            = Bool()
+  val id_flush            = Bool()
+  val interrupt_taken     = Bool()
+  val memory_read         = Bool()
+  val memory_write        = Bool()
+
+  // In counter order, from mhpmcounter3
+  def hpm: Seq[Bool] =
+    Seq(load_use_stall, jump_stall, data_hazard_stall, if_flush, id_flush, interrupt_taken, memory_read, memory_write)
+}
+
+object PerformanceEvents {
+  val FirstCounter = 3
+  val Counters     = 8
+
+  def apply(
+      retire: RetirementBundle,
+      stall_reason: UInt,
+      if_flush: Bool,
+      id_flush: Bool,
+      interrupt_taken: Bool
+  ): PerformanceEvents = {
+    val events = Wire(new PerformanceEvents)
+    // ecall/ebreak raise an exception instead of retiring
+    events.instruction_retired := retire.valid && !retire.trap
+    events.load_use_stall      := stall_reason === StallReason.LoadUse
+    events.jump_stall          := stall_reason === StallReason.JumpDependency
+    events.data_hazard_stall   := stall_reason === StallReason.DataHazard
+    events.if_flush            := if_flush
+    events.id_flush            := id_flush && stall_reason === StallReason.None
+    events.interrupt_taken     := interrupt_taken
+    events.memory_read         := retire.valid && retire.memory_read
+    events.memory_write        := retire.valid && retire.memory_write_strobe =/= 0.U
+    events
+  }
+}
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package riscv.core
+
+import chisel3._
+import riscv.Parameters
+
+// What one pipeline stage holds this cycle
+class StageTraceBundle extends Bundle {
+  val valid       = Output(Bool())
+  val id          = Output(UInt(PipelineTrace.IdWidth))
+  val pc          = Output(UInt(Parameters.AddrWidth))
+  val instruction = Output(UInt(Parameters.InstructionWidth))
+}
+
+/**
+ * PipelineTraceBundle: pipeline occupancy, for pipeline diagrams in the simulator
+ *
+ * stages(0) is the instruction being fetched, stages(1..4) the contents of
+ * IF2ID, ID2EX, EX2MEM and MEM2WB (the ThreeStage core only fills IF, ID and
+ * its folded EX). Every fetch slot gets an id, so the simulator can follow an
+ * instruction from stage to stage: an id that stays put is stalled, an id that
+ * vanishes without retire_valid was flushed, and an invalid stage is a bubble.
+ * Ids are 16 bits and wrap; at most a few are in flight at any time.
+ */
+class PipelineTraceBundle extends Bundle {
+  val stages       = Vec(PipelineTrace.Stages, new StageTraceBundle)
+  val retire_valid = Output(Bool())
+  val retire_id    = Output(UInt(PipelineTrace.IdWidth))
+}
+
+object PipelineTrace {
+  val Stages  = 5
+  val IdWidth = 16.W
+
+  // Numbers fetch slots: moves on whenever the fetch stage hands its
+  // instruction to ID or drops it, i.e. whenever the PC is not stalled
+  def fetchId(advance: Bool): UInt = {
+    val id = RegInit(0.U(IdWidth))
+    when(advance) {
+      id := id + 1.U
+    }
+    id
+  }
+
+  // Drive the trace port from the bookkeeping of each stage, fetch first;
+  // stages beyond the end of the pipeline stay empty
+  def connect(port: PipelineTraceBundle, stages: Seq[RetireInfo], retired: RetireInfo): Unit = {
+    for ((stage, i) <- port.stages.zipWithIndex) {
+      if (i < stages.length) {
+        stage.valid       := stages(i).valid
+        stage.id          := stages(i).id
+        stage.pc          := stages(i).pc
+        stage.instruction := stages(i).instruction
+      } else {
+        stage := 0.U.asTypeOf(new StageTraceBundle)
+      }
+    }
+    port.retire_valid := retired.valid
+    port.retire_id    := retired.id
+  }
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package riscv.core
+
+import chisel3._
+import peripheral.RAMBundle
+import riscv.Parameters
+import riscv.RetirementBundle
+
+// Per-instruction bookkeeping carried alongside the pipeline registers
+class RetireInfo extends Bundle {
+  val valid               = Bool()
+  val id                  = UInt(PipelineTrace.IdWidth)
+  val pc                  = UInt(Parameters.AddrWidth)
+  val instruction         = UInt(Parameters.InstructionWidth)
+  val interrupt           = Bool()
+  val memory_address      = UInt(Parameters.AddrWidth)
+  val memory_read         = Bool()
+  val memory_read_data    = UInt(Parameters.DataWidth)
+  val memory_write_strobe = UInt(Parameters.WordSize.W)
+  val memory_write_data   = UInt(Parameters.DataWidth)
+}
+
+object RetireInfo {
+  // A freshly fetched instruction; id numbers fetch slots (PipelineTrace.fetchId)
+  def fetch(valid: Bool, id: UInt, pc: UInt, instruction: UInt, interrupt: Bool): RetireInfo = {
+    val info = Wire(new RetireInfo)
+    info             := 0.U.asTypeOf(new RetireInfo)
+    info.valid       := valid
+    info.id          := id
+    info.pc          := pc
+    info.instruction := instruction
+    info.interrupt   := interrupt
+    info
+  }
+
+  // Cross a pipeline boundary with the same stall/flush as its pipeline register;
+  // a flush leaves an invalid bubble
+  def stage(in: RetireInfo, stall: Bool, flush: Bool): RetireInfo = {
+    val register = Module(new PipelineRegister(in.getWidth))
+    register.io.in    := in.asUInt
+    register.io.stall := stall
+    register.io.flush := flush
+    register.io.out.asTypeOf(new RetireInfo)
+  }
+
+  // Record the data memory access made while the instruction is in the memory stage
+  def memory(in: RetireInfo, read_enable: Bool, bundle: RAMBundle): RetireInfo = {
+    val info = Wire(new RetireInfo)
+    info                     := in
+    info.memory_address      := bundle.address
+    info.memory_read         := read_enable
+    info.memory_read_data    := bundle.read_data
+    info.memory_write_strobe := Mux(bundle.write_enable, bundle.write_strobe.asUInt, 0.U)
+    info.memory_write_data   := bundle.write_data
+    info
+  }
+}
+
+object Retirement {
+  val ecall  = 0x00000073L.U(Parameters.InstructionWidth)
+  val ebreak = 0x00100073L.U(Parameters.InstructionWidth)
+  val mret   = 0x30200073L.U(Parameters.InstructionWidth)
+
+  // The CLINT redirected for an asynchronous interrupt (not ecall/ebreak/mret)
+  def interruptTaken(clint_assert: Bool, clint_instruction: UInt): Bool =
+    clint_assert && clint_instruction =/= ecall && clint_instruction =/= ebreak && clint_instruction =/= mret
+
+  // High while the next fetched instruction is the first of an interrupt handler;
+  // cleared once the fetch stage hands an instruction on (accepted)
+  def interruptEntry(taken: Bool, accepted: Bool): Bool = {
+    val pending = RegInit(false.B)
+    when(taken) {
+      pending := true.B
+    }.elsewhen(accepted) {
+      pending := false.B
+    }
+    pending && !taken
+  }
+
+  // Drive the retirement port from the last stage
+  def connect(
+      port: RetirementBundle,
+      info: RetireInfo,
+      regs_write_enable: Bool,
+      regs_write_address: UInt,
+      regs_write_data: UInt
+  ): Unit = {
+    port.valid               := info.valid
+    port.pc                  := info.pc
+    port.instruction         := info.instruction
+    port.rd_address          := Mux(regs_write_enable, regs_write_address, 0.U)
+    port.rd_data             := Mux(regs_write_enable && regs_write_address =/= 0.U, regs_write_data, 0.U)
+    port.memory_address      := info.memory_address
+    port.memory_read         := info.memory_read
+    port.memory_read_data    := info.memory_read_data
+    port.memory_write_strobe := info.memory_write_strobe
+    port.memory_write_data   := info.memory_write_data
+    port.trap                := info.instruction === ecall || info.instruction === ebreak
+    port.interrupt           := info.interrupt
+  }
+}
@@ -5,6 +5,7 @@
 package riscv.core.fivestage_final
 
 import chisel3._
+import riscv.core.StallReason
 import riscv.Parameters
 
 /**
@@ -66,13 +67,16 @@ class Control extends Module {
     val id_flush = Output(Bool())
     val pc_stall = Output(Bool())
     val if_stall = Output(Bool())
+
+    val stall_reason = Output(UInt(StallReason.Width)) // StallReason, for performance counters
   })
 
   // Initialize control signals to default (no stall/flush) state
-  io.if_flush := false.B
-  io.id_flush := false.B
-  io.pc_stall := false.B
-  io.if_stall := false.B
+  io.if_flush     := false.B
+  io.id_flush     := false.B
+  io.pc_stall     := false.B
+  io.if_stall     := false.B
+  io.stall_reason := StallReason.None
 
   // ============================================================
   // [CA25: Exercise 19] Pipeline Hazard Detection
@@ -140,9 +144,10 @@ class Control extends Module {
     // - Flush ID/EX register (insert bubble)
     // - Freeze PC (don't fetch next instruction)
     // - Freeze IF/ID (hold current fetch result)
-    io.id_flush := true.B
-    io.pc_stall := true.B
-    io.if_stall := true.B
+    io.id_flush     := true.B
+    io.pc_stall     := true.B
+    io.if_stall     := true.B
+    io.stall_reason := Mux(io.jump_instruction_id, StallReason.JumpDependency, StallReason.LoadUse)
 
   }.elsewhen(io.jump_flag) {
     // ============ Control Hazard (Branch Taken) ============
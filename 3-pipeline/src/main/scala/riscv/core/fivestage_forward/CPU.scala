@@ -7,7 +7,12 @@ package riscv.core.fivestage_forward
 import chisel3._
 import riscv.core.CPUBundle
 import riscv.core.CSR
+import riscv.core.HazardDebug
+import riscv.core.PerformanceEvents
+import riscv.core.PipelineTrace
 import riscv.core.RegisterFile
+import riscv.core.RetireInfo
+import riscv.core.Retirement
 import riscv.Parameters
 
 // Five-Stage Pipelined CPU with Forwarding
@@ -69,6 +74,10 @@ class CPU extends Module {
   regs.io.debug_read_address := io.debug_read_address
   io.debug_read_data         := regs.io.debug_read_data
 
+  io.debug_regs_write_enable  := regs.io.write_enable
+  io.debug_regs_write_address := regs.io.write_address
+  io.debug_regs_write_data    := regs.io.write_data
+
   io.instruction_address          := inst_fetch.io.instruction_address
   inst_fetch.io.stall_flag_ctrl   := ctrl.io.pc_stall
   inst_fetch.io.jump_flag_id      := ex.io.if_jump_flag
@@ -177,4 +186,56 @@ class CPU extends Module {
   csr_regs.io.reg_write_data_ex      := ex.io.csr_write_data
   csr_regs.io.debug_reg_read_address := io.csr_debug_read_address
   io.csr_debug_read_data             := csr_regs.io.debug_reg_read_data
+
+  // Retirement port: bookkeeping follows each instruction through the same
+  // stall/flush as its pipeline registers, picks up the data access in MEM and
+  // retires from WB
+  val retire_interrupt = Retirement.interruptTaken(clint.io.ex_interrupt_assert, id2ex.io.output_instruction)
+  val retire_if = RetireInfo.fetch(
+    io.instruction_valid,
+    PipelineTrace.fetchId(io.instruction_valid && !ctrl.io.pc_stall),
+    inst_fetch.io.instruction_address,
+    inst_fetch.io.id_instruction,
+    Retirement.interruptEntry(retire_interrupt, io.instruction_valid && !ctrl.io.if_stall && !ctrl.io.if_flush)
+  )
+  val retire_id  = RetireInfo.stage(retire_if, ctrl.io.if_stall, ctrl.io.if_flush)
+  val retire_ex  = RetireInfo.stage(retire_id, false.B, ctrl.io.id_flush)
+  val retire_mem = RetireInfo.stage(retire_ex, false.B, false.B)
+  val retire_wb = RetireInfo.stage(
+    RetireInfo.memory(retire_mem, ex2mem.io.output_memory_read_enable, mem.io.bundle),
+    false.B,
+    false.B
+  )
+  Retirement.connect(
+    io.retire,
+    retire_wb,
+    mem2wb.io.output_regs_write_enable,
+    mem2wb.io.output_regs_write_address,
+    wb.io.regs_write_data
+  )
+
+  // Hardware performance counter events (mhpmcounter3..10)
+  csr_regs.io.events := PerformanceEvents(
+    io.retire,
+    ctrl.io.stall_reason,
+    ctrl.io.if_flush,
+    ctrl.io.id_flush,
+    retire_interrupt
+  )
+
+  // Hazard debug port: Control's decision and the CLINT redirect, for CPI stacks
+  HazardDebug.connect(
+    io.hazard,
+    ctrl.io.pc_stall,
+    ctrl.io.if_flush,
+    ctrl.io.id_flush,
+    ctrl.io.stall_reason,
+    if2id.io.output_instruction_address,
+    id2ex.io.output_instruction_address,
+    clint.io.ex_interrupt_assert,
+    id2ex.io.output_instruction
+  )
+
+  // Pipeline occupancy for pipeline diagrams
+  PipelineTrace.connect(io.pipeline, Seq(retire_if, retire_id, retire_ex, retire_mem, retire_wb), retire_wb)
 }
@@ -5,6 +5,7 @@
 package riscv.core.fivestage_forward
 
 import chisel3._
+import riscv.core.StallReason
 import riscv.Parameters
 
 /**
@@ -61,13 +62,16 @@ class Control extends Module {
     val id_flush = Output(Bool())
     val pc_stall = Output(Bool())
     val if_stall = Output(Bool())
+
+    val stall_reason = Output(UInt(StallReason.Width)) // StallReason, for performance counters
   })
 
   // Initialize control signals to default (no stall/flush) state
-  io.if_flush := false.B
-  io.id_flush := false.B
-  io.pc_stall := false.B
-  io.if_stall := false.B
+  io.if_flush     := false.B
+  io.id_flush     := false.B
+  io.pc_stall     := false.B
+  io.if_stall     := false.B
+  io.stall_reason := StallReason.None
 
   // Hazard detection with forwarding optimization
   when(io.jump_flag) {
@@ -103,6 +107,7 @@ class Control extends Module {
     io.id_flush := true.B // Insert NOP/bubble into ID/EX register
     io.pc_stall := true.B // Freeze PC (hold next instruction fetch)
     io.if_stall := true.B // Freeze IF/ID (hold current instruction)
+    io.stall_reason := StallReason.LoadUse
     // After stall: forwarding unit will forward load result from MEM/WB stage
   }
 }
@@ -5,6 +5,7 @@
 package riscv.core.fivestage_stall
 
 import chisel3._
+import riscv.core.StallReason
 import riscv.Parameters
 
 /**
@@ -60,13 +61,16 @@ class Control extends Module {
     val id_flush = Output(Bool())
     val pc_stall = Output(Bool())
     val if_stall = Output(Bool())
+
+    val stall_reason = Output(UInt(StallReason.Width)) // StallReason, for performance counters
   })
 
   // Initialize control signals to default (no stall/flush) state
-  io.if_flush := false.B
-  io.id_flush := false.B
-  io.pc_stall := false.B
-  io.if_stall := false.B
+  io.if_flush     := false.B
+  io.id_flush     := false.B
+  io.pc_stall     := false.B
+  io.if_stall     := false.B
+  io.stall_reason := StallReason.None
 
   // Hazard detection priority logic
   when(io.jump_flag) {
@@ -95,6 +99,7 @@ class Control extends Module {
     io.id_flush := true.B // Insert NOP into ID/EX register (bubble)
     io.pc_stall := true.B // Freeze PC (don't fetch new instruction)
     io.if_stall := true.B // Freeze IF/ID register (hold current instruction)
+    io.stall_reason := StallReason.DataHazard
     // Result: ID stage instruction waits until dependency resolved
   }
 }
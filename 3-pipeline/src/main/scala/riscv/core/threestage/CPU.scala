@@ -7,7 +7,13 @@ package riscv.core.threestage
 import chisel3._
 import riscv.core.CPUBundle
 import riscv.core.CSR
+import riscv.core.HazardDebug
+import riscv.core.PerformanceEvents
+import riscv.core.PipelineTrace
 import riscv.core.RegisterFile
+import riscv.core.RetireInfo
+import riscv.core.Retirement
+import riscv.core.StallReason
 import riscv.Parameters
 
 // Three-Stage Pipelined CPU Implementation
@@ -58,6 +64,10 @@ class CPU extends Module {
   regs.io.debug_read_address := io.debug_read_address
   io.debug_read_data         := regs.io.debug_read_data
 
+  io.debug_regs_write_enable  := regs.io.write_enable
+  io.debug_regs_write_address := regs.io.write_address
+  io.debug_regs_write_data    := regs.io.write_data
+
   io.instruction_address          := inst_fetch.io.instruction_address
   inst_fetch.io.jump_flag_ex      := ex.io.if_jump_flag
   inst_fetch.io.jump_address_ex   := ex.io.if_jump_address
@@ -119,4 +129,43 @@ class CPU extends Module {
   csr_regs.io.reg_write_data_ex      := ex.io.csr_write_data
   csr_regs.io.debug_reg_read_address := io.csr_debug_read_address
   io.csr_debug_read_data             := csr_regs.io.debug_reg_read_data
+
+  // Retirement port: bookkeeping follows each instruction through IF2ID and
+  // ID2EX and retires from EX, where memory access and write-back happen
+  val retire_interrupt = Retirement.interruptTaken(clint.io.ex_interrupt_assert, id2ex.io.output_instruction)
+  val retire_if = RetireInfo.fetch(
+    io.instruction_valid,
+    PipelineTrace.fetchId(io.instruction_valid),
+    inst_fetch.io.instruction_address,
+    inst_fetch.io.id_instruction,
+    Retirement.interruptEntry(retire_interrupt, io.instruction_valid && !ctrl.io.Flush)
+  )
+  val retire_id = RetireInfo.stage(retire_if, false.B, ctrl.io.Flush)
+  val retire_ex = RetireInfo.stage(retire_id, false.B, ctrl.io.Flush)
+  Retirement.connect(
+    io.retire,
+    RetireInfo.memory(retire_ex, id2ex.io.output_memory_read_enable, ex.io.memory_bundle),
+    regs.io.write_enable,
+    regs.io.write_address,
+    regs.io.write_data
+  )
+
+  // Hardware performance counter events (mhpmcounter3..10)
+  csr_regs.io.events := PerformanceEvents(io.retire, StallReason.None, ctrl.io.Flush, ctrl.io.Flush, retire_interrupt)
+
+  // Hazard debug port: no stalls; a redirect from EX flushes IF2ID and ID2EX
+  HazardDebug.connect(
+    io.hazard,
+    false.B,
+    ctrl.io.Flush,
+    ctrl.io.Flush,
+    StallReason.None,
+    if2id.io.output_instruction_address,
+    id2ex.io.output_instruction_address,
+    clint.io.ex_interrupt_assert,
+    id2ex.io.output_instruction
+  )
+
+  // Pipeline occupancy for pipeline diagrams (IF, ID, EX; no MEM/WB registers)
+  PipelineTrace.connect(io.pipeline, Seq(retire_if, retire_id, retire_ex), retire_ex)
 }
@@ -8,6 +8,7 @@ import chisel3._
 import chiseltest._
 import org.scalatest.flatspec.AnyFlatSpec
 import riscv.core.CSRRegister
+import riscv.core.StallReason
 
 class PipelineProgramTest extends AnyFlatSpec with ChiselScalatestTester {
   private val mcauseAcceptable: Set[BigInt] =
@@ -22,6 +23,19 @@ class PipelineProgramTest extends AnyFlatSpec with ChiselScalatestTester {
       }
   }
 
+  // Call sample once per CPU clock cycle for cycles cycles, in the last test
+  // clock cycle before the next CPU edge, when data memory reads have settled
+  private def everyCpuCycle(c: TestTopModule, cycles: Int)(sample: => Unit): Unit = {
+    while (!c.io.cpu_tick.peek().litToBoolean) {
+      c.clock.step()
+    }
+    c.clock.step(3)
+    for (_ <- 1 to cycles) {
+      sample
+      c.clock.step(4)
+    }
+  }
+
   for (cfg <- PipelineConfigs.All) {
     behavior.of(cfg.name)
 
@@ -139,6 +153,63 @@ class PipelineProgramTest extends AnyFlatSpec with ChiselScalatestTester {
       }
     }
 
+    it should "report stalls and flushes on the hazard debug port" in {
+      runProgram("hazard.asmbin", cfg) { c =>
+        var flushes = 0
+        val stalls  = scala.collection.mutable.Set[(BigInt, BigInt)]() // (stall_reason, stall_pc)
+        everyCpuCycle(c, 250) {
+          if (c.io.hazard.if_flush.peek().litToBoolean) {
+            flushes += 1
+          }
+          if (c.io.hazard.pc_stall.peek().litToBoolean) {
+            stalls += ((c.io.hazard.stall_reason.peek().litValue, c.io.hazard.stall_pc.peek().litValue))
+          }
+        }
+        assert(flushes > 0, s"${cfg.name}: the taken jumps in hazard.S should flush IF")
+
+        // 0x1030 (or t3, t1, t2) uses the result of the lw just before it
+        val loadUse = 0x1030
+        if (cfg.implementation == ImplementationType.ThreeStage) {
+          assert(stalls.isEmpty, s"ThreeStage never stalls, got $stalls")
+        } else if (cfg.implementation == ImplementationType.FiveStageStall) {
+          assert(stalls.contains((StallReason.DataHazard.litValue, loadUse)), s"stalls: $stalls")
+        } else {
+          assert(stalls.contains((StallReason.LoadUse.litValue, loadUse)), s"stalls: $stalls")
+        }
+      }
+    }
+
+    it should "follow stalled and flushed instructions on the pipeline trace port" in {
+      runProgram("hazard.asmbin", cfg) { c =>
+        val retired   = scala.collection.mutable.Set[BigInt]()
+        val flushed   = scala.collection.mutable.Set[BigInt]()
+        var heldId    = Option.empty[BigInt]
+        val fetch     = c.io.pipeline.stages(0)
+        val decode    = c.io.pipeline.stages(1)
+        everyCpuCycle(c, 250) {
+          // An instruction stalled in ID last cycle is still there
+          heldId.foreach { id =>
+            assert(decode.id.peek().litValue == id, s"${cfg.name}: stalled instruction left ID")
+          }
+          heldId = None
+          if (c.io.hazard.pc_stall.peek().litToBoolean) {
+            assert(decode.valid.peek().litToBoolean)
+            assert(decode.pc.peek().litValue == c.io.hazard.stall_pc.peek().litValue)
+            heldId = Some(decode.id.peek().litValue)
+          }
+          // The instruction being fetched when IF is flushed is on the wrong path
+          if (c.io.hazard.if_flush.peek().litToBoolean && fetch.valid.peek().litToBoolean) {
+            flushed += fetch.id.peek().litValue
+          }
+          if (c.io.pipeline.retire_valid.peek().litToBoolean) {
+            retired += c.io.pipeline.retire_id.peek().litValue
+          }
+        }
+        assert(retired.nonEmpty && flushed.nonEmpty, s"${cfg.name}: retired $retired, flushed $flushed")
+        assert((retired & flushed).isEmpty, s"${cfg.name}: flushed fetch slots retired: ${retired & flushed}")
+      }
+    }
+
     it should "handle machine-mode traps" in {
       runProgram("irqtrap.asmbin", cfg) { c =>
         c.clock.setTimeout(0)
@@ -170,6 +241,37 @@ class PipelineProgramTest extends AnyFlatSpec with ChiselScalatestTester {
         c.io.mem_debug_read_data.expect(0x2022L.U)
       }
     }
+    it should "count retired instructions and hazard events" in {
+      runProgram("counters.asmbin", cfg) { c =>
+        c.clock.setTimeout(0)
+        c.clock.step(10000)
+        def word(address: Int): BigInt = {
+          c.io.mem_debug_read_address.poke(address.U)
+          c.clock.step()
+          c.io.mem_debug_read_data.peek().litValue
+        }
+        assert(word(0x4c) == 0x600d, "counters.S did not finish")
+
+        val minstret = Seq(0x04, 0x08, 0x0c).map(word)
+        assert(minstret(0) > 0 && minstret(0) < minstret(1) && minstret(1) < minstret(2), s"minstret $minstret")
+        assert(word(0x10) == 9, "csrwi + 8 nops should retire 9 instructions")
+        assert(word(0x14) == 10, "the ecall should not count as retired")
+
+        assert(word(0x18) == 0x7fd, "mcountinhibit bit 1 (time) should read as zero")
+        assert(word(0x1c) == word(0x20), "mcycle should not move while inhibited")
+        assert(word(0x24) == word(0x28), "minstret should not move while inhibited")
+
+        // mhpmcounter3-10: load-use, jump, data hazard stalls, IF/ID flushes,
+        // interrupts, loads, stores
+        val hpm = (0 until 8).map(i => word(0x2c + 4 * i))
+        if (cfg.implementation != ImplementationType.ThreeStage) {
+          assert(hpm(0) + hpm(1) + hpm(2) > 0, s"${cfg.name}: no stall cycles counted ($hpm)")
+        }
+        assert(hpm(3) > 0, s"${cfg.name}: taken branches should flush IF ($hpm)")
+        assert(hpm(5) == 0, "no interrupts were taken")
+        assert(hpm(6) == 3 && hpm(7) == 3, s"three loads and three stores ($hpm)")
+      }
+    }
     it should "solve Towers of Hanoi (Optimized)" in {
       runProgram("hanoi_opt.asmbin", cfg) { c =>
         
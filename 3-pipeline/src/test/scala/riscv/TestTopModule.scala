@@ -10,6 +10,8 @@ import peripheral.InstructionROM
 import peripheral.Memory
 import peripheral.ROMLoader
 import riscv.core.CPU
+import riscv.core.HazardDebugBundle
+import riscv.core.PipelineTraceBundle
 
 class TestTopModule(exeFilename: String, implementation: Int) extends Module {
   val io = IO(new Bundle {
@@ -20,6 +22,11 @@ class TestTopModule(exeFilename: String, implementation: Int) extends Module {
     val csr_debug_read_address  = Input(UInt(Parameters.CSRRegisterAddrWidth))
     val csr_debug_read_data     = Output(UInt(Parameters.DataWidth))
     val interrupt_flag          = Input(UInt(Parameters.InterruptFlagWidth))
+
+    // High in the test clock cycle in which the CPU clock rises
+    val cpu_tick = Output(Bool())
+    val hazard   = new HazardDebugBundle
+    val pipeline = new PipelineTraceBundle
   })
 
   val mem             = Module(new Memory(8192))
@@ -36,6 +43,7 @@ class TestTopModule(exeFilename: String, implementation: Int) extends Module {
   CPU_next   := Mux(CPU_clkdiv === 3.U, 0.U, CPU_clkdiv + 1.U)
   CPU_tick   := CPU_clkdiv === 0.U
   CPU_clkdiv := CPU_next
+  io.cpu_tick := CPU_tick
 
   withClock(CPU_tick.asClock) {
     val cpu = Module(new CPU(implementation))
@@ -93,6 +101,8 @@ class TestTopModule(exeFilename: String, implementation: Int) extends Module {
     io.regs_debug_read_data       := cpu.io.debug_read_data
     cpu.io.csr_debug_read_address := io.csr_debug_read_address
     io.csr_debug_read_data        := cpu.io.csr_debug_read_data
+    io.hazard                     := cpu.io.hazard
+    io.pipeline                   := cpu.io.pipeline
   }
 
   mem.io.debug_read_address := io.mem_debug_read_address
@@ -0,0 +1,570 @@
+// Simulator for MultiTop: all four pipeline implementations in one model.
+//
+// Each core has a private memory and its own clock, so -impl selects which
+// cores run. With -lockstep every selected core runs the same program and
+// the register writes and stores each one retires are compared in order
+// against the first selected core; a write from a csrr of a cycle or hpm
+// counter only has its rd compared, as each core counts differently.
+// -cpi-stack breaks every selected core's cycles down by hazard cause.
+
+#include <verilated.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../../common/verilator/rv32_cpi_stack.h"
+#include "../../../common/verilator/rv32_iss.h"
+#include "VMultiTop.h"  // From Verilating "MultiTop.v"
+
+class Memory
+{
+    std::vector<uint32_t> memory;
+
+public:
+    Memory(size_t size) : memory(size, 0) {}
+
+    // Addresses are sampled every cycle, not only on loads, so out-of-range
+    // reads quietly return 0
+    uint32_t read(size_t address)
+    {
+        address = address / 4;
+        if (address >= memory.size()) {
+            return 0;
+        }
+        return memory[address];
+    }
+
+    void write(size_t address, uint32_t value, uint32_t write_mask)
+    {
+        address = address / 4;
+        if (address >= memory.size()) {
+            return;
+        }
+        memory[address] =
+            (memory[address] & ~write_mask) | (value & write_mask);
+    }
+
+    void load_binary(std::string const &filename, size_t load_address = 0x1000)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open file " + filename);
+        }
+        file.seekg(0, std::ios::end);
+        size_t size = file.tellg();
+        if (load_address + size > memory.size() * 4) {
+            throw std::runtime_error(
+                "File " + filename + " is too large (File is " +
+                std::to_string(size) + " bytes. Memory is " +
+                std::to_string(memory.size() * 4 - load_address) + " bytes.)");
+        }
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char *>(&memory[load_address / 4]), size);
+    }
+};
+
+uint32_t parse_number(std::string const &str)
+{
+    if (str.size() > 2) {
+        auto &&prefix = str.substr(0, 2);
+        if (prefix == "0x" || prefix == "0X") {
+            return std::stoul(str.substr(2), nullptr, 16);
+        }
+    }
+    return std::stoul(str);
+}
+
+// One core's ports in VMultiTop, so cores can be driven by index
+struct CorePorts
+{
+    CData *clock;
+    CData *reset;
+    IData *instruction_address;
+    IData *instruction;
+    CData *instruction_valid;
+    IData *memory_address;
+    IData *memory_write_data;
+    CData *memory_write_enable;
+    CData *memory_write_strobe[4];
+    IData *memory_read_data;
+    CData *device_select;
+    IData *interrupt_flag;
+    CData *regs_write_enable;
+    CData *regs_write_address;
+    IData *regs_write_data;
+    CData *retire_valid;
+    IData *retire_instruction;
+    CData *hazard_pc_stall;
+    CData *hazard_if_flush;
+    CData *hazard_id_flush;
+    CData *hazard_stall_reason;
+    IData *hazard_stall_pc;
+    IData *hazard_flush_pc;
+    CData *hazard_interrupt_entry;
+    CData *hazard_interrupt_exit;
+    CData *hazard_trap;
+};
+
+#define CORE_PORTS(top, n)                                                 \
+    CorePorts                                                              \
+    {                                                                      \
+        &top->io_clocks_##n, &top->io_resets_##n,                          \
+            &top->io_cores_##n##_instruction_address,                      \
+            &top->io_cores_##n##_instruction,                              \
+            &top->io_cores_##n##_instruction_valid,                        \
+            &top->io_cores_##n##_memory_bundle_address,                    \
+            &top->io_cores_##n##_memory_bundle_write_data,                 \
+            &top->io_cores_##n##_memory_bundle_write_enable,               \
+            {&top->io_cores_##n##_memory_bundle_write_strobe_0,            \
+             &top->io_cores_##n##_memory_bundle_write_strobe_1,            \
+             &top->io_cores_##n##_memory_bundle_write_strobe_2,            \
+             &top->io_cores_##n##_memory_bundle_write_strobe_3},           \
+            &top->io_cores_##n##_memory_bundle_read_data,                  \
+            &top->io_cores_##n##_device_select,                            \
+            &top->io_cores_##n##_interrupt_flag,                           \
+            &top->io_cores_##n##_debug_regs_write_enable,                  \
+            &top->io_cores_##n##_debug_regs_write_address,                 \
+            &top->io_cores_##n##_debug_regs_write_data,                    \
+            &top->io_cores_##n##_retire_valid,                             \
+            &top->io_cores_##n##_retire_instruction,                       \
+            &top->io_cores_##n##_hazard_pc_stall,                          \
+            &top->io_cores_##n##_hazard_if_flush,                          \
+            &top->io_cores_##n##_hazard_id_flush,                          \
+            &top->io_cores_##n##_hazard_stall_reason,                      \
+            &top->io_cores_##n##_hazard_stall_pc,                          \
+            &top->io_cores_##n##_hazard_flush_pc,                          \
+            &top->io_cores_##n##_hazard_interrupt_entry,                   \
+            &top->io_cores_##n##_hazard_interrupt_exit,                    \
+            &top->io_cores_##n##_hazard_trap                               \
+    }
+
+// Core names in MultiTop order (riscv.ImplementationType)
+static const char *const core_names[] = {
+    "threestage",
+    "fivestage_stall",
+    "fivestage_forward",
+    "fivestage_final",
+};
+static constexpr size_t core_count = 4;
+
+// A retired architectural effect: register write (address = rd) or store
+// (address = effective address, data masked by the byte strobes)
+struct Event
+{
+    uint64_t cycle;
+    uint32_t address;
+    uint32_t data;
+    uint32_t mask;
+    bool sync = false;  // data read from a counter, not compared
+};
+
+// csrrw/csrrs/csrrc and their immediate forms reading a counter CSR
+static bool reads_counter(uint32_t instruction)
+{
+    return (instruction & 0x7F) == 0x73 && ((instruction >> 12) & 3) != 0 &&
+           rv32::csr::counter(instruction >> 20);
+}
+
+struct Core
+{
+    size_t index;
+    CorePorts ports;
+    std::unique_ptr<Memory> memory;
+    uint64_t cycles = 0;
+    uint64_t regs_writes = 0;
+    uint64_t stores = 0;
+    bool halted = false;
+    std::deque<Event> pending_writes;
+    std::deque<Event> pending_stores;
+    rv32::CpiStack cpi_stack;
+
+    const char *name() const { return core_names[index]; }
+
+    // Drive instruction and data memory from the addresses the core presents
+    void drive()
+    {
+        *ports.instruction = memory->read(*ports.instruction_address);
+        *ports.memory_read_data = memory->read(*ports.memory_address);
+    }
+
+    // Sample the write ports before the clock edge commits them
+    void observe(bool record, bool uart)
+    {
+        rv32::HazardSample hazard;
+        hazard.retired = *ports.retire_valid;
+        hazard.pc_stall = *ports.hazard_pc_stall;
+        hazard.if_flush = *ports.hazard_if_flush;
+        hazard.id_flush = *ports.hazard_id_flush;
+        hazard.stall_reason = *ports.hazard_stall_reason;
+        hazard.stall_pc = *ports.hazard_stall_pc;
+        hazard.flush_pc = *ports.hazard_flush_pc;
+        hazard.interrupt_entry = *ports.hazard_interrupt_entry;
+        hazard.interrupt_exit = *ports.hazard_interrupt_exit;
+        hazard.trap = *ports.hazard_trap;
+        cpi_stack.record(hazard);
+
+        if (*ports.regs_write_enable && *ports.regs_write_address != 0) {
+            ++regs_writes;
+            if (record) {
+                bool sync = *ports.retire_valid &&
+                            reads_counter(*ports.retire_instruction);
+                pending_writes.push_back({cycles, *ports.regs_write_address,
+                                          *ports.regs_write_data, 0, sync});
+            }
+        }
+        if (*ports.memory_write_enable) {
+            uint32_t mask = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (*ports.memory_write_strobe[i]) {
+                    mask |= 0xFFu << (i * 8);
+                }
+            }
+            uint32_t address = (uint32_t(*ports.device_select) << 29) |
+                               *ports.memory_address;
+            ++stores;
+            if (record) {
+                pending_stores.push_back({cycles, address,
+                                          *ports.memory_write_data & mask,
+                                          mask});
+            }
+            if (uart && *ports.device_select == 2) {
+                std::cout << (char) *ports.memory_write_data << std::flush;
+            }
+            memory->write(*ports.memory_address, *ports.memory_write_data,
+                          mask);
+        }
+    }
+};
+
+class Simulator
+{
+    vluint64_t max_sim_time = 10000;
+    uint32_t halt_address = 0;
+    size_t memory_words = 2 * 1024 * 1024;
+    bool lockstep = false;
+    // Cores may run this many unmatched events ahead of the slowest one
+    size_t max_lead = 4096;
+    std::unique_ptr<VMultiTop> top;
+    std::vector<Core> cores;
+    std::vector<size_t> selected;
+    bool dump_signature = false;
+    unsigned long signature_begin, signature_end;
+    std::string signature_filename;
+    std::string instruction_filename;
+    std::string cpi_stack_filename;
+
+    static size_t parse_impl(std::string const &name)
+    {
+        for (size_t i = 0; i < core_count; ++i) {
+            std::string full = core_names[i];
+            if (name == full || "fivestage_" + name == full ||
+                name == std::to_string(i)) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Unknown implementation " + name);
+    }
+
+public:
+    void parse_args(std::vector<std::string> const &args)
+    {
+        if (auto it = std::find(args.begin(), args.end(), "-halt");
+            it != args.end()) {
+            halt_address = parse_number(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-memory");
+            it != args.end()) {
+            memory_words = std::stoull(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-time");
+            it != args.end()) {
+            max_sim_time = std::stoull(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-signature");
+            it != args.end()) {
+            dump_signature = true;
+            signature_begin = parse_number(*(it + 1));
+            signature_end = parse_number(*(it + 2));
+            signature_filename = *(it + 3);
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-instruction");
+            it != args.end()) {
+            instruction_filename = *(it + 1);
+        }
+
+        // -impl threestage,final or -impl all; names as in riscv.core
+        // packages, with or without the fivestage_ prefix, or indices 0-3
+        if (auto it = std::find(args.begin(), args.end(), "-impl");
+            it != args.end()) {
+            std::string list = *(it + 1);
+            size_t begin = 0;
+            while (begin <= list.size()) {
+                size_t end = list.find(',', begin);
+                if (end == std::string::npos) {
+                    end = list.size();
+                }
+                std::string name = list.substr(begin, end - begin);
+                if (name == "all") {
+                    for (size_t i = 0; i < core_count; ++i) {
+                        selected.push_back(i);
+                    }
+                } else if (!name.empty()) {
+                    selected.push_back(parse_impl(name));
+                }
+                begin = end + 1;
+            }
+        }
+
+        if (std::find(args.begin(), args.end(), "-lockstep") != args.end()) {
+            lockstep = true;
+        }
+
+        // Per-core CPI stacks, printed at exit and written as a JSON array
+        if (auto it = std::find(args.begin(), args.end(), "-cpi-stack");
+            it != args.end()) {
+            cpi_stack_filename = *(it + 1);
+        }
+    }
+
+    Simulator(std::vector<std::string> const &args)
+        : top(std::make_unique<VMultiTop>())
+    {
+        parse_args(args);
+        if (selected.empty()) {
+            if (lockstep) {
+                for (size_t i = 0; i < core_count; ++i) {
+                    selected.push_back(i);
+                }
+            } else {
+                selected.push_back(core_count - 1);
+            }
+        }
+        std::sort(selected.begin(), selected.end());
+        selected.erase(std::unique(selected.begin(), selected.end()),
+                       selected.end());
+
+        CorePorts ports[core_count] = {
+            CORE_PORTS(top, 0),
+            CORE_PORTS(top, 1),
+            CORE_PORTS(top, 2),
+            CORE_PORTS(top, 3),
+        };
+        cores.resize(core_count);
+        for (size_t i = 0; i < core_count; ++i) {
+            cores[i].index = i;
+            cores[i].ports = ports[i];
+            *ports[i].clock = 0;
+            *ports[i].reset = 1;
+            *ports[i].instruction_valid = 1;
+            *ports[i].interrupt_flag = 0;
+        }
+        for (auto i : selected) {
+            cores[i].memory = std::make_unique<Memory>(memory_words);
+            if (!instruction_filename.empty()) {
+                cores[i].memory->load_binary(instruction_filename);
+            }
+        }
+    }
+
+    static std::string describe(Event const &event, bool regs)
+    {
+        char text[64];
+        if (regs) {
+            snprintf(text, sizeof(text), "x%u <- 0x%08x", event.address,
+                     event.data);
+        } else {
+            snprintf(text, sizeof(text), "[0x%08x] <- 0x%08x (mask 0x%08x)",
+                     event.address, event.data, event.mask);
+        }
+        return text;
+    }
+
+    // Compare the retired events every core has produced so far; events are
+    // consumed once all selected cores have reached them
+    bool compare(std::deque<Event> Core::*queue, const char *kind)
+    {
+        Core &reference = cores[selected.front()];
+        for (;;) {
+            for (auto i : selected) {
+                if ((cores[i].*queue).empty()) {
+                    return true;
+                }
+            }
+            Event expected = (reference.*queue).front();
+            for (auto i : selected) {
+                Event actual = (cores[i].*queue).front();
+                bool sync = actual.sync || expected.sync;
+                if (actual.address != expected.address ||
+                    (!sync && (actual.data != expected.data ||
+                               actual.mask != expected.mask))) {
+                    bool regs = queue == &Core::pending_writes;
+                    std::printf("Lockstep mismatch on %s:\n", kind);
+                    std::printf("  %-18s cycle %-10lu %s\n", reference.name(),
+                                (unsigned long) expected.cycle,
+                                describe(expected, regs).c_str());
+                    std::printf("  %-18s cycle %-10lu %s\n", cores[i].name(),
+                                (unsigned long) actual.cycle,
+                                describe(actual, regs).c_str());
+                    return false;
+                }
+            }
+            for (auto i : selected) {
+                (cores[i].*queue).pop_front();
+            }
+        }
+    }
+
+    int run()
+    {
+        vluint64_t max_cycles = max_sim_time / 4;
+        bool failed = false;
+
+        // Two reset cycles, as the single-core harness holds reset
+        for (int cycle = 0; cycle < 2; ++cycle) {
+            for (auto i : selected) {
+                *cores[i].ports.clock = 1;
+            }
+            top->eval();
+            for (auto i : selected) {
+                *cores[i].ports.clock = 0;
+            }
+            top->eval();
+        }
+        for (auto i : selected) {
+            *cores[i].ports.reset = 0;
+        }
+
+        std::vector<Core *> active;
+        for (vluint64_t cycle = 0;
+             cycle < max_cycles && !failed && !Verilated::gotFinish();
+             ++cycle) {
+            active.clear();
+            for (auto i : selected) {
+                Core &core = cores[i];
+                if (core.halted) {
+                    continue;
+                }
+                if (lockstep && (core.pending_writes.size() > max_lead ||
+                                 core.pending_stores.size() > max_lead)) {
+                    continue;
+                }
+                active.push_back(&core);
+            }
+            if (active.empty()) {
+                bool all_halted = std::all_of(
+                    selected.begin(), selected.end(),
+                    [this](size_t i) { return cores[i].halted; });
+                if (!all_halted) {
+                    std::printf(
+                        "Lockstep mismatch: cores stopped making matching "
+                        "progress at cycle %lu\n",
+                        (unsigned long) cycle);
+                    failed = true;
+                }
+                break;
+            }
+
+            for (auto core : active) {
+                *core->ports.clock = 0;
+                core->drive();
+            }
+            top->eval();
+            for (auto core : active) {
+                core->observe(lockstep, core == &cores[selected.front()]);
+                *core->ports.clock = 1;
+            }
+            top->eval();
+            for (auto core : active) {
+                ++core->cycles;
+                if (halt_address &&
+                    core->memory->read(halt_address) == 0xBABECAFE) {
+                    core->halted = true;
+                }
+            }
+
+            if (lockstep) {
+                failed = !compare(&Core::pending_writes, "register write") ||
+                         !compare(&Core::pending_stores, "store");
+            }
+        }
+
+        // Every halted core must have retired exactly the same events
+        if (lockstep && !failed &&
+            std::all_of(selected.begin(), selected.end(),
+                        [this](size_t i) { return cores[i].halted; })) {
+            for (auto i : selected) {
+                if (!cores[i].pending_writes.empty() ||
+                    !cores[i].pending_stores.empty()) {
+                    std::printf(
+                        "Lockstep mismatch: %s halted with %zu register "
+                        "writes and %zu stores not retired by every core\n",
+                        cores[i].name(), cores[i].pending_writes.size(),
+                        cores[i].pending_stores.size());
+                    failed = true;
+                }
+            }
+        }
+
+        std::printf("\n%-18s %12s %12s %10s %8s\n", "implementation",
+                    "cycles", "reg writes", "stores", "halted");
+        for (auto i : selected) {
+            Core &core = cores[i];
+            std::printf("%-18s %12lu %12lu %10lu %8s\n", core.name(),
+                        (unsigned long) core.cycles,
+                        (unsigned long) core.regs_writes,
+                        (unsigned long) core.stores,
+                        core.halted ? "yes" : "no");
+        }
+        if (lockstep) {
+            std::printf("Lockstep: %s\n", failed ? "MISMATCH" : "match");
+        }
+
+        if (!cpi_stack_filename.empty()) {
+            std::ofstream json(cpi_stack_filename);
+            json << '[';
+            for (auto i : selected) {
+                cores[i].cpi_stack.print(stdout, cores[i].name());
+                json << (i == selected.front() ? "\n" : ",\n");
+                cores[i].cpi_stack.write_json(json, cores[i].name());
+            }
+            json << "\n]" << std::endl;
+        }
+
+        if (dump_signature) {
+            Memory &memory = *cores[selected.front()].memory;
+            char data[9] = {0};
+            std::ofstream signature_file(signature_filename);
+            for (size_t addr = signature_begin; addr < signature_end;
+                 addr += 4) {
+                snprintf(data, 9, "%08x", memory.read(addr));
+                signature_file << data << std::endl;
+            }
+        }
+        return failed ? 1 : 0;
+    }
+
+    ~Simulator()
+    {
+        if (top) {
+            top->final();
+        }
+    }
+};
+
+int main(int argc, char **argv)
+{
+    Verilated::commandArgs(argc, argv);
+    std::vector<std::string> args(argv, argv + argc);
+    Simulator simulator(args);
+    return simulator.run();
+}
@@ -1,5 +1,7 @@
 #include <verilated.h>
+#if VM_TRACE
 #include <verilated_vcd_c.h>
+#endif
 
 #include <algorithm>
 #include <fstream>
@@ -8,16 +10,31 @@
 #include <string>
 #include <vector>
 
+#include "../../../common/verilator/rv32_backdoor.h"
+#include "../../../common/verilator/rv32_bbv.h"
+#include "../../../common/verilator/rv32_commit_log.h"
+#include "../../../common/verilator/rv32_cpi_stack.h"
+#include "../../../common/verilator/rv32_kanata.h"
+#include "../../../common/verilator/rv32_lockstep.h"
+#include "../../../common/verilator/rv32_mem_trace.h"
+#include "../../../common/verilator/rv32_probe.h"
+#include "../../../common/verilator/rv32_profile.h"
+#include "../../../common/verilator/rv32_shared_memory.h"
 #include "VTop.h"  // From Verilating "top.v"
 
 class Memory
 {
-    std::vector<uint32_t> memory;
+    rv32::SharedMemory memory;
 
 public:
     // Mở rộng bộ nhớ lên 256MB để tránh lỗi Stack Pointer (sp) vượt quá giới hạn 4MB cũ
     // 64 * 1024 * 1024 words = 256MB
-    Memory(size_t size) : memory(size, 0) {}
+    Memory(size_t size, std::string const &shm_name = "")
+        : memory(size, shm_name)
+    {
+    }
+
+    rv32::SharedMemory &storage() { return memory; }
 
     uint32_t read(size_t address)
     {
@@ -85,6 +102,7 @@ public:
     }
 };
 
+#if VM_TRACE
 class VCDTracer
 {
     VerilatedVcdC *tfp = nullptr;
@@ -119,6 +137,48 @@ public:
         }
     }
 };
+#else
+// Model built without --trace (e.g. benchmark builds): nothing to dump
+class VCDTracer
+{
+public:
+    void enable(std::string const &filename, VTop &)
+    {
+        throw std::runtime_error("Cannot write " + filename +
+                                 ": model was built without --trace");
+    }
+
+    void dump(vluint64_t) {}
+};
+#endif
+
+// Reference model view of the memory map in Simulator::run: every access
+// goes to memory with the device bits stripped. Loads with a nonzero
+// io_device_select are reported as device reads, so the checker takes
+// their value from the core instead of comparing it
+struct IssBus
+{
+    rv32::SparseMemory memory;
+    bool echo_uart = false;  // print UART writes (set while fast-forwarding)
+
+    IssBus(size_t words) : memory(words) {}
+
+    uint32_t fetch(uint32_t address) { return memory.read(address); }
+
+    uint32_t load(uint32_t address, bool &device)
+    {
+        device = (address >> 29) != 0;
+        return memory.read(address & 0x1FFFFFFF);
+    }
+
+    void store(uint32_t address, uint32_t data, uint32_t mask)
+    {
+        if (echo_uart && (address >> 29) == 2) {
+            std::cout << (char) data << std::flush;
+        }
+        memory.write(address & 0x1FFFFFFF, data, mask);
+    }
+};
 
 uint32_t parse_number(std::string const &str)
 {
@@ -131,6 +191,71 @@ uint32_t parse_number(std::string const &str)
     return std::stoul(str);
 }
 
+// Top-level ports -probe can sample
+rv32::ProbePorts probe_ports(VTop const &top)
+{
+    rv32::ProbePorts ports;
+#define PROBE(port) ports.add(#port, &top.port)
+    PROBE(io_instruction_address);
+    PROBE(io_instruction);
+    PROBE(io_instruction_valid);
+    PROBE(io_memory_bundle_address);
+    PROBE(io_memory_bundle_read_data);
+    PROBE(io_memory_bundle_write_data);
+    PROBE(io_memory_bundle_write_enable);
+    PROBE(io_memory_bundle_write_strobe_0);
+    PROBE(io_memory_bundle_write_strobe_1);
+    PROBE(io_memory_bundle_write_strobe_2);
+    PROBE(io_memory_bundle_write_strobe_3);
+    PROBE(io_device_select);
+    PROBE(io_interrupt_flag);
+    PROBE(io_hazard_pc_stall);
+    PROBE(io_hazard_if_flush);
+    PROBE(io_hazard_id_flush);
+    PROBE(io_hazard_stall_reason);
+    PROBE(io_hazard_stall_pc);
+    PROBE(io_hazard_flush_pc);
+    PROBE(io_hazard_trap);
+    PROBE(io_hazard_interrupt_entry);
+    PROBE(io_hazard_interrupt_exit);
+    PROBE(io_pipeline_stages_0_valid);
+    PROBE(io_pipeline_stages_0_pc);
+    PROBE(io_pipeline_stages_0_instruction);
+    PROBE(io_pipeline_stages_0_id);
+    PROBE(io_pipeline_stages_1_valid);
+    PROBE(io_pipeline_stages_1_pc);
+    PROBE(io_pipeline_stages_1_instruction);
+    PROBE(io_pipeline_stages_1_id);
+    PROBE(io_pipeline_stages_2_valid);
+    PROBE(io_pipeline_stages_2_pc);
+    PROBE(io_pipeline_stages_2_instruction);
+    PROBE(io_pipeline_stages_2_id);
+    PROBE(io_pipeline_stages_3_valid);
+    PROBE(io_pipeline_stages_3_pc);
+    PROBE(io_pipeline_stages_3_instruction);
+    PROBE(io_pipeline_stages_3_id);
+    PROBE(io_pipeline_stages_4_valid);
+    PROBE(io_pipeline_stages_4_pc);
+    PROBE(io_pipeline_stages_4_instruction);
+    PROBE(io_pipeline_stages_4_id);
+    PROBE(io_pipeline_retire_valid);
+    PROBE(io_pipeline_retire_id);
+    PROBE(io_retire_valid);
+    PROBE(io_retire_pc);
+    PROBE(io_retire_instruction);
+    PROBE(io_retire_rd_address);
+    PROBE(io_retire_rd_data);
+    PROBE(io_retire_memory_address);
+    PROBE(io_retire_memory_read);
+    PROBE(io_retire_memory_read_data);
+    PROBE(io_retire_memory_write_data);
+    PROBE(io_retire_memory_write_strobe);
+    PROBE(io_retire_trap);
+    PROBE(io_retire_interrupt);
+#undef PROBE
+    return ports;
+}
+
 class Simulator
 {
     vluint64_t main_time = 0;
@@ -142,10 +267,42 @@ class Simulator
     std::unique_ptr<VTop> top;
     std::unique_ptr<VCDTracer> vcd_tracer;
     std::unique_ptr<Memory> memory;
+    std::string shm_name;
+    rv32::SharedMemory *shared_memory = nullptr;
     bool dump_signature = false;
     unsigned long signature_begin, signature_end;
     std::string signature_filename;
     std::string instruction_filename;
+    bool check_iss = false;
+    std::unique_ptr<IssBus> iss_bus;
+    std::unique_ptr<rv32::Hart<IssBus>> iss;
+    std::unique_ptr<rv32::LockstepChecker<IssBus>> iss_checker;
+    bool fast_forward = false;
+    uint64_t ff_instructions = UINT64_MAX;
+    bool has_ff_until = false;
+    uint32_t ff_until = 0;
+    uint64_t ff_retired = 0;
+    uint64_t warmup_cycles = 0;
+    uint64_t warmup_instret = 0;
+    uint64_t detail_instructions = 0;
+    std::string bbv_filename;
+    uint64_t bbv_interval = 100000;
+    uint64_t bbv_max = UINT64_MAX;
+    std::string commit_log_filename;
+    std::unique_ptr<rv32::CommitLogWriter> commit_log;
+    std::string cpi_stack_filename;
+    std::unique_ptr<rv32::CpiStack> cpi_stack;
+    std::string kanata_filename;
+    std::unique_ptr<rv32::KanataWriter> kanata;
+    std::string profile_filename;
+    std::string elf_filename;
+    std::unique_ptr<rv32::Profiler> profiler;
+    std::string mem_trace_filename;
+    std::unique_ptr<rv32::MemTraceWriter> mem_trace;
+    std::string probe_filename;
+    std::string probe_signals = "*";
+    uint64_t probe_interval = 1;
+    std::unique_ptr<rv32::ProbeWriter> probes;
 
 public:
     void parse_args(std::vector<std::string> const &args)
@@ -182,6 +339,133 @@ public:
             it != args.end()) {
             instruction_filename = *(it + 1);
         }
+
+        // Guest memory in /dev/shm/NAME (or a memfd for memfd:NAME) that
+        // tools map while the core runs (scripts/guestmem.py)
+        if (auto it = std::find(args.begin(), args.end(), "-shm");
+            it != args.end()) {
+            shm_name = *(it + 1);
+        }
+
+        // Check every register write and store against the built-in ISS
+        if (std::find(args.begin(), args.end(), "-iss") != args.end()) {
+            check_iss = true;
+        }
+
+        // Run the first N instructions, or up to a PC, on the ISS and then
+        // continue on the core; -warmup cycles are left out of the statistics
+        if (auto it = std::find(args.begin(), args.end(), "-ff");
+            it != args.end()) {
+            fast_forward = true;
+            ff_instructions = std::stoull(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-ff-until");
+            it != args.end()) {
+            fast_forward = true;
+            has_ff_until = true;
+            ff_until = parse_number(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-warmup");
+            it != args.end()) {
+            warmup_cycles = std::stoull(*(it + 1));
+        }
+
+        // Stop after N instructions past the switch point; they are counted
+        // by the ISS checker, so this turns on -iss
+        if (auto it = std::find(args.begin(), args.end(), "-detail");
+            it != args.end()) {
+            detail_instructions = std::stoull(*(it + 1));
+            check_iss = true;
+        }
+
+        // Profile basic-block vectors on the ISS only (no RTL simulation)
+        if (auto it = std::find(args.begin(), args.end(), "-bbv");
+            it != args.end()) {
+            bbv_filename = *(it + 1);
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-bbv-interval");
+            it != args.end()) {
+            bbv_interval = std::stoull(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-bbv-max");
+            it != args.end()) {
+            bbv_max = std::stoull(*(it + 1));
+        }
+
+        // Binary log of every retired instruction (scripts/commitlog.py)
+        if (auto it = std::find(args.begin(), args.end(), "-commit-log");
+            it != args.end()) {
+            commit_log_filename = *(it + 1);
+            commit_log =
+                std::make_unique<rv32::CommitLogWriter>(commit_log_filename);
+        }
+
+        // Charge every stall and flush cycle to its cause and PC; printed at
+        // exit and written as JSON
+        if (auto it = std::find(args.begin(), args.end(), "-cpi-stack");
+            it != args.end()) {
+            cpi_stack_filename = *(it + 1);
+            cpi_stack = std::make_unique<rv32::CpiStack>();
+        }
+
+        // Pipeline diagram for Konata, optionally of cycles FIRST to LAST only
+        if (auto it = std::find(args.begin(), args.end(), "-kanata");
+            it != args.end()) {
+            kanata_filename = *(it + 1);
+            uint64_t first = 0, last = UINT64_MAX;
+            if (auto window =
+                    std::find(args.begin(), args.end(), "-kanata-window");
+                window != args.end()) {
+                first = std::stoull(*(window + 1));
+                last = std::stoull(*(window + 2));
+            }
+            kanata = std::make_unique<rv32::KanataWriter>(kanata_filename,
+                                                          first, last);
+        }
+
+        // Cycles per PC, function and call path; -elf names them
+        if (auto it = std::find(args.begin(), args.end(), "-profile");
+            it != args.end()) {
+            profile_filename = *(it + 1);
+            profiler = std::make_unique<rv32::Profiler>();
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-elf");
+            it != args.end()) {
+            elf_filename = *(it + 1);
+        }
+
+        // Fetch and data access stream for tools/cachesim
+        if (auto it = std::find(args.begin(), args.end(), "-mem-trace");
+            it != args.end()) {
+            mem_trace_filename = *(it + 1);
+            mem_trace =
+                std::make_unique<rv32::MemTraceWriter>(mem_trace_filename);
+        }
+
+        // Columns of port values (scripts/probes.py); -probe-signals takes
+        // comma-separated names or patterns such as io_hazard_*
+        if (auto it = std::find(args.begin(), args.end(), "-probe-signals");
+            it != args.end()) {
+            probe_signals = *(it + 1);
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-probe-interval");
+            it != args.end()) {
+            probe_interval = std::stoull(*(it + 1));
+        }
+
+        if (auto it = std::find(args.begin(), args.end(), "-probe");
+            it != args.end()) {
+            probe_filename = *(it + 1);
+            probes = std::make_unique<rv32::ProbeWriter>(
+                probe_filename, probe_ports(*top).select(probe_signals),
+                probe_interval);
+        }
     }
 
     Simulator(std::vector<std::string> const &args)
@@ -189,14 +473,119 @@ public:
           vcd_tracer(std::make_unique<VCDTracer>())
     {
         parse_args(args);
-        memory = std::make_unique<Memory>(memory_words);
+        memory = std::make_unique<Memory>(memory_words, shm_name);
+        if (memory->storage().shared()) {
+            shared_memory = &memory->storage();
+            std::cerr << "Guest memory shared at " << shared_memory->path()
+                      << std::endl;
+        }
         if (!instruction_filename.empty()) {
             memory->load_binary(instruction_filename);
         }
+        if (check_iss || fast_forward || !bbv_filename.empty()) {
+            iss_bus = std::make_unique<IssBus>(memory_words);
+            if (!instruction_filename.empty()) {
+                iss_bus->memory.load_binary(instruction_filename);
+            }
+            iss = std::make_unique<rv32::Hart<IssBus>>(*iss_bus);
+            iss->trap_sets_mpp = true;
+        }
+        if (check_iss) {
+            iss_checker =
+                std::make_unique<rv32::LockstepChecker<IssBus>>(*iss);
+        }
     }
 
-    void run()
+    // Run the program on the ISS up to the switch point, then copy memory
+    // into the harness and registers, CSRs and PC into the core. Called while
+    // the core sits in reset, so the pipeline holds no instructions.
+    void run_fast_forward()
     {
+        iss_bus->echo_uart = true;
+        while (ff_retired < ff_instructions &&
+               !(has_ff_until && iss->pc == ff_until)) {
+            rv32::Retired r = iss->step();
+            ++ff_retired;
+            if (rv32::parked(*iss, r)) {
+                // Nothing left to skip once the program has finished
+                break;
+            }
+        }
+        iss_bus->echo_uart = false;
+        if (has_ff_until && iss->pc != ff_until) {
+            std::cout << "Fast-forward: PC 0x" << std::hex << ff_until
+                      << " not reached" << std::dec << std::endl;
+        }
+
+        bool strobe[4] = {true, true, true, true};
+        iss_bus->memory.for_each_word([&](uint32_t address, uint32_t word) {
+            memory->write(address, word, strobe);
+        });
+        rv32::Backdoor("TOP.Top.cpu.cpu").load(*iss);
+        std::cout << "Fast-forward: " << ff_retired
+                  << " instructions on the ISS, switching to RTL at PC 0x"
+                  << std::hex << iss->pc << std::dec << std::endl;
+    }
+
+    // Feed the results the core retires this cycle to the ISS checker; called
+    // just before the rising edge, while the write ports are settled
+    bool check_retired(uint64_t cycle)
+    {
+        if (top->io_debug_regs_write_enable &&
+            top->io_debug_regs_write_address != 0 &&
+            !iss_checker->reg_write(cycle, top->io_debug_regs_write_address,
+                                    top->io_debug_regs_write_data)) {
+            return false;
+        }
+        if (top->io_memory_bundle_write_enable) {
+            uint32_t mask = 0;
+            if (top->io_memory_bundle_write_strobe_0)
+                mask |= 0x000000FF;
+            if (top->io_memory_bundle_write_strobe_1)
+                mask |= 0x0000FF00;
+            if (top->io_memory_bundle_write_strobe_2)
+                mask |= 0x00FF0000;
+            if (top->io_memory_bundle_write_strobe_3)
+                mask |= 0xFF000000;
+            uint32_t address = (uint32_t(top->io_device_select) << 29) |
+                               top->io_memory_bundle_address;
+            return iss_checker->store(cycle, address,
+                                      top->io_memory_bundle_write_data, mask);
+        }
+        return true;
+    }
+
+    // Run the whole program on the ISS and write its basic-block vectors;
+    // it ends when the program parks ("j ." or wfi with interrupts off), at
+    // the -halt marker or after -bbv-max instructions
+    int run_bbv_profile()
+    {
+        rv32::BbvProfiler profiler(bbv_filename, bbv_interval);
+        uint64_t retired = 0;
+        while (retired < bbv_max) {
+            rv32::Retired r = iss->step();
+            profiler.retire(r);
+            ++retired;
+            if (rv32::parked(*iss, r) ||
+                (halt_address &&
+                 iss_bus->memory.read(halt_address) == 0xBABECAFE)) {
+                break;
+            }
+        }
+        profiler.finish();
+        std::cout << "BBV: " << retired << " instructions, "
+                  << profiler.written() << " intervals of " << bbv_interval
+                  << ", " << profiler.blocks() << " basic blocks written to "
+                  << bbv_filename << std::endl;
+        return 0;
+    }
+
+    int run()
+    {
+        if (!bbv_filename.empty()) {
+            return run_bbv_profile();
+        }
+
         top->reset = 1;
         top->clock = 0;
         top->io_instruction_valid = 1;
@@ -211,14 +600,23 @@ public:
         int uart_write_time_counter = 0,
             uart_write_time_limit =
                 4;  // every limit, an UART write completes; this is tricky part
+        uint64_t cycle = 0;
+        if (shared_memory) {
+            shared_memory->set_status(rv32::SHM_RUNNING);
+        }
+        bool halted = false;
         while (main_time < max_sim_time && !Verilated::gotFinish()) {
             ++main_time;
             ++counter;
+            bool clock_before = top->clock;
             if (counter > clocktime) {
                 top->clock = !top->clock;
                 counter = 0;
             }
-            if (main_time & 0x00ff0 == 0xff0) {
+            if (iss_checker) {
+                // Interrupt timing is not modelled by the ISS
+                top->io_interrupt_flag = 0;
+            } else if (main_time & 0x00ff0 == 0xff0) {
                 top->io_interrupt_flag = 1;
             } else {
                 top->io_interrupt_flag = 0;
@@ -230,9 +628,49 @@ public:
             top->io_memory_bundle_read_data = data_memory_read_word;
             top->io_instruction = inst_memory_read_word;
             top->clock = !top->clock;
+            if (!clock_before && top->clock && !top->reset) {
+                if (commit_log) {
+                    commit_log->sample(cycle, *top);
+                }
+                if (cpi_stack && cycle >= warmup_cycles) {
+                    cpi_stack->sample(*top);
+                }
+                if (kanata) {
+                    kanata->sample(cycle, *top);
+                }
+                if (profiler) {
+                    profiler->sample(cycle, *top);
+                }
+                if (mem_trace) {
+                    mem_trace->sample(cycle, *top);
+                }
+                if (probes) {
+                    probes->sample(cycle);
+                }
+                if (shared_memory) {
+                    shared_memory->sample(cycle, *top);
+                }
+                if (iss_checker && !check_retired(cycle)) {
+                    break;
+                }
+                if (detail_instructions &&
+                    iss->instret - ff_retired >= detail_instructions) {
+                    break;
+                }
+                if (++cycle == warmup_cycles && iss) {
+                    warmup_instret = iss->instret;
+                }
+            }
             top->eval();
             top->io_interrupt_flag = 0;
 
+            // Reset is released in the next step: hand over the ISS state now
+            // so that no reset edge overwrites it
+            if (fast_forward && main_time == 2) {
+                run_fast_forward();
+                top->eval();
+            }
+
             if (top->io_device_select == 2 &&
                 top->io_memory_bundle_write_enable) {
                 if (uart_write_time_counter == 0)
@@ -257,15 +695,18 @@ public:
                               top->io_memory_bundle_write_data,
                               memory_write_strobe);
             }
-            vcd_tracer->dump(main_time);
+            if (cycle >= warmup_cycles) {
+                vcd_tracer->dump(main_time);
+            }
             if (halt_address) {
                 if (memory->read(halt_address) == 0xBABECAFE) {
+                    halted = true;
                     break;
                 }
             }
 
             // print simulation progress in percentage every 1%
-            if (main_time % (max_sim_time / 100) == 0) {
+            if (main_time % std::max<vluint64_t>(1, max_sim_time / 100) == 0) {
                 std::cout << "Simulation progress: "
                           << (main_time * 100 / max_sim_time) << "%"
                           << std::endl;
@@ -281,6 +722,87 @@ public:
                 signature_file << data << std::endl;
             }
         }
+
+        if (shared_memory) {
+            shared_memory->set_status(halted ? rv32::SHM_HALTED
+                                             : rv32::SHM_EXITED);
+        }
+
+        if (commit_log) {
+            commit_log->finish();
+            std::cout << "Commit log: " << commit_log->written()
+                      << " instructions written to " << commit_log_filename
+                      << std::endl;
+        }
+
+        if (kanata) {
+            kanata->finish();
+            std::cout << "Pipeline log: " << kanata->instructions()
+                      << " instructions (" << kanata->flushes()
+                      << " flushed) written to " << kanata_filename
+                      << std::endl;
+        }
+
+        if (cpi_stack) {
+            cpi_stack->print(stdout, "Top");
+            std::ofstream json(cpi_stack_filename);
+            cpi_stack->write_json(json, "Top");
+            json << std::endl;
+        }
+
+        if (mem_trace) {
+            mem_trace->finish();
+            std::cout << "Memory trace: " << mem_trace->instructions()
+                      << " fetches, " << mem_trace->accesses()
+                      << " data accesses written to " << mem_trace_filename
+                      << std::endl;
+        }
+
+        if (probes) {
+            probes->finish();
+            std::cout << "Probes: " << probes->rows() << " samples of "
+                      << probes->signals() << " signals written to "
+                      << probe_filename << std::endl;
+        }
+
+        if (profiler) {
+            std::unique_ptr<rv32::ElfSymbols> elf;
+            if (!elf_filename.empty()) {
+                elf = std::make_unique<rv32::ElfSymbols>(elf_filename);
+            }
+            profiler->write(profile_filename, elf.get());
+            std::cout << "Profile: " << profiler->cycles() << " cycles, "
+                      << profiler->instructions()
+                      << " instructions written to " << profile_filename
+                      << std::endl;
+        }
+
+        if (fast_forward || warmup_cycles || detail_instructions) {
+            uint64_t measured =
+                cycle > warmup_cycles ? cycle - warmup_cycles : 0;
+            std::cout << "Detailed simulation: " << measured << " cycles";
+            if (warmup_cycles) {
+                std::cout << " after " << warmup_cycles << " warm-up cycles";
+            }
+            // The checker keeps the ISS in step with the core, so its
+            // instret counts what the core retired
+            uint64_t instructions =
+                iss ? iss->instret - std::max(warmup_instret, ff_retired) : 0;
+            if (iss_checker && measured && instructions) {
+                std::cout << ", " << instructions << " instructions (CPI "
+                          << double(measured) / instructions << ")";
+            }
+            std::cout << std::endl;
+        }
+
+        if (iss_checker) {
+            std::cout << "ISS check: " << iss_checker->matched()
+                      << " results matched"
+                      << (iss_checker->ok() ? "" : " before the mismatch")
+                      << std::endl;
+            return iss_checker->ok() ? 0 : 1;
+        }
+        return 0;
     }
 
     ~Simulator()
@@ -296,6 +818,5 @@ int main(int argc, char **argv)
     Verilated::commandArgs(argc, argv);
     std::vector<std::string> args(argv, argv + argc);
     Simulator simulator(args);
-    simulator.run();
-    return 0;
+    return simulator.run();
 }
\ No newline at end of file
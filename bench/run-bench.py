@@ -0,0 +1,400 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""
+Simulator throughput benchmark for the Verilator harnesses.
+
+Builds each project's VTop under a matrix of build options and runs a fixed
+program set for a fixed number of cycles, reporting simulator throughput.
+
+Build matrix (one Verilator model per combination):
+  trace    on/off   --trace, and -vcd /dev/null at run time when on
+  opt      0-3      Verilator -O<n> and OPT_FAST=-O<n> for the model C++
+  threads  N        Verilator --threads N
+  variant  name     harness build variant (see HARNESS_VARIANTS)
+
+Program set:
+  fibonacci, quicksort   from each project's src/main/resources
+  nyancat                2-mmio-trap only, headless (no SDL window)
+  loop                   generated compute loop with loads, stores, branches
+
+With --pgo, each project's profile-guided build from `make sim-pgo`
+(verilog/verilator/obj_dir_pgo/VTop) is benchmarked as well and compared
+against the matrix model built with the same options (no trace, -O3).
+
+Each (model, program) pair runs --repeat times for --cycles cycles. Reported
+per pair: simulated cycles/sec (mean, stdev), startup time (a one-cycle run)
+and peak RSS. Results are printed as a table and written as JSON.
+
+Usage:
+    python3 bench/run-bench.py
+    python3 bench/run-bench.py --projects 3-pipeline --trace off --opt 2,3
+"""
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import struct
+import subprocess
+import sys
+import time
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List, Tuple
+
+ROOT = Path(__file__).resolve().parent.parent
+BENCH_DIR = ROOT / 'bench'
+
+# Every harness toggles the clock once per two main_time steps, so one clock
+# cycle is four steps of -time.
+STEPS_PER_CYCLE = 4
+
+# Matrix configuration matching how `make sim-pgo` builds its model
+PGO_BASELINE = 'notrace-O3-t1-default'
+
+# Startup is measured with a run this long (in cycles): load, elaborate, reset.
+STARTUP_CYCLES = 1
+
+
+@dataclass
+class Project:
+    """A project whose Verilator harness can be benchmarked."""
+    name: str
+    sbt_project: str
+    extra_sources: List[str] = field(default_factory=list)
+    extra_flags: List[str] = field(default_factory=list)
+    programs: List[str] = field(default_factory=list)
+
+
+PROJECTS: Dict[str, Project] = {
+    '1-single-cycle': Project(
+        '1-single-cycle', 'singleCycle',
+        programs=['fibonacci', 'quicksort', 'loop']),
+    '2-mmio-trap': Project(
+        '2-mmio-trap', 'mmioTrap',
+        extra_sources=['../../src/main/resources/vsrc/TrueDualPortRAM32.v',
+                       '../../../common/verilator/backdoor.vlt', 'vga.vlt'],
+        extra_flags=['--vpi', '-Wno-WIDTHEXPAND', '-Wno-WIDTH'],
+        programs=['fibonacci', 'quicksort', 'nyancat', 'loop']),
+    '3-pipeline': Project(
+        '3-pipeline', 'pipeline',
+        extra_sources=['../../../common/verilator/backdoor.vlt'],
+        extra_flags=['--vpi'],
+        programs=['fibonacci', 'quicksort', 'loop']),
+}
+
+
+@dataclass
+class Variant:
+    """Harness build variant: extra C++ flags and extra run arguments."""
+    cflags: List[str] = field(default_factory=list)
+    run_args: List[str] = field(default_factory=list)
+
+
+HARNESS_VARIANTS: Dict[str, Variant] = {
+    'default': Variant(),
+    'native': Variant(cflags=['-march=native']),
+}
+
+
+@dataclass(frozen=True)
+class BuildConfig:
+    """One point of the build matrix."""
+    trace: bool
+    opt: int
+    threads: int
+    variant: str
+
+    @property
+    def name(self) -> str:
+        trace = 'trace' if self.trace else 'notrace'
+        return f"{trace}-O{self.opt}-t{self.threads}-{self.variant}"
+
+
+# RV32I encoders for the generated compute loop
+def enc_r(funct7: int, rs2: int, rs1: int, funct3: int, rd: int, opcode: int) -> int:
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def enc_i(imm: int, rs1: int, funct3: int, rd: int, opcode: int) -> int:
+    return ((imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def enc_s(imm: int, rs2: int, rs1: int, funct3: int) -> int:
+    imm &= 0xFFF
+    return ((imm >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | 0x23
+
+
+def enc_b(offset: int, rs2: int, rs1: int, funct3: int) -> int:
+    imm = offset & 0x1FFF
+    return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) | \
+           (funct3 << 12) | (((imm >> 1) & 0xF) << 8) | (((imm >> 11) & 1) << 7) | 0x63
+
+
+def enc_j(offset: int, rd: int) -> int:
+    imm = offset & 0x1FFFFF
+    return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3FF) << 21) | (((imm >> 11) & 1) << 20) | \
+           (((imm >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F
+
+
+def generate_loop_program(path: Path) -> None:
+    """
+    Write an endless RV32I compute loop (loaded at 0x1000) to path.
+
+    The body mixes ALU operations, a store/load pair with a load-use
+    dependency and a mostly-taken branch, so every pipeline hazard path is
+    exercised at a steady rate for as long as the simulation runs.
+    """
+    t0, t1, t2, t3, t4, t5, t6 = 5, 6, 7, 28, 29, 30, 31
+    prologue = [
+        enc_i(0, 0, 0b000, t0, 0x13),          # addi t0, zero, 0
+        enc_i(1, 0, 0b000, t1, 0x13),          # addi t1, zero, 1
+        enc_i(0x400, 0, 0b000, t3, 0x13),      # addi t3, zero, 0x400 (scratch)
+    ]
+    body = [
+        enc_i(1, t0, 0b000, t0, 0x13),         # addi t0, t0, 1
+        enc_r(0, t0, t1, 0b000, t1, 0x33),     # add  t1, t1, t0
+        enc_r(0, t0, t1, 0b100, t2, 0x33),     # xor  t2, t1, t0
+        enc_i(3, t2, 0b001, t2, 0x13),         # slli t2, t2, 3
+        enc_i(5, t2, 0b101, t4, 0x13),         # srli t4, t2, 5
+        enc_r(0, t4, t1, 0b110, t1, 0x33),     # or   t1, t1, t4
+        enc_s(0, t1, t3, 0b010),               # sw   t1, 0(t3)
+        enc_i(0, t3, 0b010, t5, 0x03),         # lw   t5, 0(t3)
+        enc_r(0, t5, t1, 0b000, t1, 0x33),     # add  t1, t1, t5 (load-use)
+        enc_i(0xFF, t0, 0b111, t6, 0x13),      # andi t6, t0, 0xff
+    ]
+    # bne t6, zero, loop ; sw t0, 4(t3) ; jal zero, loop
+    bne_offset = -4 * len(body)
+    body.append(enc_b(bne_offset, 0, t6, 0b001))
+    body.append(enc_s(4, t0, t3, 0b010))
+    body.append(enc_j(-4 * len(body), 0))
+
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with open(path, 'wb') as f:
+        for word in prologue + body:
+            f.write(struct.pack('<I', word))
+
+
+def program_path(project: Project, program: str) -> Path:
+    """Resolve a program name to its .asmbin for the given project."""
+    if program == 'loop':
+        path = BENCH_DIR / 'build' / 'loop.asmbin'
+        if not path.exists():
+            generate_loop_program(path)
+        return path
+    return ROOT / project.name / 'src' / 'main' / 'resources' / f'{program}.asmbin'
+
+
+def ensure_verilog(project: Project) -> Path:
+    """Generate Top.v through sbt if the project has not been elaborated yet."""
+    verilator_dir = ROOT / project.name / 'verilog' / 'verilator'
+    if not (verilator_dir / 'Top.v').exists():
+        print(f"[{project.name}] Generating Verilog...", file=sys.stderr)
+        subprocess.run(
+            ['sbt', f'project {project.sbt_project}', 'runMain board.verilator.VerilogGenerator'],
+            cwd=ROOT, check=True)
+    return verilator_dir
+
+
+def build_model(project: Project, config: BuildConfig, jobs: int) -> Path:
+    """Verilate and compile VTop for one build configuration."""
+    verilator_dir = ensure_verilog(project)
+    mdir = BENCH_DIR / 'build' / project.name / config.name
+    binary = mdir / 'VTop'
+
+    sources = [verilator_dir / 'sim.cpp', verilator_dir / 'Top.v']
+    sources += [verilator_dir / s for s in project.extra_sources]
+    if binary.exists() and all(binary.stat().st_mtime >= s.stat().st_mtime for s in sources):
+        return binary
+
+    variant = HARNESS_VARIANTS[config.variant]
+    cmd = ['verilator', '--exe', '--cc', 'sim.cpp', 'Top.v'] + project.extra_sources
+    cmd += ['-Mdir', str(mdir), f'-O{config.opt}', '--threads', str(config.threads)]
+    cmd += project.extra_flags
+    if config.trace:
+        cmd.append('--trace')
+    if variant.cflags:
+        cmd += ['-CFLAGS', ' '.join(variant.cflags)]
+
+    print(f"[{project.name}] Building {config.name}...", file=sys.stderr)
+    shutil.rmtree(mdir, ignore_errors=True)
+    subprocess.run(cmd, cwd=verilator_dir, check=True, stdout=subprocess.DEVNULL)
+    subprocess.run(['make', '-C', str(mdir), '-f', 'VTop.mk', f'-j{jobs}', f'OPT_FAST=-O{config.opt}'],
+                   check=True, stdout=subprocess.DEVNULL)
+    return binary
+
+
+def run_once(binary: Path, args: List[str]) -> Tuple[float, int]:
+    """Run the simulator once; return (wall seconds, peak RSS in KiB)."""
+    start = time.perf_counter()
+    proc = subprocess.Popen([str(binary)] + args, cwd=binary.parent,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.perf_counter() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode != 0:
+        raise RuntimeError(f"{binary} {' '.join(args)} exited with {proc.returncode}")
+    return wall, usage.ru_maxrss
+
+
+def summarize(values: List[float]) -> Dict[str, float]:
+    return {
+        'mean': statistics.mean(values),
+        'stdev': statistics.stdev(values) if len(values) > 1 else 0.0,
+    }
+
+
+def bench_binary(project: Project, binary: Path, run_args: List[str], programs: List[str],
+                 cycles: int, repeat: int) -> List[dict]:
+    """Benchmark one built model against the program set."""
+    results = []
+    for program in programs:
+        if program not in project.programs:
+            continue
+        asmbin = program_path(project, program)
+        if not asmbin.exists():
+            print(f"[{project.name}] Skipping {program}: {asmbin} not found", file=sys.stderr)
+            continue
+        base_args = ['-instruction', str(asmbin)] + run_args
+
+        startup = [run_once(binary, base_args + ['-time', str(STARTUP_CYCLES * STEPS_PER_CYCLE)])[0]
+                   for _ in range(repeat)]
+        startup_mean = statistics.mean(startup)
+
+        runs = []
+        for _ in range(repeat):
+            wall, rss = run_once(binary, base_args + ['-time', str(cycles * STEPS_PER_CYCLE)])
+            runs.append({'wall_sec': wall, 'peak_rss_kb': rss})
+
+        throughput = [cycles / max(r['wall_sec'] - startup_mean, 1e-9) for r in runs]
+        results.append({
+            'program': program,
+            'runs': runs,
+            'cycles_per_sec': summarize(throughput),
+            'startup_sec': summarize(startup),
+            'peak_rss_kb': max(r['peak_rss_kb'] for r in runs),
+        })
+    return results
+
+
+def print_table(records: List[dict]) -> None:
+    header = f"{'project':<15} {'config':<26} {'program':<10} {'cycles/s':>12} {'±stdev':>10} " \
+             f"{'startup ms':>11} {'RSS MiB':>8}"
+    print(header)
+    print('-' * len(header))
+    for rec in records:
+        for res in rec['results']:
+            cps = res['cycles_per_sec']
+            print(f"{rec['project']:<15} {rec['config']:<26} {res['program']:<10} "
+                  f"{cps['mean']:>12,.0f} {cps['stdev']:>10,.0f} "
+                  f"{res['startup_sec']['mean'] * 1000:>11.1f} {res['peak_rss_kb'] / 1024:>8.1f}")
+
+
+def print_pgo_comparison(records: List[dict]) -> None:
+    """Print PGO speedup over the matching default-flag model per program."""
+    baseline = {(r['project'], res['program']): res['cycles_per_sec']['mean']
+                for r in records if r['config'] == PGO_BASELINE for res in r['results']}
+    rows = [(r['project'], res['program'], baseline.get((r['project'], res['program'])),
+             res['cycles_per_sec']['mean'])
+            for r in records if r['config'] == 'pgo' for res in r['results']]
+    if not rows:
+        return
+    print(f"\nPGO vs {PGO_BASELINE}:")
+    for project, program, base, pgo in rows:
+        if base:
+            print(f"  {project:<15} {program:<10} {base:>12,.0f} -> {pgo:>12,.0f}  ({pgo / base - 1:+.1%})")
+        else:
+            print(f"  {project:<15} {program:<10} {'n/a':>12} -> {pgo:>12,.0f}")
+
+
+def parse_list(value: str) -> List[str]:
+    return [v.strip() for v in value.split(',') if v.strip()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark Verilator simulator throughput")
+    parser.add_argument('--projects', type=parse_list, default=list(PROJECTS),
+                        help='Comma-separated projects (default: all)')
+    parser.add_argument('--programs', type=parse_list, default=['fibonacci', 'quicksort', 'nyancat', 'loop'],
+                        help='Comma-separated programs (default: fibonacci,quicksort,nyancat,loop)')
+    parser.add_argument('--cycles', type=int, default=2000000,
+                        help='Simulated clock cycles per run (default: 2000000)')
+    parser.add_argument('--repeat', '-n', type=int, default=5,
+                        help='Runs per (model, program) pair (default: 5)')
+    parser.add_argument('--trace', type=parse_list, default=['off', 'on'],
+                        help='Trace settings to build: off,on (default: both)')
+    parser.add_argument('--opt', type=parse_list, default=['2', '3'],
+                        help='Optimization levels to build (default: 2,3)')
+    parser.add_argument('--threads', type=parse_list, default=['1'],
+                        help='Verilator --threads values to build (default: 1)')
+    parser.add_argument('--variants', type=parse_list, default=['default'],
+                        help=f"Harness variants: {','.join(HARNESS_VARIANTS)} (default: default)")
+    parser.add_argument('--pgo', action='store_true',
+                        help='Also benchmark the make sim-pgo build of each project')
+    parser.add_argument('--jobs', '-j', type=int, default=os.cpu_count() or 1,
+                        help='Parallel make jobs per model build')
+    parser.add_argument('--json', type=Path, default=BENCH_DIR / 'results' / 'bench.json',
+                        help='JSON output path (default: bench/results/bench.json)')
+    args = parser.parse_args()
+
+    for name in args.projects:
+        if name not in PROJECTS:
+            print(f"Error: unknown project {name}", file=sys.stderr)
+            sys.exit(1)
+    for variant in args.variants:
+        if variant not in HARNESS_VARIANTS:
+            print(f"Error: unknown harness variant {variant}", file=sys.stderr)
+            sys.exit(1)
+
+    configs = [BuildConfig(trace == 'on', int(opt), int(threads), variant)
+               for trace in args.trace for opt in args.opt
+               for threads in args.threads for variant in args.variants]
+
+    records = []
+    for name in args.projects:
+        project = PROJECTS[name]
+        for config in configs:
+            binary = build_model(project, config, args.jobs)
+            run_args = list(HARNESS_VARIANTS[config.variant].run_args)
+            if config.trace:
+                run_args += ['-vcd', os.devnull]
+            records.append({
+                'project': name,
+                'config': config.name,
+                'build': {'trace': config.trace, 'opt': config.opt,
+                          'threads': config.threads, 'variant': config.variant},
+                'results': bench_binary(project, binary, run_args, args.programs,
+                                        args.cycles, args.repeat),
+            })
+
+        pgo_binary = ROOT / name / 'verilog' / 'verilator' / 'obj_dir_pgo' / 'VTop'
+        if args.pgo and pgo_binary.exists():
+            records.append({
+                'project': name,
+                'config': 'pgo',
+                'build': {'trace': False, 'opt': 3, 'threads': 1, 'variant': 'pgo-lto'},
+                'results': bench_binary(project, pgo_binary, [], args.programs,
+                                        args.cycles, args.repeat),
+            })
+        elif args.pgo:
+            print(f"[{name}] No PGO build at {pgo_binary} (run make sim-pgo)", file=sys.stderr)
+
+    print_table(records)
+    print_pgo_comparison(records)
+
+    args.json.parent.mkdir(parents=True, exist_ok=True)
+    with open(args.json, 'w') as f:
+        json.dump({
+            'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S'),
+            'host': platform.node(),
+            'cycles': args.cycles,
+            'repeat': args.repeat,
+            'records': records,
+        }, f, indent=2)
+    print(f"\nResults written to {args.json}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,54 @@
+# SPDX-License-Identifier: MIT
+# MyCPU is freely redistributable under the MIT License. See the file
+# "LICENSE" for information on usage and redistribution of this file.
+#
+# Cache Sizing Sweep
+# Provides cache-sweep for the Verilator harness of the including project:
+#   1. Record the fetch and data access stream (-mem-trace) of every program
+#      in CACHE_PROGRAMS and of the compliance tests RISCOF left behind
+#   2. Replay all traces against CACHE_ICACHE and CACHE_DCACHE with
+#      tools/cachesim, which prints hit rates and projected CPI per trace
+#
+# The including Makefile sets, before including this file:
+#   CACHE_PROGRAMS     runs as program:cycles, programs relative to
+#                      src/main/resources (defaults to PGO_TRAIN)
+#   CACHE_RISCOF_WORK  RISCOF work directory under tests/ (defaults to
+#                      PGO_RISCOF_WORK)
+# Configurations are SIZE:WAYS:LINE[:lru|fifo|random[:wb|wt]]; CACHESIM_ARGS
+# passes latency options such as -miss-penalty, or -csv.
+
+CACHE_PROGRAMS ?= $(PGO_TRAIN)
+CACHE_RISCOF_WORK ?= $(PGO_RISCOF_WORK)
+CACHE_ICACHE ?= 512:1:16 1k:2:16 4k:2:32
+CACHE_DCACHE ?= 512:1:16 1k:2:16 4k:2:32 4k:2:32:lru:wt
+CACHE_TRACE_DIR := cache_traces
+CACHE_COMPLIANCE_TESTS ?= 1000
+CACHESIM_ARGS ?=
+
+.PHONY: cache-sweep cache-traces cache-clean
+
+cache-traces: verilator
+	@mkdir -p $(CACHE_TRACE_DIR)
+	@for run in $(CACHE_PROGRAMS); do \
+		program=$${run%%:*}; cycles=$${run##*:}; \
+		echo "Tracing: $$program ($$cycles cycles)"; \
+		(cd verilog/verilator/obj_dir && ./VTop -instruction ../../../src/main/resources/$$program \
+			-mem-trace ../../../$(CACHE_TRACE_DIR)/$${program%.asmbin}.rvmt -time $$((cycles * 4)) > /dev/null) || exit 1; \
+	done
+	@tests=$$(find $(abspath ../tests)/$(CACHE_RISCOF_WORK) -path '*/dut/*.asmbin' 2>/dev/null | sort | head -n $(CACHE_COMPLIANCE_TESTS)); \
+	if [ -z "$$tests" ]; then \
+		echo "Tracing: no compliance binaries in tests/$(CACHE_RISCOF_WORK) (run make compliance to include them)"; \
+	fi; \
+	for test in $$tests; do \
+		name=$$(basename $$(dirname $$(dirname $$test)) .S); \
+		(cd verilog/verilator/obj_dir && ./VTop -instruction $$test \
+			-mem-trace ../../../$(CACHE_TRACE_DIR)/$$name.rvmt -time 400000 > /dev/null) || exit 1; \
+	done
+
+cache-sweep: cache-traces
+	@$(MAKE) -s -C ../tools cachesim
+	../tools/cachesim $(addprefix -icache ,$(CACHE_ICACHE)) $(addprefix -dcache ,$(CACHE_DCACHE)) \
+		$(CACHESIM_ARGS) $(CACHE_TRACE_DIR)/*.rvmt
+
+cache-clean:
+	$(RM) -r $(CACHE_TRACE_DIR)
@@ -0,0 +1,81 @@
+# SPDX-License-Identifier: MIT
+# MyCPU is freely redistributable under the MIT License. See the file
+# "LICENSE" for information on usage and redistribution of this file.
+#
+# Profile-Guided Optimized Simulator Build
+# Provides sim-pgo for the Verilator harness of the including project:
+#   1. Build an instrumented VTop in verilog/verilator/obj_dir_pgo
+#   2. Run the training workload (PGO_TRAIN plus a compliance subset)
+#   3. Rebuild the same directory with the profile and LTO
+# sim-pgo-bench compares the result against the default build via bench/.
+#
+# The including Makefile sets, before including this file:
+#   PGO_VSOURCES     extra Verilog sources and .vlt files besides Top.v
+#   PGO_VFLAGS       extra Verilator flags
+# These should match the project's default build, so that harness features
+# needing --vpi or public signals (-ff, -vga-snapshot) work in sim-pgo too.
+#   PGO_TRAIN        training runs as program:cycles, programs relative to
+#                    src/main/resources
+#   PGO_RISCOF_WORK  RISCOF work directory under tests/ (compliance subset)
+#
+# Both stages build in the same directory so the profile files, keyed by
+# object path, are found again. GCC and Clang are supported; Clang needs
+# llvm-profdata to merge raw profiles.
+
+PGO_OBJ_DIR := verilog/verilator/obj_dir_pgo
+PGO_OPT ?= -O3
+PGO_COMPLIANCE_TESTS ?= 16
+
+PGO_CLANG := $(shell $(CXX) --version 2>/dev/null | grep -q clang && echo 1)
+ifeq ($(PGO_CLANG),1)
+PGO_GEN_FLAGS := -fprofile-instr-generate=$(abspath $(PGO_OBJ_DIR))/pgo-%p.profraw
+PGO_USE_FLAGS := -fprofile-instr-use=$(abspath $(PGO_OBJ_DIR))/pgo.profdata -Wno-profile-instr-unprofiled
+PGO_MERGE := llvm-profdata merge -o $(PGO_OBJ_DIR)/pgo.profdata $(PGO_OBJ_DIR)/pgo-*.profraw
+else
+PGO_GEN_FLAGS := -fprofile-generate
+PGO_USE_FLAGS := -fprofile-use -fprofile-correction -Wno-missing-profile
+PGO_MERGE := true
+endif
+
+# pgo-build,<cflags>,<ldflags>: regenerate and recompile the model in PGO_OBJ_DIR
+define pgo-build
+	cd verilog/verilator && verilator --exe --cc sim.cpp Top.v $(PGO_VSOURCES) $(PGO_VFLAGS) \
+		-Mdir obj_dir_pgo -O3 -CFLAGS "$(1)" -LDFLAGS "$(2)"
+	$(RM) $(PGO_OBJ_DIR)/*.o $(PGO_OBJ_DIR)/*.a $(PGO_OBJ_DIR)/VTop
+	make -C $(PGO_OBJ_DIR) -f VTop.mk OPT_FAST="$(PGO_OPT)" OPT_SLOW="$(PGO_OPT)" OPT_GLOBAL="$(PGO_OPT)"
+endef
+
+.PHONY: sim-pgo sim-pgo-train sim-pgo-bench sim-pgo-clean
+
+sim-pgo: verilator
+	@echo "Building instrumented simulator..."
+	$(RM) -r $(PGO_OBJ_DIR)
+	$(call pgo-build,$(PGO_GEN_FLAGS),$(PGO_GEN_FLAGS))
+	@$(MAKE) --no-print-directory sim-pgo-train
+	$(PGO_MERGE)
+	@echo "Rebuilding simulator with profile and LTO..."
+	$(call pgo-build,$(PGO_USE_FLAGS) -flto,$(PGO_USE_FLAGS) -flto $(PGO_OPT))
+	@echo "PGO simulator: $(PGO_OBJ_DIR)/VTop"
+
+# Training workload; compliance tests are used when RISCOF has left them behind
+sim-pgo-train:
+	@for run in $(PGO_TRAIN); do \
+		program=$${run%%:*}; cycles=$${run##*:}; \
+		echo "Training: $$program ($$cycles cycles)"; \
+		(cd $(PGO_OBJ_DIR) && ./VTop -instruction ../../../src/main/resources/$$program \
+			-time $$((cycles * 4)) > /dev/null) || exit 1; \
+	done
+	@tests=$$(find $(abspath ../tests)/$(PGO_RISCOF_WORK) -path '*/dut/*.asmbin' 2>/dev/null | sort | head -n $(PGO_COMPLIANCE_TESTS)); \
+	if [ -z "$$tests" ]; then \
+		echo "Training: no compliance binaries in tests/$(PGO_RISCOF_WORK) (run make compliance to include them)"; \
+	fi; \
+	for test in $$tests; do \
+		echo "Training: $$test"; \
+		(cd $(PGO_OBJ_DIR) && ./VTop -instruction $$test -time 400000 > /dev/null) || exit 1; \
+	done
+
+sim-pgo-bench:
+	cd ../bench && python3 run-bench.py --projects $(notdir $(CURDIR)) --trace off --opt 3 --pgo
+
+sim-pgo-clean:
+	$(RM) -r $(PGO_OBJ_DIR)
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: MIT
+// MyCPU is freely redistributable under the MIT License. See the file
+// "LICENSE" for information on usage and redistribution of this file.
+
+package riscv
+
+import chisel3._
+
+/**
+ * RetirementBundle: one record per retired instruction (RVFI-style)
+ *
+ * valid is high for exactly one cycle per instruction, in program order. The
+ * single-cycle cores retire every instruction in the cycle it executes; the
+ * pipelined cores drive the record from their last stage, so flushed
+ * wrong-path fetches and bubbles never show up. The record is combinational,
+ * so sample it before the rising edge that retires the instruction.
+ *
+ * - rd_address is 0 when no register is written (x0 writes included)
+ * - memory_address is the full address, device bits included
+ * - memory_write_strobe is 0 unless the instruction stores
+ * - trap: ecall/ebreak; interrupt: first instruction of an interrupt handler
+ *
+ * 3-pipeline does not depend on common; it compiles this file against its
+ * own riscv.Parameters (see build.sbt).
+ */
+class RetirementBundle extends Bundle {
+  val valid               = Output(Bool())
+  val pc                  = Output(UInt(Parameters.AddrWidth))
+  val instruction         = Output(UInt(Parameters.InstructionWidth))
+  val rd_address          = Output(UInt(Parameters.PhysicalRegisterAddrWidth))
+  val rd_data             = Output(UInt(Parameters.DataWidth))
+  val memory_address      = Output(UInt(Parameters.AddrWidth))
+  val memory_read         = Output(Bool())
+  val memory_read_data    = Output(UInt(Parameters.DataWidth))
+  val memory_write_strobe = Output(UInt(Parameters.WordSize.W))
+  val memory_write_data   = Output(UInt(Parameters.DataWidth))
+  val trap                = Output(Bool())
+  val interrupt           = Output(Bool())
+}
@@ -0,0 +1,90 @@
+// Backdoor access to the architectural state of a Verilated MyCPU core.
+//
+// Used to switch from fast-forwarding on rv32::Hart to cycle-accurate RTL:
+// the model's x1-x31, CSRs and PC are written straight into
+// RegisterFile.registers_*, the CSR module's registers and
+// InstructionFetch.pc. Those signals only exist at run time when the model is
+// Verilated with common/verilator/backdoor.vlt and --vpi, which mark them
+// public_flat_rw and emit the scope tables searched here.
+
+#pragma once
+
+#include <verilated.h>
+#include <verilated_syms.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "rv32_iss.h"
+
+namespace rv32
+{
+
+class Backdoor
+{
+    std::string core;  // scope of the core, e.g. "TOP.Top.cpu"
+
+    VerilatedVar *find(std::string const &module, std::string const &name) const
+    {
+        std::string scope = core + "." + module;
+        const VerilatedScope *scopep =
+            Verilated::threadContextp()->scopeFind(scope.c_str());
+        VerilatedVar *varp = scopep ? scopep->varFind(name.c_str()) : nullptr;
+        if (!varp) {
+            throw std::runtime_error(
+                "No public signal " + scope + "." + name +
+                " (Verilate the model with backdoor.vlt and --vpi)");
+        }
+        return varp;
+    }
+
+public:
+    Backdoor(std::string core) : core(std::move(core)) {}
+
+    void write(std::string const &module,
+               std::string const &name,
+               uint64_t value) const
+    {
+        VerilatedVar *varp = find(module, name);
+        switch (varp->vltype()) {
+        case VLVT_UINT8:
+            *static_cast<CData *>(varp->datap()) = value;
+            break;
+        case VLVT_UINT16:
+            *static_cast<SData *>(varp->datap()) = value;
+            break;
+        case VLVT_UINT32:
+            *static_cast<IData *>(varp->datap()) = value;
+            break;
+        case VLVT_UINT64:
+            *static_cast<QData *>(varp->datap()) = value;
+            break;
+        default:
+            throw std::runtime_error("Unsupported signal type for " + core +
+                                     "." + module + "." + name);
+        }
+    }
+
+    // Copy registers, CSRs and PC from the model into the core. Call while
+    // the core is idle out of reset (no instruction in flight) and eval()
+    // afterwards so combinational outputs follow the new state.
+    template <typename Bus>
+    void load(Hart<Bus> const &hart) const
+    {
+        // x0 has no storage: registers_0 holds x1
+        for (uint32_t reg = 1; reg < 32; ++reg) {
+            write("regs", "registers_" + std::to_string(reg - 1), hart.x[reg]);
+        }
+        write("csr_regs", "mstatus", hart.mstatus);
+        write("csr_regs", "mie", hart.mie);
+        write("csr_regs", "mtvec", hart.mtvec);
+        write("csr_regs", "mscratch", hart.mscratch);
+        write("csr_regs", "mepc", hart.mepc);
+        write("csr_regs", "mcause", hart.mcause);
+        write("csr_regs", "cycles", hart.cycles);
+        write("inst_fetch", "pc", hart.pc);
+    }
+};
+
+}  // namespace rv32
@@ -0,0 +1,101 @@
+// Basic-block vectors for SimPoint-style interval selection.
+//
+// Fed the instructions rv32::Hart retires, it splits execution into
+// fixed-size intervals and writes one line per interval in SimPoint's .bb
+// format:
+//     T:<block>:<count> :<block>:<count> ...
+// where count is the number of instructions the interval executed in that
+// block. Blocks are numbered from 1 in order of first execution and keyed by
+// their first PC; a block ends after a branch, jump, ecall/ebreak/mret or
+// trap. Interval i starts at instruction i * interval, which is what -ff
+// takes to reach it. scripts/simpoint.py clusters the vectors.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "rv32_iss.h"
+
+namespace rv32
+{
+
+class BbvProfiler
+{
+    std::ofstream out;
+    uint64_t interval;
+    std::unordered_map<uint32_t, uint32_t> block_ids;
+    std::map<uint32_t, uint64_t> counts;  // block id -> instructions
+    uint32_t block = 0;                   // id of the current block, 0: none
+    uint64_t executed = 0;                // instructions in this interval
+    uint64_t intervals = 0;
+
+    static bool ends_block(uint32_t insn)
+    {
+        switch (insn & 0x7F) {
+        case 0x63:  // branches
+        case 0x6F:  // JAL
+        case 0x67:  // JALR
+            return true;
+        case 0x73:  // ecall, ebreak, mret
+            return ((insn >> 12) & 0x7) == 0;
+        default:
+            return false;
+        }
+    }
+
+    void write_interval()
+    {
+        out << 'T';
+        for (auto const &[id, count] : counts) {
+            out << ':' << id << ':' << count << ' ';
+        }
+        out << '\n';
+        counts.clear();
+        executed = 0;
+        ++intervals;
+    }
+
+public:
+    BbvProfiler(std::string const &filename, uint64_t interval)
+        : out(filename), interval(interval)
+    {
+        if (!out) {
+            throw std::runtime_error("Could not open BBV file " + filename);
+        }
+    }
+
+    uint64_t blocks() const { return block_ids.size(); }
+    uint64_t written() const { return intervals; }
+
+    void retire(Retired const &r)
+    {
+        if (!block) {
+            auto [it, inserted] =
+                block_ids.emplace(r.pc, uint32_t(block_ids.size() + 1));
+            block = it->second;
+        }
+        ++counts[block];
+        if (r.trap || ends_block(r.instruction)) {
+            block = 0;
+        }
+        if (++executed == interval) {
+            write_interval();
+        }
+    }
+
+    // Write the last, partial interval
+    void finish()
+    {
+        if (executed) {
+            write_interval();
+        }
+        out.flush();
+    }
+};
+
+}  // namespace rv32
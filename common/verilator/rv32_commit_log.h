@@ -0,0 +1,209 @@
+// Compact binary commit log of the instructions a core retires.
+//
+// Fed from the io_retire_* port (one record per retired instruction), it
+// writes a little-endian stream that scripts/commitlog.py turns back into
+// text or a Spike-style --log-commits trace. After an 8-byte header
+// ("RVCL", version, 3 reserved bytes) every record is
+//
+//     flags         u8, COMMIT_* below
+//     cycle delta   varint, rising edges since the previous record
+//     pc delta      zigzag varint of pc - (previous pc + 4), if COMMIT_JUMP
+//     instruction   u32, if COMMIT_NEW_INSN
+//     rd, rd data   u8 + varint, if COMMIT_RD
+//     address delta zigzag varint against the previous data access, if
+//                   COMMIT_LOAD or COMMIT_STORE
+//     load data     varint, if COMMIT_LOAD
+//     strobe, data  u8 + varint, if COMMIT_STORE
+//
+// Straight-line code therefore costs two bytes per instruction plus its
+// results. An instruction word is written the first time its PC retires and
+// again only if it changed (self-modifying code); the reader keeps the same
+// per-PC cache. Varints are LEB128: 7 bits per byte, low bits first.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rv32
+{
+
+enum CommitFlags : uint8_t {
+    COMMIT_RD = 1 << 0,         // wrote a register other than x0
+    COMMIT_LOAD = 1 << 1,       // read data memory or a device
+    COMMIT_STORE = 1 << 2,      // wrote data memory or a device
+    COMMIT_TRAP = 1 << 3,       // ecall or ebreak
+    COMMIT_INTERRUPT = 1 << 4,  // first instruction of an interrupt handler
+    COMMIT_JUMP = 1 << 5,       // pc is not the previous pc + 4
+    COMMIT_NEW_INSN = 1 << 6,   // instruction word follows
+};
+
+constexpr char COMMIT_LOG_MAGIC[4] = {'R', 'V', 'C', 'L'};
+constexpr uint8_t COMMIT_LOG_VERSION = 1;
+
+struct Commit
+{
+    uint32_t pc = 0;
+    uint32_t instruction = 0;
+    uint32_t rd = 0;  // 0: no register written
+    uint32_t rd_data = 0;
+    uint32_t memory_address = 0;
+    bool memory_read = false;
+    uint32_t memory_read_data = 0;
+    uint32_t memory_write_strobe = 0;  // byte lanes, 0: no store
+    uint32_t memory_write_data = 0;
+    bool trap = false;
+    bool interrupt = false;
+};
+
+class CommitLogWriter
+{
+    std::ofstream out;
+    std::vector<uint8_t> buffer;
+    std::unordered_map<uint32_t, uint32_t> instructions;  // pc -> last word
+    uint64_t last_cycle = 0;
+    uint32_t next_pc = 0;
+    uint32_t last_address = 0;
+    uint64_t records = 0;
+
+    void put_varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            buffer.push_back(uint8_t(value) | 0x80);
+            value >>= 7;
+        }
+        buffer.push_back(uint8_t(value));
+    }
+
+    void put_zigzag(int32_t value)
+    {
+        put_varint((uint32_t(value) << 1) ^ uint32_t(value >> 31));
+    }
+
+    void put_u32(uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i) {
+            buffer.push_back(uint8_t(value >> (8 * i)));
+        }
+    }
+
+    void flush_buffer()
+    {
+        out.write(reinterpret_cast<char const *>(buffer.data()),
+                  buffer.size());
+        buffer.clear();
+    }
+
+public:
+    CommitLogWriter(std::string const &filename)
+        : out(filename, std::ios::binary)
+    {
+        if (!out) {
+            throw std::runtime_error("Could not open commit log " + filename);
+        }
+        out.write(COMMIT_LOG_MAGIC, sizeof(COMMIT_LOG_MAGIC));
+        char const header[4] = {char(COMMIT_LOG_VERSION), 0, 0, 0};
+        out.write(header, sizeof(header));
+        buffer.reserve(1 << 16);
+    }
+
+    ~CommitLogWriter() { finish(); }
+
+    uint64_t written() const { return records; }
+
+    void commit(uint64_t cycle, Commit const &c)
+    {
+        uint8_t flags = 0;
+        if (c.rd) {
+            flags |= COMMIT_RD;
+        }
+        if (c.memory_read) {
+            flags |= COMMIT_LOAD;
+        }
+        if (c.memory_write_strobe) {
+            flags |= COMMIT_STORE;
+        }
+        if (c.trap) {
+            flags |= COMMIT_TRAP;
+        }
+        if (c.interrupt) {
+            flags |= COMMIT_INTERRUPT;
+        }
+        if (c.pc != next_pc) {
+            flags |= COMMIT_JUMP;
+        }
+        auto [it, inserted] = instructions.emplace(c.pc, c.instruction);
+        if (inserted || it->second != c.instruction) {
+            it->second = c.instruction;
+            flags |= COMMIT_NEW_INSN;
+        }
+
+        buffer.push_back(flags);
+        put_varint(cycle - last_cycle);
+        if (flags & COMMIT_JUMP) {
+            put_zigzag(int32_t(c.pc - next_pc));
+        }
+        if (flags & COMMIT_NEW_INSN) {
+            put_u32(c.instruction);
+        }
+        if (flags & COMMIT_RD) {
+            buffer.push_back(uint8_t(c.rd));
+            put_varint(c.rd_data);
+        }
+        if (flags & (COMMIT_LOAD | COMMIT_STORE)) {
+            put_zigzag(int32_t(c.memory_address - last_address));
+            last_address = c.memory_address;
+        }
+        if (flags & COMMIT_LOAD) {
+            put_varint(c.memory_read_data);
+        }
+        if (flags & COMMIT_STORE) {
+            buffer.push_back(uint8_t(c.memory_write_strobe));
+            put_varint(c.memory_write_data);
+        }
+
+        last_cycle = cycle;
+        next_pc = c.pc + 4;
+        ++records;
+        if (buffer.size() >= (1 << 16) - 32) {
+            flush_buffer();
+        }
+    }
+
+    // Sample a Verilated top's io_retire_* port; call just before the rising
+    // edge that retires the instruction
+    template <typename Top>
+    void sample(uint64_t cycle, Top const &top)
+    {
+        if (!top.io_retire_valid) {
+            return;
+        }
+        Commit c;
+        c.pc = top.io_retire_pc;
+        c.instruction = top.io_retire_instruction;
+        c.rd = top.io_retire_rd_address;
+        c.rd_data = top.io_retire_rd_data;
+        c.memory_address = top.io_retire_memory_address;
+        c.memory_read = top.io_retire_memory_read;
+        c.memory_read_data = top.io_retire_memory_read_data;
+        c.memory_write_strobe = top.io_retire_memory_write_strobe;
+        c.memory_write_data = top.io_retire_memory_write_data;
+        c.trap = top.io_retire_trap;
+        c.interrupt = top.io_retire_interrupt;
+        commit(cycle, c);
+    }
+
+    void finish()
+    {
+        if (!buffer.empty()) {
+            flush_buffer();
+        }
+        out.flush();
+    }
+};
+
+}  // namespace rv32
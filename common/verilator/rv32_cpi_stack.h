@@ -0,0 +1,287 @@
+// Top-down CPI stack and per-PC hazard cost for the pipelined cores.
+//
+// Fed every clock cycle from the io_hazard_* debug port (Control's stall and
+// flush decisions, the CLINT redirect) and io_retire_valid, it charges each
+// lost cycle to one cause:
+//
+//     load_use         stall cycle, ID waits for a load in EX
+//     jump_stall       stall cycle, an ID-stage jump waits for its operand
+//                      (jump or branch after a load or an ALU result)
+//     data_hazard      stall cycle, any RAW hazard (FiveStageStall)
+//     branch           slots flushed by a taken branch or jump
+//     trap             slots flushed entering the ecall/ebreak handler
+//     interrupt_entry  slots flushed entering an interrupt handler
+//     interrupt_exit   slots flushed by mret
+//
+// A stall costs one cycle; a redirect costs one cycle per pipeline register
+// it flushes (IF2ID, and ID2EX unless the redirect is resolved in ID). What is
+// left of the cycle count is "base": one cycle per instruction plus pipeline
+// fill. Every entry divided by the retired instruction count gives the CPI
+// stack, and the entries add up to the measured CPI.
+//
+// Stall cycles are charged to the PC of the stalled instruction in ID, flush
+// slots to the PC of the instruction that redirected, so the per-PC table
+// points at the consumer of a load or at the branch itself.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rv32
+{
+
+enum CpiCause {
+    CPI_BASE,
+    CPI_LOAD_USE,
+    CPI_JUMP_STALL,
+    CPI_DATA_HAZARD,
+    CPI_BRANCH,
+    CPI_TRAP,
+    CPI_INTERRUPT_ENTRY,
+    CPI_INTERRUPT_EXIT,
+    CPI_CAUSES,
+};
+
+constexpr char const *cpi_cause_names[CPI_CAUSES] = {
+    "base",   "load_use", "jump_stall",      "data_hazard",
+    "branch", "trap",     "interrupt_entry", "interrupt_exit",
+};
+
+// riscv.core.StallReason
+enum StallReason : uint32_t {
+    STALL_NONE = 0,
+    STALL_LOAD_USE = 1,
+    STALL_JUMP_DEPENDENCY = 2,
+    STALL_DATA_HAZARD = 3,
+};
+
+// One cycle of the io_hazard_* port
+struct HazardSample
+{
+    bool retired = false;
+    bool pc_stall = false;
+    bool if_flush = false;
+    bool id_flush = false;
+    uint32_t stall_reason = STALL_NONE;
+    uint32_t stall_pc = 0;
+    uint32_t flush_pc = 0;
+    bool interrupt_entry = false;
+    bool interrupt_exit = false;
+    bool trap = false;
+};
+
+class CpiStack
+{
+public:
+    struct PcCost
+    {
+        uint64_t cycles[CPI_CAUSES] = {};  // CPI_BASE unused
+
+        uint64_t stall() const
+        {
+            return cycles[CPI_LOAD_USE] + cycles[CPI_JUMP_STALL] +
+                   cycles[CPI_DATA_HAZARD];
+        }
+        uint64_t flush() const
+        {
+            return cycles[CPI_BRANCH] + cycles[CPI_TRAP] +
+                   cycles[CPI_INTERRUPT_ENTRY] + cycles[CPI_INTERRUPT_EXIT];
+        }
+        uint64_t total() const { return stall() + flush(); }
+    };
+
+private:
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t lost[CPI_CAUSES] = {};
+    std::unordered_map<uint32_t, PcCost> pcs;
+
+    void charge(CpiCause cause, uint32_t pc, uint64_t slots)
+    {
+        lost[cause] += slots;
+        pcs[pc].cycles[cause] += slots;
+    }
+
+    static CpiCause stall_cause(uint32_t reason)
+    {
+        switch (reason) {
+        case STALL_JUMP_DEPENDENCY:
+            return CPI_JUMP_STALL;
+        case STALL_DATA_HAZARD:
+            return CPI_DATA_HAZARD;
+        default:
+            return CPI_LOAD_USE;
+        }
+    }
+
+    static void print_json_string(std::ostream &out, std::string const &s)
+    {
+        out << '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << '"';
+    }
+
+public:
+    // Account one clock cycle
+    void record(HazardSample const &s)
+    {
+        ++cycles;
+        if (s.retired) {
+            ++instructions;
+        }
+        if (s.pc_stall) {
+            // The ID2EX flush of a stall is the bubble, not a second penalty
+            charge(stall_cause(s.stall_reason), s.stall_pc, 1);
+            return;
+        }
+        uint64_t slots = uint64_t(s.if_flush) + uint64_t(s.id_flush);
+        if (!slots) {
+            return;
+        }
+        CpiCause cause = CPI_BRANCH;
+        if (s.trap) {
+            cause = CPI_TRAP;
+        } else if (s.interrupt_entry) {
+            cause = CPI_INTERRUPT_ENTRY;
+        } else if (s.interrupt_exit) {
+            cause = CPI_INTERRUPT_EXIT;
+        }
+        charge(cause, s.flush_pc, slots);
+    }
+
+    // Sample a Verilated top's io_hazard_* and io_retire_valid; call once per
+    // cycle just before the rising edge
+    template <typename Top>
+    void sample(Top const &top)
+    {
+        HazardSample s;
+        s.retired = top.io_retire_valid;
+        s.pc_stall = top.io_hazard_pc_stall;
+        s.if_flush = top.io_hazard_if_flush;
+        s.id_flush = top.io_hazard_id_flush;
+        s.stall_reason = top.io_hazard_stall_reason;
+        s.stall_pc = top.io_hazard_stall_pc;
+        s.flush_pc = top.io_hazard_flush_pc;
+        s.interrupt_entry = top.io_hazard_interrupt_entry;
+        s.interrupt_exit = top.io_hazard_interrupt_exit;
+        s.trap = top.io_hazard_trap;
+        record(s);
+    }
+
+    uint64_t total_cycles() const { return cycles; }
+    uint64_t retired() const { return instructions; }
+
+    // Cycles charged to a cause; base is whatever no hazard took
+    uint64_t cause_cycles(CpiCause cause) const
+    {
+        if (cause != CPI_BASE) {
+            return lost[cause];
+        }
+        uint64_t hazards = 0;
+        for (int i = CPI_BASE + 1; i < CPI_CAUSES; ++i) {
+            hazards += lost[i];
+        }
+        return cycles > hazards ? cycles - hazards : 0;
+    }
+
+    // PCs by lost cycles, most expensive first
+    std::vector<std::pair<uint32_t, PcCost>> ranked(size_t limit) const
+    {
+        std::vector<std::pair<uint32_t, PcCost>> rows(pcs.begin(), pcs.end());
+        std::sort(rows.begin(), rows.end(), [](auto const &a, auto const &b) {
+            return a.second.total() != b.second.total()
+                       ? a.second.total() > b.second.total()
+                       : a.first < b.first;
+        });
+        if (rows.size() > limit) {
+            rows.resize(limit);
+        }
+        return rows;
+    }
+
+    void print(std::FILE *out, char const *name, size_t top_pcs = 10) const
+    {
+        std::fprintf(out, "\nCPI stack (%s): %lu cycles, %lu instructions",
+                     name, (unsigned long) cycles,
+                     (unsigned long) instructions);
+        if (instructions) {
+            std::fprintf(out, ", CPI %.3f", double(cycles) / instructions);
+        }
+        std::fprintf(out, "\n");
+        for (int i = CPI_BASE; i < CPI_CAUSES; ++i) {
+            uint64_t n = cause_cycles(CpiCause(i));
+            if (!n && i != CPI_BASE) {
+                continue;
+            }
+            std::fprintf(out, "  %-16s %12lu  %6.3f  %5.1f%%\n",
+                         cpi_cause_names[i], (unsigned long) n,
+                         instructions ? double(n) / instructions : 0.0,
+                         cycles ? 100.0 * n / cycles : 0.0);
+        }
+
+        auto rows = ranked(top_pcs);
+        if (rows.empty()) {
+            return;
+        }
+        std::fprintf(out, "  %-10s %10s %10s  %s\n", "pc", "stall", "flush",
+                     "causes");
+        for (auto const &[pc, cost] : rows) {
+            std::fprintf(out, "  0x%08x %10lu %10lu ", pc,
+                         (unsigned long) cost.stall(),
+                         (unsigned long) cost.flush());
+            for (int i = CPI_BASE + 1; i < CPI_CAUSES; ++i) {
+                if (cost.cycles[i]) {
+                    std::fprintf(out, " %s=%lu", cpi_cause_names[i],
+                                 (unsigned long) cost.cycles[i]);
+                }
+            }
+            std::fprintf(out, "\n");
+        }
+    }
+
+    // One JSON object: totals, the stack in cycles and every PC that lost
+    // cycles, most expensive first
+    void write_json(std::ostream &out, std::string const &name) const
+    {
+        char pc_text[16];
+        out << "{\"implementation\": ";
+        print_json_string(out, name);
+        out << ", \"cycles\": " << cycles
+            << ", \"instructions\": " << instructions << ", \"stack\": {";
+        for (int i = CPI_BASE; i < CPI_CAUSES; ++i) {
+            out << (i ? ", " : "") << '"' << cpi_cause_names[i]
+                << "\": " << cause_cycles(CpiCause(i));
+        }
+        out << "}, \"pcs\": [";
+        bool first = true;
+        for (auto const &[pc, cost] : ranked(pcs.size())) {
+            std::snprintf(pc_text, sizeof(pc_text), "0x%08x", pc);
+            out << (first ? "\n  " : ",\n  ") << "{\"pc\": \"" << pc_text
+                << "\", \"stall\": " << cost.stall()
+                << ", \"flush\": " << cost.flush();
+            for (int i = CPI_BASE + 1; i < CPI_CAUSES; ++i) {
+                if (cost.cycles[i]) {
+                    out << ", \"" << cpi_cause_names[i]
+                        << "\": " << cost.cycles[i];
+                }
+            }
+            out << '}';
+            first = false;
+        }
+        out << "]}";
+    }
+};
+
+}  // namespace rv32
@@ -0,0 +1,527 @@
+// Symbols and source lines of a guest ELF image, for reports keyed by PC.
+//
+// Reads a 32-bit little-endian ELF file (the .elf the csrc Makefiles link
+// before objcopy turns it into an .asmbin):
+//   - .symtab: STT_FUNC symbols with their sizes; in assembly-only code,
+//     labels in executable sections stand in for functions
+//   - .debug_line: the DWARF line-number program (versions 2 to 5, 32-bit
+//     DWARF), flattened into an address-sorted table of (file, line) rows
+// Programs built without -g have no line table; lookups then return "".
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rv32
+{
+
+class ElfSymbols
+{
+public:
+    struct Symbol
+    {
+        uint32_t address;
+        uint32_t size;  // 0: extends to the next symbol
+        std::string name;
+    };
+
+private:
+    struct Section
+    {
+        std::string name;
+        uint32_t name_offset, type, flags, offset, size, link;
+    };
+
+    struct LineRow
+    {
+        uint32_t address;
+        uint32_t file;  // index into files; UINT32_MAX: end of sequence
+        uint32_t line;
+    };
+
+    std::vector<uint8_t> image;
+    std::vector<Section> sections;
+    std::vector<Symbol> functions;  // STT_FUNC, by address
+    std::vector<Symbol> labels;     // other code symbols, by address
+    std::vector<std::string> files;
+    std::vector<LineRow> rows;
+
+    // Little-endian reader over one section, bounds-checked
+    class Cursor
+    {
+        uint8_t const *data;
+        size_t size;
+        size_t pos = 0;
+
+    public:
+        Cursor(uint8_t const *data, size_t size) : data(data), size(size) {}
+
+        size_t offset() const { return pos; }
+        bool done() const { return pos >= size; }
+        void seek(size_t offset) { pos = offset; }
+
+        uint64_t u(int bytes)
+        {
+            if (pos + bytes > size) {
+                throw std::runtime_error("truncated DWARF data");
+            }
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                value |= uint64_t(data[pos + i]) << (8 * i);
+            }
+            pos += bytes;
+            return value;
+        }
+
+        uint64_t uleb()
+        {
+            uint64_t value = 0;
+            for (int shift = 0;; shift += 7) {
+                uint8_t byte = u(1);
+                if (shift < 64) {
+                    value |= uint64_t(byte & 0x7F) << shift;
+                }
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+        }
+
+        int64_t sleb()
+        {
+            int64_t value = 0;
+            int shift = 0;
+            uint8_t byte;
+            do {
+                byte = u(1);
+                if (shift < 64) {
+                    value |= int64_t(byte & 0x7F) << shift;
+                }
+                shift += 7;
+            } while (byte & 0x80);
+            if (shift < 64 && (byte & 0x40)) {
+                value |= -(int64_t(1) << shift);
+            }
+            return value;
+        }
+
+        std::string str()
+        {
+            size_t end = pos;
+            while (end < size && data[end]) {
+                ++end;
+            }
+            if (end >= size) {
+                throw std::runtime_error("unterminated string in DWARF data");
+            }
+            std::string s(reinterpret_cast<char const *>(data + pos),
+                          end - pos);
+            pos = end + 1;
+            return s;
+        }
+
+        void skip(size_t bytes)
+        {
+            if (pos + bytes > size) {
+                throw std::runtime_error("truncated DWARF data");
+            }
+            pos += bytes;
+        }
+    };
+
+    uint32_t read32(size_t offset) const
+    {
+        if (offset + 4 > image.size()) {
+            throw std::runtime_error("truncated ELF file");
+        }
+        return image[offset] | image[offset + 1] << 8 |
+               image[offset + 2] << 16 | uint32_t(image[offset + 3]) << 24;
+    }
+
+    uint16_t read16(size_t offset) const
+    {
+        if (offset + 2 > image.size()) {
+            throw std::runtime_error("truncated ELF file");
+        }
+        return image[offset] | image[offset + 1] << 8;
+    }
+
+    Section const *find_section(char const *name) const
+    {
+        for (auto const &section : sections) {
+            if (section.name == name) {
+                return &section;
+            }
+        }
+        return nullptr;
+    }
+
+    Cursor cursor(Section const &section) const
+    {
+        if (uint64_t(section.offset) + section.size > image.size()) {
+            throw std::runtime_error("section " + section.name +
+                                     " lies outside the ELF file");
+        }
+        return Cursor(image.data() + section.offset, section.size);
+    }
+
+    std::string string_at(char const *section_name, uint64_t offset) const
+    {
+        Section const *section = find_section(section_name);
+        if (!section || offset >= section->size) {
+            return "";
+        }
+        Cursor c = cursor(*section);
+        c.seek(offset);
+        return c.str();
+    }
+
+    void read_sections()
+    {
+        if (image.size() < 52 || std::memcmp(image.data(), "\x7f" "ELF", 4)) {
+            throw std::runtime_error("not an ELF file");
+        }
+        if (image[4] != 1 || image[5] != 1) {
+            throw std::runtime_error("not a 32-bit little-endian ELF file");
+        }
+        uint32_t shoff = read32(0x20);
+        uint16_t shentsize = read16(0x2E);
+        uint16_t shnum = read16(0x30);
+        uint16_t shstrndx = read16(0x32);
+        for (uint16_t i = 0; i < shnum; ++i) {
+            size_t header = shoff + size_t(i) * shentsize;
+            sections.push_back({"", read32(header), read32(header + 4),
+                                read32(header + 8), read32(header + 16),
+                                read32(header + 20), read32(header + 24)});
+        }
+        if (shstrndx >= sections.size()) {
+            return;
+        }
+        Section const names = sections[shstrndx];
+        for (auto &section : sections) {
+            if (section.name_offset < names.size) {
+                Cursor c = cursor(names);
+                c.seek(section.name_offset);
+                section.name = c.str();
+            }
+        }
+    }
+
+    void read_symbols()
+    {
+        constexpr uint32_t SHT_SYMTAB = 2;
+        constexpr uint32_t SHF_EXECINSTR = 4;
+        constexpr int STT_NOTYPE = 0, STT_FUNC = 2;
+        for (auto const &symtab : sections) {
+            if (symtab.type != SHT_SYMTAB || symtab.link >= sections.size()) {
+                continue;
+            }
+            Section const &strtab = sections[symtab.link];
+            for (uint32_t entry = symtab.offset;
+                 entry + 16 <= symtab.offset + symtab.size; entry += 16) {
+                uint32_t name = read32(entry);
+                uint32_t value = read32(entry + 4);
+                uint32_t size = read32(entry + 8);
+                int type = image[entry + 12] & 0xF;
+                uint16_t shndx = read16(entry + 14);
+                if (!name || name >= strtab.size || shndx == 0 ||
+                    shndx >= sections.size() ||
+                    !(sections[shndx].flags & SHF_EXECINSTR)) {
+                    continue;
+                }
+                Cursor c = cursor(strtab);
+                c.seek(name);
+                std::string text = c.str();
+                if (text.empty() || text[0] == '$' || text[0] == '.') {
+                    continue;  // mapping symbols and local labels
+                }
+                if (type == STT_FUNC) {
+                    functions.push_back({value, size, text});
+                } else if (type == STT_NOTYPE) {
+                    labels.push_back({value, 0, text});
+                }
+            }
+        }
+        auto by_address = [](Symbol const &a, Symbol const &b) {
+            return a.address < b.address;
+        };
+        std::sort(functions.begin(), functions.end(), by_address);
+        std::sort(labels.begin(), labels.end(), by_address);
+    }
+
+    void read_line_table()
+    {
+        Section const *section = find_section(".debug_line");
+        if (!section) {
+            return;
+        }
+        Cursor c = cursor(*section);
+        while (!c.done()) {
+            uint64_t unit_length = c.u(4);
+            if (unit_length >= 0xFFFFFFF0) {
+                throw std::runtime_error("64-bit DWARF is not supported");
+            }
+            size_t unit_end = c.offset() + unit_length;
+            read_line_unit(c, unit_end);
+            c.seek(unit_end);
+        }
+        std::stable_sort(rows.begin(), rows.end(),
+                         [](LineRow const &a, LineRow const &b) {
+                             return a.address < b.address;
+                         });
+    }
+
+    // One v5 directory or file entry, described by (content type, form) pairs
+    std::string read_entry(Cursor &c,
+                           std::vector<std::pair<uint64_t, uint64_t>> const
+                               &format)
+    {
+        constexpr uint64_t DW_LNCT_path = 1;
+        std::string path;
+        for (auto const &[content, form] : format) {
+            std::string text;
+            switch (form) {
+            case 0x08:  // DW_FORM_string
+                text = c.str();
+                break;
+            case 0x1F:  // DW_FORM_line_strp
+                text = string_at(".debug_line_str", c.u(4));
+                break;
+            case 0x0E:  // DW_FORM_strp
+                text = string_at(".debug_str", c.u(4));
+                break;
+            case 0x0B:  // DW_FORM_data1
+                c.u(1);
+                break;
+            case 0x05:  // DW_FORM_data2
+                c.u(2);
+                break;
+            case 0x06:  // DW_FORM_data4
+                c.u(4);
+                break;
+            case 0x07:  // DW_FORM_data8
+                c.u(8);
+                break;
+            case 0x1E:  // DW_FORM_data16
+                c.skip(16);
+                break;
+            case 0x0F:  // DW_FORM_udata
+                c.uleb();
+                break;
+            case 0x09:  // DW_FORM_block
+                c.skip(c.uleb());
+                break;
+            default:
+                throw std::runtime_error("unsupported DWARF form in line "
+                                         "table header");
+            }
+            if (content == DW_LNCT_path) {
+                path = text;
+            }
+        }
+        return path;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> read_entry_format(Cursor &c)
+    {
+        std::vector<std::pair<uint64_t, uint64_t>> format(c.u(1));
+        for (auto &[content, form] : format) {
+            content = c.uleb();
+            form = c.uleb();
+        }
+        return format;
+    }
+
+    void read_line_unit(Cursor &c, size_t unit_end)
+    {
+        uint16_t version = c.u(2);
+        if (version < 2 || version > 5) {
+            throw std::runtime_error("unsupported DWARF line table version " +
+                                     std::to_string(version));
+        }
+        if (version >= 5) {
+            c.u(1);  // address_size
+            c.u(1);  // segment_selector_size
+        }
+        uint64_t header_length = c.u(4);
+        size_t program = c.offset() + header_length;
+        uint8_t min_length = c.u(1);
+        if (version >= 4) {
+            c.u(1);  // maximum_operations_per_instruction
+        }
+        c.u(1);  // default_is_stmt
+        int8_t line_base = int8_t(c.u(1));
+        uint8_t line_range = c.u(1);
+        uint8_t opcode_base = c.u(1);
+        std::vector<uint8_t> opcode_lengths(opcode_base ? opcode_base - 1 : 0);
+        for (auto &length : opcode_lengths) {
+            length = c.u(1);
+        }
+        if (!line_range) {
+            throw std::runtime_error("invalid DWARF line_range");
+        }
+
+        // File numbers index this unit's table: from 1 before DWARF 5
+        std::vector<uint32_t> unit_files;
+        if (version >= 5) {
+            auto directory_format = read_entry_format(c);
+            for (uint64_t n = c.uleb(); n; --n) {
+                read_entry(c, directory_format);
+            }
+            auto file_format = read_entry_format(c);
+            for (uint64_t n = c.uleb(); n; --n) {
+                unit_files.push_back(files.size());
+                files.push_back(read_entry(c, file_format));
+            }
+        } else {
+            while (!c.str().empty()) {
+                // include_directories
+            }
+            unit_files.push_back(UINT32_MAX);
+            for (std::string name = c.str(); !name.empty(); name = c.str()) {
+                c.uleb();  // directory
+                c.uleb();  // modification time
+                c.uleb();  // length
+                unit_files.push_back(files.size());
+                files.push_back(name);
+            }
+        }
+        c.seek(program);
+
+        uint32_t address = 0, file = 1, line = 1;
+        auto emit = [&](bool end) {
+            uint32_t index = file < unit_files.size() ? unit_files[file]
+                                                      : UINT32_MAX;
+            rows.push_back({address, end ? UINT32_MAX : index, line});
+        };
+        while (c.offset() < unit_end) {
+            uint8_t opcode = c.u(1);
+            if (opcode >= opcode_base) {
+                uint8_t adjusted = opcode - opcode_base;
+                address += (adjusted / line_range) * min_length;
+                line += line_base + adjusted % line_range;
+                emit(false);
+                continue;
+            }
+            switch (opcode) {
+            case 0: {  // extended
+                uint64_t length = c.uleb();
+                size_t next = c.offset() + length;
+                uint8_t sub = length ? c.u(1) : 0;
+                if (sub == 1) {  // DW_LNE_end_sequence
+                    emit(true);
+                    address = 0;
+                    file = 1;
+                    line = 1;
+                } else if (sub == 2) {  // DW_LNE_set_address
+                    address = c.u(int(length - 1) > 4 ? 4 : int(length - 1));
+                } else if (sub == 3 && version < 5) {  // DW_LNE_define_file
+                    unit_files.push_back(files.size());
+                    files.push_back(c.str());
+                }
+                c.seek(next);
+                break;
+            }
+            case 1:  // DW_LNS_copy
+                emit(false);
+                break;
+            case 2:  // DW_LNS_advance_pc
+                address += c.uleb() * min_length;
+                break;
+            case 3:  // DW_LNS_advance_line
+                line += c.sleb();
+                break;
+            case 4:  // DW_LNS_set_file
+                file = c.uleb();
+                break;
+            case 8:  // DW_LNS_const_add_pc
+                address += ((255 - opcode_base) / line_range) * min_length;
+                break;
+            case 9:  // DW_LNS_fixed_advance_pc
+                address += c.u(2);
+                break;
+            default:  // column, basic block, prologue/epilogue, ISA, ...
+                for (int i = 0; i < opcode_lengths[opcode - 1]; ++i) {
+                    c.uleb();
+                }
+                break;
+            }
+        }
+    }
+
+public:
+    explicit ElfSymbols(std::string const &filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open ELF file " + filename);
+        }
+        image.assign(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+        read_sections();
+        read_symbols();
+        read_line_table();
+    }
+
+    bool has_lines() const { return !rows.empty(); }
+
+    // The function containing pc, or the nearest code label before it
+    Symbol const *function(uint32_t pc) const
+    {
+        auto after = [](uint32_t pc, Symbol const &s) {
+            return pc < s.address;
+        };
+        auto it = std::upper_bound(functions.begin(), functions.end(), pc,
+                                   after);
+        while (it != functions.begin()) {
+            --it;
+            if (pc < it->address + std::max<uint32_t>(it->size, 1)) {
+                return &*it;
+            }
+            if (it->size) {
+                break;
+            }
+        }
+        it = std::upper_bound(labels.begin(), labels.end(), pc, after);
+        return it == labels.begin() ? nullptr : &*(it - 1);
+    }
+
+    std::string function_name(uint32_t pc) const
+    {
+        if (Symbol const *symbol = function(pc)) {
+            return symbol->name;
+        }
+        char text[16];
+        std::snprintf(text, sizeof(text), "0x%08x", pc);
+        return text;
+    }
+
+    // "file.c:42", or "" when pc has no line information
+    std::string location(uint32_t pc) const
+    {
+        auto it = std::upper_bound(
+            rows.begin(), rows.end(), pc,
+            [](uint32_t pc, LineRow const &row) { return pc < row.address; });
+        if (it == rows.begin()) {
+            return "";
+        }
+        --it;
+        if (it->file == UINT32_MAX || it->file >= files.size()) {
+            return "";
+        }
+        std::string const &path = files[it->file];
+        size_t slash = path.find_last_of('/');
+        return (slash == std::string::npos ? path : path.substr(slash + 1)) +
+               ":" + std::to_string(it->line);
+    }
+};
+
+}  // namespace rv32
@@ -0,0 +1,572 @@
+// RV32I + Zicsr instruction-set simulator shared by the Verilator harnesses.
+//
+// Models the architectural state the MyCPU cores implement: x0-x31, PC and
+// the CSRs mstatus, mie, mtvec, mscratch, mepc, mcause and cycle/cycleh.
+// Reads of the other performance counters are flagged sync.
+// Traps follow the cores' CLINT: ecall/ebreak save PC + 4 in mepc, clear
+// mstatus.MIE into MPIE and jump to mtvec; mret restores MIE from MPIE.
+// The model has no interrupt lines: a harness that sees the core take an
+// interrupt makes the model take it too with interrupt().
+//
+// The memory map comes from the harness through a Bus template parameter:
+//     uint32_t fetch(uint32_t address);
+//     uint32_t load(uint32_t address, bool &device);  // word-aligned
+//     void store(uint32_t address, uint32_t data, uint32_t mask);
+// load sets device for MMIO reads whose value the model cannot know; the
+// retired result is then flagged sync so a checker adopts the RTL value.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rv32
+{
+
+// Word-addressed memory allocated in 4 KiB pages on first write, so a
+// reference copy of a large harness memory costs only what is touched
+class SparseMemory
+{
+    static constexpr uint32_t page_words = 1024;
+    std::vector<std::unique_ptr<uint32_t[]>> pages;
+    size_t size_words;
+
+    uint32_t *page(size_t index)
+    {
+        auto &p = pages[index];
+        if (!p) {
+            p.reset(new uint32_t[page_words]());
+        }
+        return p.get();
+    }
+
+public:
+    SparseMemory(size_t words)
+        : pages((words + page_words - 1) / page_words), size_words(words)
+    {
+    }
+
+    size_t size() const { return size_words; }
+
+    uint32_t read(uint32_t address) const
+    {
+        size_t word = address / 4;
+        if (word >= size_words || !pages[word / page_words]) {
+            return 0;
+        }
+        return pages[word / page_words][word % page_words];
+    }
+
+    void write(uint32_t address, uint32_t value, uint32_t mask)
+    {
+        size_t word = address / 4;
+        if (word >= size_words) {
+            return;
+        }
+        uint32_t &slot = page(word / page_words)[word % page_words];
+        slot = (slot & ~mask) | (value & mask);
+    }
+
+    void load_binary(std::string const &filename, size_t load_address = 0x1000)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open file " + filename);
+        }
+        uint32_t word;
+        for (size_t address = load_address;
+             file.read(reinterpret_cast<char *>(&word), sizeof(word));
+             address += 4) {
+            write(address, word, 0xFFFFFFFF);
+        }
+    }
+
+    // Call f(address, word) for every word of every allocated page, zeros
+    // included, so a copy also clears what the program overwrote with zero
+    template <typename F>
+    void for_each_word(F &&f) const
+    {
+        for (size_t p = 0; p < pages.size(); ++p) {
+            if (!pages[p]) {
+                continue;
+            }
+            for (uint32_t i = 0; i < page_words; ++i) {
+                f(uint32_t((p * page_words + i) * 4), pages[p][i]);
+            }
+        }
+    }
+};
+
+namespace csr
+{
+constexpr uint32_t mstatus = 0x300;
+constexpr uint32_t mie = 0x304;
+constexpr uint32_t mtvec = 0x305;
+constexpr uint32_t mscratch = 0x340;
+constexpr uint32_t mepc = 0x341;
+constexpr uint32_t mcause = 0x342;
+constexpr uint32_t cycle = 0xc00;
+constexpr uint32_t cycleh = 0xc80;
+constexpr uint32_t mcountinhibit = 0x320;
+constexpr uint32_t mhpmevent31 = 0x33f;
+
+// Zicntr/Zihpm counters and their high halves: 0xb00-0xb1f, 0xb80-0xb9f,
+// 0xc00-0xc1f and 0xc80-0xc9f
+constexpr bool counter(uint32_t address)
+{
+    uint32_t base = address & ~0x9Fu;
+    return base == 0xb00 || base == 0xc00;
+}
+}  // namespace csr
+
+// Architectural effect of one instruction
+struct Retired
+{
+    uint32_t pc = 0;
+    uint32_t instruction = 0;
+    bool reg_write = false;  // rd != 0 written
+    uint32_t rd = 0;
+    uint32_t rd_data = 0;
+    bool store = false;
+    uint32_t address = 0;  // word-aligned store address
+    uint32_t store_data = 0;  // already shifted into its byte lanes
+    uint32_t store_mask = 0;
+    bool trap = false;  // ecall/ebreak taken
+    bool sync = false;  // rd_data came from a device or counter
+};
+
+template <typename Bus>
+class Hart
+{
+    Bus &bus;
+
+public:
+    uint32_t pc = 0x1000;
+    uint32_t x[32] = {0};
+    uint32_t mstatus = 0, mie = 0, mtvec = 0, mscratch = 0, mepc = 0,
+             mcause = 0;
+    uint64_t cycles = 0;
+    uint64_t instret = 0;
+    // 3-pipeline's CLINT also forces mstatus.MPP to 3 on trap entry and mret
+    bool trap_sets_mpp = false;
+
+    Hart(Bus &bus) : bus(bus) {}
+
+    // Trap entry as the CLINT does it; the caller sets the PC to mtvec
+    void enter_trap(uint32_t epc, uint32_t cause)
+    {
+        mepc = epc;
+        mcause = cause;
+        mstatus = (mstatus & ~0x88u) | ((mstatus & 0x8) << 4);
+        if (trap_sets_mpp) {
+            mstatus |= 0x1800;
+        }
+    }
+
+    // Take an interrupt before the instruction at pc, which becomes mepc
+    void interrupt(uint32_t cause)
+    {
+        enter_trap(pc, cause);
+        pc = mtvec;
+    }
+
+    bool csr_read(uint32_t address, uint32_t &value, bool &sync)
+    {
+        switch (address) {
+        case csr::mstatus:
+            value = mstatus;
+            return true;
+        case csr::mie:
+            value = mie;
+            return true;
+        case csr::mtvec:
+            value = mtvec;
+            return true;
+        case csr::mscratch:
+            value = mscratch;
+            return true;
+        case csr::mepc:
+            value = mepc;
+            return true;
+        case csr::mcause:
+            value = mcause;
+            return true;
+        case csr::cycle:
+            value = uint32_t(cycles);
+            sync = true;
+            return true;
+        case csr::cycleh:
+            value = uint32_t(cycles >> 32);
+            sync = true;
+            return true;
+        }
+        // Other Zicntr/Zihpm counters (0xb00-0xb1f, 0xc00-0xc1f and their
+        // high halves), mcountinhibit and mhpmevent count what the core
+        // does, not what the model does: take them from the RTL
+        if (csr::counter(address) ||
+            (address >= csr::mcountinhibit && address <= csr::mhpmevent31)) {
+            value = 0;
+            sync = true;
+            return true;
+        }
+        value = 0;
+        return false;
+    }
+
+    void csr_write(uint32_t address, uint32_t value)
+    {
+        switch (address) {
+        case csr::mstatus:
+            mstatus = value;
+            break;
+        case csr::mie:
+            mie = value;
+            break;
+        case csr::mtvec:
+            mtvec = value;
+            break;
+        case csr::mscratch:
+            mscratch = value;
+            break;
+        case csr::mepc:
+            mepc = value;
+            break;
+        case csr::mcause:
+            mcause = value;
+            break;
+        }
+    }
+
+    Retired step()
+    {
+        Retired r;
+        uint32_t insn = bus.fetch(pc);
+        r.pc = pc;
+        r.instruction = insn;
+
+        uint32_t opcode = insn & 0x7F;
+        uint32_t rd = (insn >> 7) & 0x1F;
+        uint32_t funct3 = (insn >> 12) & 0x7;
+        uint32_t rs1 = (insn >> 15) & 0x1F;
+        uint32_t rs2 = (insn >> 20) & 0x1F;
+        uint32_t funct7 = insn >> 25;
+        uint32_t a = x[rs1], b = x[rs2];
+        int32_t imm_i = int32_t(insn) >> 20;
+        int32_t imm_s =
+            (int32_t(insn & 0xFE000000) >> 20) | ((insn >> 7) & 0x1F);
+        int32_t imm_b = (int32_t(insn & 0x80000000) >> 19) |
+                        ((insn & 0x80) << 4) | ((insn >> 20) & 0x7E0) |
+                        ((insn >> 7) & 0x1E);
+        int32_t imm_j = (int32_t(insn & 0x80000000) >> 11) |
+                        (insn & 0xFF000) | ((insn >> 9) & 0x800) |
+                        ((insn >> 20) & 0x7FE);
+
+        uint32_t next_pc = pc + 4;
+        bool write = false;
+        uint32_t value = 0;
+
+        switch (opcode) {
+        case 0x37:  // LUI
+            write = true;
+            value = insn & 0xFFFFF000;
+            break;
+        case 0x17:  // AUIPC
+            write = true;
+            value = pc + (insn & 0xFFFFF000);
+            break;
+        case 0x6F:  // JAL
+            write = true;
+            value = pc + 4;
+            next_pc = pc + imm_j;
+            break;
+        case 0x67:  // JALR
+            write = true;
+            value = pc + 4;
+            next_pc = (a + imm_i) & ~1u;
+            break;
+        case 0x63: {  // BRANCH
+            bool taken = false;
+            switch (funct3) {
+            case 0:
+                taken = a == b;
+                break;
+            case 1:
+                taken = a != b;
+                break;
+            case 4:
+                taken = int32_t(a) < int32_t(b);
+                break;
+            case 5:
+                taken = int32_t(a) >= int32_t(b);
+                break;
+            case 6:
+                taken = a < b;
+                break;
+            case 7:
+                taken = a >= b;
+                break;
+            }
+            if (taken) {
+                next_pc = pc + imm_b;
+            }
+            break;
+        }
+        case 0x03: {  // LOAD
+            uint32_t address = a + imm_i;
+            uint32_t shift = (address & 3) * 8;
+            bool device = false;
+            uint32_t word = bus.load(address & ~3u, device) >> shift;
+            write = true;
+            r.sync = device;
+            switch (funct3) {
+            case 0:
+                value = int32_t(int8_t(word));
+                break;
+            case 1:
+                value = int32_t(int16_t(word));
+                break;
+            case 2:
+                value = word;
+                break;
+            case 4:
+                value = word & 0xFF;
+                break;
+            case 5:
+                value = word & 0xFFFF;
+                break;
+            }
+            break;
+        }
+        case 0x23: {  // STORE
+            uint32_t address = a + imm_s;
+            uint32_t shift = (address & 3) * 8;
+            uint32_t mask = funct3 == 0 ? 0xFFu : funct3 == 1 ? 0xFFFFu : ~0u;
+            r.store = true;
+            r.address = address & ~3u;
+            r.store_mask = mask << shift;
+            r.store_data = (b << shift) & r.store_mask;
+            bus.store(r.address, r.store_data, r.store_mask);
+            break;
+        }
+        case 0x13:  // OP-IMM
+        case 0x33: {  // OP
+            bool imm = opcode == 0x13;
+            uint32_t op2 = imm ? uint32_t(imm_i) : b;
+            bool alt = (funct7 & 0x20) && (!imm || funct3 == 5);
+            write = true;
+            switch (funct3) {
+            case 0:
+                value = alt ? a - op2 : a + op2;
+                break;
+            case 1:
+                value = a << (op2 & 31);
+                break;
+            case 2:
+                value = int32_t(a) < int32_t(op2);
+                break;
+            case 3:
+                value = a < op2;
+                break;
+            case 4:
+                value = a ^ op2;
+                break;
+            case 5:
+                value = alt ? uint32_t(int32_t(a) >> (op2 & 31))
+                            : a >> (op2 & 31);
+                break;
+            case 6:
+                value = a | op2;
+                break;
+            case 7:
+                value = a & op2;
+                break;
+            }
+            break;
+        }
+        case 0x73:  // SYSTEM
+            if (funct3 == 0) {
+                if (insn == 0x00000073 || insn == 0x00100073) {  // ecall/ebreak
+                    r.trap = true;
+                    enter_trap(pc + 4, insn == 0x00000073 ? 11 : 3);
+                    next_pc = mtvec;
+                } else if (insn == 0x30200073) {  // mret
+                    mstatus = (mstatus & ~0x8u) | ((mstatus >> 4) & 0x8) | 0x80;
+                    if (trap_sets_mpp) {
+                        mstatus |= 0x1800;
+                    }
+                    next_pc = mepc;
+                }
+            } else {
+                uint32_t address = insn >> 20;
+                uint32_t operand = (funct3 & 4) ? rs1 : a;
+                uint32_t old = 0;
+                csr_read(address, old, r.sync);
+                write = true;
+                value = old;
+                switch (funct3 & 3) {
+                case 1:
+                    csr_write(address, operand);
+                    break;
+                case 2:
+                    if (rs1 != 0) {
+                        csr_write(address, old | operand);
+                    }
+                    break;
+                case 3:
+                    if (rs1 != 0) {
+                        csr_write(address, old & ~operand);
+                    }
+                    break;
+                }
+            }
+            break;
+        default:  // FENCE and anything the cores decode as a no-op
+            break;
+        }
+
+        if (write && rd != 0) {
+            x[rd] = value;
+            r.reg_write = true;
+            r.rd = rd;
+            r.rd_data = value;
+        }
+        pc = next_pc;
+        ++cycles;
+        ++instret;
+        return r;
+    }
+};
+
+// True when r, the instruction the hart just stepped, left it parked for
+// good: "j .", which the test programs end with, or wfi while mstatus.MIE is
+// clear. With MIE set an interrupt may wake the core from wfi (the cores'
+// CLINT does not look at mie), and the model, which takes none by itself,
+// just runs on past it.
+template <typename Bus>
+inline bool parked(Hart<Bus> const &hart, Retired const &r)
+{
+    return hart.pc == r.pc ||
+           (r.instruction == 0x10500073 && !(hart.mstatus & 0x8));
+}
+
+inline const char *reg_name(uint32_t reg)
+{
+    static const char *const names[] = {
+        "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2",
+        "s0",   "s1", "a0", "a1", "a2",  "a3",  "a4", "a5",
+        "a6",   "a7", "s2", "s3", "s4",  "s5",  "s6", "s7",
+        "s8",   "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+    };
+    return names[reg & 31];
+}
+
+// One-line disassembly for diagnostics ("addi a0, a0, 1")
+inline std::string disassemble(uint32_t insn, uint32_t pc)
+{
+    uint32_t opcode = insn & 0x7F;
+    uint32_t rd = (insn >> 7) & 0x1F;
+    uint32_t funct3 = (insn >> 12) & 0x7;
+    uint32_t rs1 = (insn >> 15) & 0x1F;
+    uint32_t rs2 = (insn >> 20) & 0x1F;
+    uint32_t funct7 = insn >> 25;
+    int32_t imm_i = int32_t(insn) >> 20;
+    int32_t imm_s = (int32_t(insn & 0xFE000000) >> 20) | ((insn >> 7) & 0x1F);
+    int32_t imm_b = (int32_t(insn & 0x80000000) >> 19) | ((insn & 0x80) << 4) |
+                    ((insn >> 20) & 0x7E0) | ((insn >> 7) & 0x1E);
+    int32_t imm_j = (int32_t(insn & 0x80000000) >> 11) | (insn & 0xFF000) |
+                    ((insn >> 9) & 0x800) | ((insn >> 20) & 0x7FE);
+    char text[64];
+
+    switch (opcode) {
+    case 0x37:
+        snprintf(text, sizeof(text), "lui %s, 0x%x", reg_name(rd), insn >> 12);
+        break;
+    case 0x17:
+        snprintf(text, sizeof(text), "auipc %s, 0x%x", reg_name(rd),
+                 insn >> 12);
+        break;
+    case 0x6F:
+        snprintf(text, sizeof(text), "jal %s, 0x%x", reg_name(rd), pc + imm_j);
+        break;
+    case 0x67:
+        snprintf(text, sizeof(text), "jalr %s, %d(%s)", reg_name(rd), imm_i,
+                 reg_name(rs1));
+        break;
+    case 0x63: {
+        static const char *const ops[] = {"beq", "bne", "b?",   "b?",
+                                          "blt", "bge", "bltu", "bgeu"};
+        snprintf(text, sizeof(text), "%s %s, %s, 0x%x", ops[funct3],
+                 reg_name(rs1), reg_name(rs2), pc + imm_b);
+        break;
+    }
+    case 0x03: {
+        static const char *const ops[] = {"lb",  "lh",  "lw", "l?",
+                                          "lbu", "lhu", "l?", "l?"};
+        snprintf(text, sizeof(text), "%s %s, %d(%s)", ops[funct3], reg_name(rd),
+                 imm_i, reg_name(rs1));
+        break;
+    }
+    case 0x23: {
+        static const char *const ops[] = {"sb", "sh", "sw", "s?",
+                                          "s?", "s?", "s?", "s?"};
+        snprintf(text, sizeof(text), "%s %s, %d(%s)", ops[funct3],
+                 reg_name(rs2), imm_s, reg_name(rs1));
+        break;
+    }
+    case 0x13: {
+        static const char *const ops[] = {"addi", "slli", "slti", "sltiu",
+                                          "xori", "srli", "ori",  "andi"};
+        const char *op = funct3 == 5 && (funct7 & 0x20) ? "srai" : ops[funct3];
+        int32_t imm = (funct3 == 1 || funct3 == 5) ? int32_t(rs2) : imm_i;
+        snprintf(text, sizeof(text), "%s %s, %s, %d", op, reg_name(rd),
+                 reg_name(rs1), imm);
+        break;
+    }
+    case 0x33: {
+        static const char *const ops[] = {"add", "sll", "slt", "sltu",
+                                          "xor", "srl", "or",  "and"};
+        const char *op = ops[funct3];
+        if (funct7 & 0x20) {
+            op = funct3 == 0 ? "sub" : "sra";
+        }
+        snprintf(text, sizeof(text), "%s %s, %s, %s", op, reg_name(rd),
+                 reg_name(rs1), reg_name(rs2));
+        break;
+    }
+    case 0x0F:
+        snprintf(text, sizeof(text), "fence");
+        break;
+    case 0x73:
+        if (funct3 == 0) {
+            snprintf(text, sizeof(text), "%s",
+                     insn == 0x00000073   ? "ecall"
+                     : insn == 0x00100073 ? "ebreak"
+                     : insn == 0x30200073 ? "mret"
+                     : insn == 0x10500073 ? "wfi"
+                                          : "system");
+        } else {
+            static const char *const ops[] = {"csr?",  "csrrw",  "csrrs",
+                                              "csrrc", "csr?",   "csrrwi",
+                                              "csrrsi", "csrrci"};
+            if (funct3 & 4) {
+                snprintf(text, sizeof(text), "%s %s, 0x%x, %u", ops[funct3],
+                         reg_name(rd), insn >> 20, rs1);
+            } else {
+                snprintf(text, sizeof(text), "%s %s, 0x%x, %s", ops[funct3],
+                         reg_name(rd), insn >> 20, reg_name(rs1));
+            }
+        }
+        break;
+    default:
+        snprintf(text, sizeof(text), ".word 0x%08x", insn);
+        break;
+    }
+    return text;
+}
+
+}  // namespace rv32
@@ -0,0 +1,202 @@
+// Pipeline diagrams in the Kanata log format (Konata viewer).
+//
+// Fed every cycle from the io_pipeline_* occupancy port, which reports the
+// fetch-slot id, PC and instruction word held in IF and in each pipeline
+// register, it follows every fetched instruction through IF/ID/EX/MEM/WB:
+//
+//     I  a fetch slot appears for the first time (label: PC and disassembly)
+//     S  it moves on to the next stage; staying put is a stall, and the
+//        stall reason from io_hazard_* is added to its hover text
+//     R  it leaves the pipeline: retired (type 0) from the last stage, or
+//        flushed (type 1) as a wrong-path fetch
+//
+// Stages that hold no valid instruction are bubbles and show as gaps.
+// Logging can be restricted to a window of cycles; instructions in flight
+// when the window opens start in whatever stage they occupy, and those still
+// in flight when it closes are left open.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "rv32_iss.h"
+
+namespace rv32
+{
+
+constexpr int KANATA_STAGES = 5;
+
+constexpr char const *kanata_stage_names[KANATA_STAGES] = {
+    "IF", "ID", "EX", "MEM", "WB",
+};
+
+// One cycle of the io_pipeline_* port, stage 0 being the fetch
+struct PipelineSample
+{
+    struct Stage
+    {
+        bool valid = false;
+        uint32_t id = 0;
+        uint32_t pc = 0;
+        uint32_t instruction = 0;
+    } stages[KANATA_STAGES];
+    bool retire_valid = false;
+    uint32_t retire_id = 0;
+    uint32_t stall_reason = 0;  // riscv.core.StallReason of the ID stage
+};
+
+class KanataWriter
+{
+    struct InFlight
+    {
+        uint64_t file_id;
+        int stage;
+    };
+
+    std::ofstream out;
+    uint64_t first_cycle;
+    uint64_t last_cycle;
+    bool started = false;
+    uint64_t previous_cycle = 0;
+    uint64_t next_file_id = 0;
+    uint64_t retired = 0;
+    uint64_t flushed = 0;
+    std::unordered_map<uint32_t, InFlight> in_flight;  // fetch id -> entry
+    bool retiring = false;  // the last stage retired retiring_id last cycle
+    uint32_t retiring_id = 0;
+
+    static char const *stall_text(uint32_t reason)
+    {
+        switch (reason) {
+        case 1:
+            return "load-use stall";
+        case 2:
+            return "jump dependency stall";
+        case 3:
+            return "data hazard stall";
+        default:
+            return "stall";
+        }
+    }
+
+    void advance_to(uint64_t cycle)
+    {
+        if (!started) {
+            out << "C=\t" << cycle << '\n';
+            started = true;
+        } else if (cycle != previous_cycle) {
+            out << "C\t" << cycle - previous_cycle << '\n';
+        }
+        previous_cycle = cycle;
+    }
+
+public:
+    KanataWriter(std::string const &filename, uint64_t first_cycle = 0,
+                 uint64_t last_cycle = UINT64_MAX)
+        : out(filename), first_cycle(first_cycle), last_cycle(last_cycle)
+    {
+        if (!out) {
+            throw std::runtime_error("Could not open pipeline log " +
+                                     filename);
+        }
+        out << "Kanata\t0004\n";
+    }
+
+    uint64_t instructions() const { return next_file_id; }
+    uint64_t flushes() const { return flushed; }
+
+    // Record the pipeline as it is during this cycle; call once per cycle
+    // just before the rising edge
+    void record(uint64_t cycle, PipelineSample const &s)
+    {
+        if (cycle < first_cycle || cycle > last_cycle) {
+            return;
+        }
+        advance_to(cycle);
+
+        // Whatever was in flight and is gone now left the pipeline at the
+        // last edge: retired if the last stage reported it, else flushed
+        for (auto it = in_flight.begin(); it != in_flight.end();) {
+            bool present = false;
+            for (auto const &stage : s.stages) {
+                present |= stage.valid && stage.id == it->first;
+            }
+            if (present) {
+                ++it;
+                continue;
+            }
+            if (retiring && retiring_id == it->first) {
+                out << "R\t" << it->second.file_id << '\t' << retired++
+                    << "\t0\n";
+            } else {
+                out << "R\t" << it->second.file_id << "\t0\t1\n";
+                ++flushed;
+            }
+            it = in_flight.erase(it);
+        }
+
+        for (int i = 0; i < KANATA_STAGES; ++i) {
+            auto const &stage = s.stages[i];
+            if (!stage.valid) {
+                continue;
+            }
+            auto [it, inserted] =
+                in_flight.emplace(stage.id, InFlight{next_file_id, -1});
+            InFlight &entry = it->second;
+            if (inserted) {
+                out << "I\t" << entry.file_id << '\t' << stage.id << "\t0\n";
+                char pc_text[16];
+                std::snprintf(pc_text, sizeof(pc_text), "%08x: ", stage.pc);
+                out << "L\t" << entry.file_id << "\t0\t" << pc_text
+                    << disassemble(stage.instruction, stage.pc) << '\n';
+                ++next_file_id;
+            }
+            if (entry.stage != i) {
+                out << "S\t" << entry.file_id << "\t0\t"
+                    << kanata_stage_names[i] << '\n';
+                entry.stage = i;
+            }
+            if (i == 1 && s.stall_reason) {
+                out << "L\t" << entry.file_id << "\t1\tcycle " << cycle
+                    << ": " << stall_text(s.stall_reason) << "\\n\n";
+            }
+        }
+
+        retiring = s.retire_valid;
+        retiring_id = s.retire_id;
+    }
+
+    // Sample a Verilated top's io_pipeline_* and io_hazard_stall_reason
+    template <typename Top>
+    void sample(uint64_t cycle, Top const &top)
+    {
+        if (cycle < first_cycle || cycle > last_cycle) {
+            return;
+        }
+        PipelineSample s;
+#define KANATA_STAGE(n)                                                 \
+    s.stages[n] = {bool(top.io_pipeline_stages_##n##_valid),            \
+                   uint32_t(top.io_pipeline_stages_##n##_id),           \
+                   uint32_t(top.io_pipeline_stages_##n##_pc),           \
+                   uint32_t(top.io_pipeline_stages_##n##_instruction)}
+        KANATA_STAGE(0);
+        KANATA_STAGE(1);
+        KANATA_STAGE(2);
+        KANATA_STAGE(3);
+        KANATA_STAGE(4);
+#undef KANATA_STAGE
+        s.retire_valid = top.io_pipeline_retire_valid;
+        s.retire_id = top.io_pipeline_retire_id;
+        s.stall_reason = top.io_hazard_stall_reason;
+        record(cycle, s);
+    }
+
+    void finish() { out.flush(); }
+};
+
+}  // namespace rv32
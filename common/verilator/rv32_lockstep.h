@@ -0,0 +1,161 @@
+// Lockstep checking of an RTL core against the rv32::Hart reference model.
+//
+// The harness reports every register write and store the RTL retires, in
+// order. For each one the model is stepped to its next architectural effect
+// and the two are compared; the first divergence is printed with the
+// instruction, its PC and the expected and actual values. Interrupts the RTL
+// takes are reported too, so the model takes them at the same point.
+
+#pragma once
+
+#include <cstdio>
+
+#include "rv32_iss.h"
+
+namespace rv32
+{
+
+template <typename Bus>
+class LockstepChecker
+{
+    Hart<Bus> &hart;
+    Retired expected;  // the instruction the model stepped last
+    bool stepped = false;
+    bool has_expected = false;
+    bool failed = false;
+    uint64_t checked = 0;
+
+    // Give up when the model runs this long without producing a result the
+    // RTL could be compared against (e.g. it is spinning on a diverged path)
+    static constexpr uint64_t max_silent_steps = 1u << 24;
+
+    bool next()
+    {
+        for (uint64_t steps = 0; !has_expected; ++steps) {
+            if (steps == max_silent_steps) {
+                std::printf(
+                    "ISS mismatch: reference model retired %llu instructions "
+                    "without a register write or store (PC 0x%08x)\n",
+                    (unsigned long long) steps, hart.pc);
+                return false;
+            }
+            expected = hart.step();
+            stepped = true;
+            has_expected = expected.reg_write || expected.store;
+        }
+        return true;
+    }
+
+    void report(uint64_t cycle, const char *actual)
+    {
+        char expected_text[64];
+        if (expected.reg_write) {
+            snprintf(expected_text, sizeof(expected_text), "x%u (%s) <- 0x%08x",
+                     expected.rd, reg_name(expected.rd), expected.rd_data);
+        } else {
+            snprintf(expected_text, sizeof(expected_text),
+                     "[0x%08x] <- 0x%08x (mask 0x%08x)", expected.address,
+                     expected.store_data, expected.store_mask);
+        }
+        std::printf("ISS mismatch at cycle %llu after %llu matching results\n",
+                    (unsigned long long) cycle, (unsigned long long) checked);
+        std::printf("  instruction: 0x%08x  %08x  %s\n", expected.pc,
+                    expected.instruction,
+                    disassemble(expected.instruction, expected.pc).c_str());
+        std::printf("  expected:    %s\n", expected_text);
+        std::printf("  actual:      %s\n", actual);
+        failed = true;
+    }
+
+public:
+    LockstepChecker(Hart<Bus> &hart) : hart(hart) {}
+
+    bool ok() const { return !failed; }
+    uint64_t matched() const { return checked; }
+
+    // The RTL took an interrupt with the given mcause right after retiring
+    // the instruction at interrupted_pc; call before checking the results
+    // of the handler's first instruction
+    bool interrupt(uint64_t cycle, uint32_t interrupted_pc, uint32_t cause)
+    {
+        if (failed) {
+            return false;
+        }
+        // The model stops after the instruction behind the last result, so
+        // nothing it runs up to interrupted_pc may have an effect
+        for (uint64_t steps = 0; !stepped || expected.pc != interrupted_pc;
+             ++steps) {
+            if (steps == max_silent_steps) {
+                std::printf("ISS mismatch: interrupt at cycle %llu after PC "
+                            "0x%08x, which the reference model did not reach "
+                            "(PC 0x%08x)\n",
+                            (unsigned long long) cycle, interrupted_pc,
+                            hart.pc);
+                failed = true;
+                return false;
+            }
+            expected = hart.step();
+            stepped = true;
+            if (expected.reg_write || expected.store) {
+                has_expected = true;
+                char actual[64];
+                snprintf(actual, sizeof(actual),
+                         "interrupt after PC 0x%08x", interrupted_pc);
+                report(cycle, actual);
+                return false;
+            }
+        }
+        hart.interrupt(cause);
+        return true;
+    }
+
+    // The RTL wrote data to register rd (rd != 0)
+    bool reg_write(uint64_t cycle, uint32_t rd, uint32_t data)
+    {
+        if (failed || !next()) {
+            failed = true;
+            return false;
+        }
+        char actual[64];
+        snprintf(actual, sizeof(actual), "x%u (%s) <- 0x%08x", rd, reg_name(rd),
+                 data);
+        if (!expected.reg_write || expected.rd != rd) {
+            report(cycle, actual);
+            return false;
+        }
+        if (expected.sync) {
+            // Device reads and counters: the RTL value is the truth
+            hart.x[rd] = data;
+        } else if (expected.rd_data != data) {
+            report(cycle, actual);
+            return false;
+        }
+        has_expected = false;
+        ++checked;
+        return true;
+    }
+
+    // The RTL stored data under mask to the word at address
+    bool store(uint64_t cycle, uint32_t address, uint32_t data, uint32_t mask)
+    {
+        if (failed || !next()) {
+            failed = true;
+            return false;
+        }
+        address &= ~3u;
+        data &= mask;
+        char actual[64];
+        snprintf(actual, sizeof(actual), "[0x%08x] <- 0x%08x (mask 0x%08x)",
+                 address, data, mask);
+        if (!expected.store || expected.address != address ||
+            expected.store_data != data || expected.store_mask != mask) {
+            report(cycle, actual);
+            return false;
+        }
+        has_expected = false;
+        ++checked;
+        return true;
+    }
+};
+
+}  // namespace rv32
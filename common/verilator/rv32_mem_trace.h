@@ -0,0 +1,237 @@
+// Compact binary log of a core's instruction fetches and data accesses.
+//
+// Fed from the io_retire_* port, every retired instruction contributes a
+// fetch of its PC and, for loads and stores, one data access of 1, 2 or 4
+// bytes. Only the correct path is logged: wrong-path fetches a pipeline
+// flushes never retire. tools/cachesim replays the log against cache
+// configurations. After an 8-byte header ("RVMT", version, 3 reserved bytes)
+// every record is
+//
+//     flags         u8, MEM_* below: kind, log2 of the size, and whether the
+//                   cycle and address are implied
+//     cycle delta   varint, rising edges since the previous record, unless
+//                   MEM_SAME_CYCLE or MEM_NEXT_CYCLE
+//     address delta zigzag varint against the previous access of the same
+//                   stream (fetch or data), unless MEM_SEQUENTIAL
+//
+// A fetch is sequential when it follows the previous fetch by 4 bytes, a data
+// access when it starts where the previous one ended, so straight-line code
+// on the single-cycle core costs one byte per instruction and a memcpy-style
+// loop one more per access. Varints are LEB128, as in rv32_commit_log.h.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rv32
+{
+
+enum MemKind : uint8_t {
+    MEM_FETCH = 0,
+    MEM_LOAD = 1,
+    MEM_STORE = 2,
+};
+
+enum MemFlags : uint8_t {
+    MEM_KIND_MASK = 3 << 0,
+    MEM_SIZE_SHIFT = 2,  // bits 2-3: log2 of the size in bytes
+    MEM_SEQUENTIAL = 1 << 4,
+    MEM_SAME_CYCLE = 1 << 5,
+    MEM_NEXT_CYCLE = 1 << 6,
+};
+
+constexpr char MEM_TRACE_MAGIC[4] = {'R', 'V', 'M', 'T'};
+constexpr uint8_t MEM_TRACE_VERSION = 1;
+
+struct MemAccess
+{
+    uint64_t cycle = 0;
+    uint32_t address = 0;
+    uint32_t size = 4;
+    MemKind kind = MEM_FETCH;
+};
+
+class MemTraceWriter
+{
+    std::ofstream out;
+    std::vector<uint8_t> buffer;
+    uint64_t last_cycle = 0;
+    uint32_t next_fetch = 0;  // address a sequential fetch would have
+    uint32_t last_fetch = 0;
+    uint32_t next_data = 0;
+    uint32_t last_data = 0;
+    uint64_t fetches = 0;
+    uint64_t data_accesses = 0;
+
+    void put_varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            buffer.push_back(uint8_t(value) | 0x80);
+            value >>= 7;
+        }
+        buffer.push_back(uint8_t(value));
+    }
+
+    void flush_buffer()
+    {
+        out.write(reinterpret_cast<char const *>(buffer.data()),
+                  buffer.size());
+        buffer.clear();
+    }
+
+public:
+    explicit MemTraceWriter(std::string const &filename)
+        : out(filename, std::ios::binary)
+    {
+        if (!out) {
+            throw std::runtime_error("Could not open memory trace " +
+                                     filename);
+        }
+        char header[8] = {MEM_TRACE_MAGIC[0], MEM_TRACE_MAGIC[1],
+                          MEM_TRACE_MAGIC[2], MEM_TRACE_MAGIC[3],
+                          char(MEM_TRACE_VERSION)};
+        out.write(header, sizeof(header));
+        buffer.reserve(1 << 16);
+    }
+
+    ~MemTraceWriter() { finish(); }
+
+    uint64_t instructions() const { return fetches; }
+    uint64_t accesses() const { return data_accesses; }
+
+    void record(MemAccess const &a)
+    {
+        uint32_t log2_size = a.size >= 4 ? 2 : a.size >> 1;
+        uint8_t flags = a.kind | (log2_size << MEM_SIZE_SHIFT);
+        uint64_t delta = a.cycle - last_cycle;
+        if (delta == 0) {
+            flags |= MEM_SAME_CYCLE;
+        } else if (delta == 1) {
+            flags |= MEM_NEXT_CYCLE;
+        }
+        bool fetch = a.kind == MEM_FETCH;
+        uint32_t &next = fetch ? next_fetch : next_data;
+        uint32_t &last = fetch ? last_fetch : last_data;
+        if (a.address == next) {
+            flags |= MEM_SEQUENTIAL;
+        }
+        buffer.push_back(flags);
+        if (delta > 1) {
+            put_varint(delta);
+        }
+        if (!(flags & MEM_SEQUENTIAL)) {
+            int32_t diff = int32_t(a.address - last);
+            put_varint((uint32_t(diff) << 1) ^ uint32_t(diff >> 31));
+        }
+        last_cycle = a.cycle;
+        last = a.address;
+        next = a.address + (fetch ? 4 : a.size);
+        ++(fetch ? fetches : data_accesses);
+        if (buffer.size() >= (1 << 16) - 16) {
+            flush_buffer();
+        }
+    }
+
+    // Log the instruction on a Verilated top's io_retire_* port, if any;
+    // call once per cycle just before the rising edge
+    template <typename Top>
+    void sample(uint64_t cycle, Top const &top)
+    {
+        if (!top.io_retire_valid) {
+            return;
+        }
+        record({cycle, uint32_t(top.io_retire_pc), 4, MEM_FETCH});
+        uint32_t address = top.io_retire_memory_address;
+        uint32_t strobe = top.io_retire_memory_write_strobe;
+        if (strobe) {
+            // The strobe holds the written byte lanes of the word
+            uint32_t first = __builtin_ctz(strobe);
+            record({cycle, (address & ~3u) + first,
+                    uint32_t(__builtin_popcount(strobe)), MEM_STORE});
+        } else if (top.io_retire_memory_read) {
+            // funct3 of a load: 0/4 byte, 1/5 halfword, 2 word
+            uint32_t size = 1u << ((top.io_retire_instruction >> 12) & 3);
+            record({cycle, address, size, MEM_LOAD});
+        }
+    }
+
+    void finish()
+    {
+        if (!buffer.empty()) {
+            flush_buffer();
+        }
+        out.flush();
+    }
+};
+
+// Decodes a memory trace held in memory (read or mapped by the caller)
+class MemTraceReader
+{
+    uint8_t const *p;
+    uint8_t const *end;
+    uint64_t cycle = 0;
+    uint32_t next_fetch = 0;
+    uint32_t last_fetch = 0;
+    uint32_t next_data = 0;
+    uint32_t last_data = 0;
+
+    uint64_t get_varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; p < end; shift += 7) {
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("truncated memory trace");
+    }
+
+public:
+    MemTraceReader(uint8_t const *data, size_t size) : p(data), end(data + size)
+    {
+        if (size < 8 || std::string(reinterpret_cast<char const *>(data), 4) !=
+                            std::string(MEM_TRACE_MAGIC, 4)) {
+            throw std::runtime_error("not a memory trace");
+        }
+        if (data[4] != MEM_TRACE_VERSION) {
+            throw std::runtime_error("unsupported memory trace version");
+        }
+        p += 8;
+    }
+
+    bool next(MemAccess &a)
+    {
+        if (p >= end) {
+            return false;
+        }
+        uint8_t flags = *p++;
+        if (flags & MEM_NEXT_CYCLE) {
+            ++cycle;
+        } else if (!(flags & MEM_SAME_CYCLE)) {
+            cycle += get_varint();
+        }
+        a.kind = MemKind(flags & MEM_KIND_MASK);
+        a.size = 1u << ((flags >> MEM_SIZE_SHIFT) & 3);
+        a.cycle = cycle;
+        bool fetch = a.kind == MEM_FETCH;
+        uint32_t &next = fetch ? next_fetch : next_data;
+        uint32_t &last = fetch ? last_fetch : last_data;
+        if (flags & MEM_SEQUENTIAL) {
+            a.address = next;
+        } else {
+            uint32_t zigzag = get_varint();
+            a.address = last + ((zigzag >> 1) ^ -(zigzag & 1));
+        }
+        last = a.address;
+        next = a.address + (fetch ? 4 : a.size);
+        return true;
+    }
+};
+
+}  // namespace rv32
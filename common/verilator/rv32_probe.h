@@ -0,0 +1,200 @@
+// Columnar sampling of top-level ports, a lightweight alternative to VCD.
+//
+// The harness registers its ports (name and address of the Verilated field)
+// and the user picks some with shell-style patterns; every interval-th cycle
+// each picked port is copied into a fixed-width column buffer. Columns are
+// written in blocks, so a block is a plain array per signal that NumPy can
+// view without parsing (scripts/probes.py). Little-endian layout:
+//
+//     header        32 bytes: "RVPR", u16 version, u16 columns,
+//                   u32 block_rows, u32 header_bytes, u64 interval,
+//                   u64 reserved
+//     column table  64 bytes per column: u8 width in bytes (1, 2, 4 or 8),
+//                   63-byte NUL-padded name; column 0 is "cycle" (u64)
+//     blocks        u64 rows, then each column's rows values, every column
+//                   padded to 8 bytes; all blocks but the last hold
+//                   block_rows rows
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fnmatch.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rv32
+{
+
+constexpr char PROBE_MAGIC[4] = {'R', 'V', 'P', 'R'};
+constexpr uint16_t PROBE_VERSION = 1;
+constexpr size_t PROBE_NAME_BYTES = 63;
+
+// A port that can be probed: a Verilated top field
+struct ProbePort
+{
+    std::string name;
+    void const *source;
+    uint8_t bytes;
+};
+
+class ProbePorts
+{
+    std::vector<ProbePort> ports;
+
+public:
+    template <typename T>
+    void add(std::string name, T const *source)
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) <= 8,
+                      "probes are Verilator CData/SData/IData/QData ports");
+        ports.push_back({std::move(name), source, uint8_t(sizeof(T))});
+    }
+
+    std::vector<ProbePort> const &all() const { return ports; }
+
+    // Ports matching a comma-separated list of shell patterns, in the
+    // order of the list
+    std::vector<ProbePort> select(std::string const &patterns) const
+    {
+        std::vector<ProbePort> picked;
+        std::stringstream list(patterns);
+        std::string pattern;
+        while (std::getline(list, pattern, ',')) {
+            bool matched = false;
+            for (auto const &port : ports) {
+                if (fnmatch(pattern.c_str(), port.name.c_str(), 0) != 0) {
+                    continue;
+                }
+                matched = true;
+                bool duplicate = false;
+                for (auto const &p : picked) {
+                    duplicate |= p.source == port.source;
+                }
+                if (!duplicate) {
+                    picked.push_back(port);
+                }
+            }
+            if (!matched) {
+                throw std::runtime_error("no port matches probe '" + pattern +
+                                         "'");
+            }
+        }
+        return picked;
+    }
+};
+
+class ProbeWriter
+{
+    struct Column
+    {
+        ProbePort port;
+        std::vector<uint8_t> data;  // block_rows values
+    };
+
+    std::ofstream out;
+    uint64_t interval;
+    uint32_t block_rows;
+    std::vector<Column> columns;
+    std::vector<uint64_t> cycles;
+    uint32_t row = 0;
+    uint64_t total_rows = 0;
+
+    static size_t padded(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+    void write_header()
+    {
+        uint16_t count = columns.size() + 1;
+        uint32_t header_bytes = 32 + 64 * count;
+        uint64_t reserved = 0;
+        out.write(PROBE_MAGIC, 4);
+        out.write(reinterpret_cast<char const *>(&PROBE_VERSION), 2);
+        out.write(reinterpret_cast<char const *>(&count), 2);
+        out.write(reinterpret_cast<char const *>(&block_rows), 4);
+        out.write(reinterpret_cast<char const *>(&header_bytes), 4);
+        out.write(reinterpret_cast<char const *>(&interval), 8);
+        out.write(reinterpret_cast<char const *>(&reserved), 8);
+        auto entry = [&](std::string const &name, uint8_t bytes) {
+            char e[64] = {};
+            e[0] = char(bytes);
+            std::strncpy(e + 1, name.c_str(), PROBE_NAME_BYTES - 1);
+            out.write(e, sizeof(e));
+        };
+        entry("cycle", 8);
+        for (auto const &c : columns) {
+            entry(c.port.name, c.port.bytes);
+        }
+    }
+
+    void write_block()
+    {
+        static char const zeros[8] = {};
+        uint64_t rows = row;
+        out.write(reinterpret_cast<char const *>(&rows), 8);
+        out.write(reinterpret_cast<char const *>(cycles.data()), rows * 8);
+        for (auto const &c : columns) {
+            size_t bytes = rows * c.port.bytes;
+            out.write(reinterpret_cast<char const *>(c.data.data()), bytes);
+            out.write(zeros, padded(bytes) - bytes);
+        }
+        row = 0;
+    }
+
+public:
+    ProbeWriter(std::string const &filename, std::vector<ProbePort> ports,
+                uint64_t interval = 1, uint32_t block_rows = 1 << 16)
+        : out(filename, std::ios::binary),
+          interval(interval ? interval : 1),
+          block_rows(block_rows),
+          cycles(block_rows)
+    {
+        if (!out) {
+            throw std::runtime_error("Could not open probe file " + filename);
+        }
+        for (auto &port : ports) {
+            if (port.name.size() >= PROBE_NAME_BYTES) {
+                throw std::runtime_error("probe name too long: " + port.name);
+            }
+            columns.push_back({port, std::vector<uint8_t>(
+                                         size_t(block_rows) * port.bytes)});
+        }
+        write_header();
+    }
+
+    ~ProbeWriter() { finish(); }
+
+    size_t signals() const { return columns.size(); }
+    uint64_t rows() const { return total_rows; }
+
+    // Sample the ports if this cycle is on the interval; call once per cycle
+    // just before the rising edge
+    void sample(uint64_t cycle)
+    {
+        if (cycle % interval) {
+            return;
+        }
+        cycles[row] = cycle;
+        for (auto &c : columns) {
+            std::memcpy(&c.data[size_t(row) * c.port.bytes], c.port.source,
+                        c.port.bytes);
+        }
+        ++total_rows;
+        if (++row == block_rows) {
+            write_block();
+        }
+    }
+
+    void finish()
+    {
+        if (row) {
+            write_block();
+        }
+        out.flush();
+    }
+};
+
+}  // namespace rv32
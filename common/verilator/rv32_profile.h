@@ -0,0 +1,384 @@
+// Guest code profiler: cycles per PC, function, source line and call path.
+//
+// Fed from the io_retire_* port, it charges every clock cycle to the next
+// instruction that retires, so an instruction's cost includes the stalls and
+// flush bubbles in front of it and the counts add up to the simulated cycle
+// count exactly. Calls and returns are recognised from the retired
+// instructions, as the RISC-V calling convention marks them:
+//   call    jal/jalr that links into ra or t0 (x1/x5)
+//   return  jalr x0, 0(ra) or 0(t0); mret
+//   trap    ecall/ebreak (the handler's first instruction is the callee) and
+//           interrupt entry (retire.interrupt)
+// and build a calling-context tree: one node per distinct call path, keyed by
+// the callee's entry address. Tail calls and other plain jumps between
+// functions stay in the caller's node, so the call graph is an estimate.
+//
+// write() resolves PCs with the program's ELF (rv32_elf.h) when one is given
+// and writes a text report (flat profile by function, call graph with
+// inclusive cycles, hottest source lines and instructions) plus
+// "<report>.folded", one "caller;callee;... cycles" line per call path for
+// flamegraph.pl or speedscope.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rv32_elf.h"
+#include "rv32_iss.h"
+
+namespace rv32
+{
+
+class Profiler
+{
+    struct Node
+    {
+        uint32_t entry;   // callee entry PC
+        uint32_t parent;  // index; the root is its own parent
+        uint32_t depth;
+        uint64_t cycles = 0;  // self
+        uint64_t instructions = 0;
+        uint64_t calls = 0;
+        bool resume_call = false;  // a call was pending when a trap entered
+        std::unordered_map<uint32_t, uint32_t> children;  // entry -> index
+    };
+
+    struct PcCost
+    {
+        uint64_t cycles = 0;
+        uint64_t count = 0;
+        uint32_t instruction = 0;
+    };
+
+    // Deeper paths (runaway recursion, longjmp) stay in the deepest node
+    static constexpr uint32_t max_depth = 512;
+
+    std::vector<Node> nodes;
+    uint32_t current = 0;
+    bool pending_call = false;
+    uint64_t last_cycle = 0;
+    uint64_t total_cycles = 0;
+    uint64_t total_instructions = 0;
+    std::unordered_map<uint32_t, PcCost> pcs;
+
+    static bool is_link(uint32_t reg) { return reg == 1 || reg == 5; }
+
+    void descend(uint32_t entry)
+    {
+        if (nodes[current].depth >= max_depth) {
+            return;
+        }
+        auto [it, inserted] = nodes[current].children.emplace(
+            entry, uint32_t(nodes.size()));
+        uint32_t child = it->second;
+        if (inserted) {
+            Node node;
+            node.entry = entry;
+            node.parent = current;
+            node.depth = nodes[current].depth + 1;
+            nodes.push_back(std::move(node));
+        }
+        current = child;
+        ++nodes[current].calls;
+    }
+
+    void ascend()
+    {
+        if (current) {
+            current = nodes[current].parent;
+        }
+    }
+
+    // Subtree totals; children always follow their parent in nodes
+    std::vector<uint64_t> inclusive_cycles() const
+    {
+        std::vector<uint64_t> inclusive(nodes.size());
+        for (size_t i = nodes.size(); i-- > 0;) {
+            inclusive[i] += nodes[i].cycles;
+            if (i) {
+                inclusive[nodes[i].parent] += inclusive[i];
+            }
+        }
+        return inclusive;
+    }
+
+public:
+    uint64_t cycles() const { return total_cycles; }
+    uint64_t instructions() const { return total_instructions; }
+
+    // One retired instruction; cycle is the clock cycle it retires in
+    void retire(uint64_t cycle, uint32_t pc, uint32_t insn, bool trap,
+                bool interrupt)
+    {
+        if (nodes.empty()) {
+            Node root;
+            root.entry = pc;
+            root.parent = 0;
+            root.depth = 0;
+            root.calls = 1;
+            nodes.push_back(std::move(root));
+        } else if (interrupt) {
+            // A call interrupted before its target retired resumes after mret
+            nodes[current].resume_call = pending_call;
+            pending_call = false;
+            descend(pc);
+        } else if (pending_call) {
+            pending_call = false;
+            descend(pc);
+        }
+
+        uint64_t spent = cycle + 1 - last_cycle;
+        last_cycle = cycle + 1;
+        total_cycles += spent;
+        ++total_instructions;
+        Node &node = nodes[current];
+        node.cycles += spent;
+        ++node.instructions;
+        PcCost &cost = pcs[pc];
+        cost.cycles += spent;
+        ++cost.count;
+        cost.instruction = insn;
+
+        uint32_t opcode = insn & 0x7F;
+        uint32_t rd = (insn >> 7) & 0x1F;
+        uint32_t rs1 = (insn >> 15) & 0x1F;
+        if (trap) {
+            pending_call = true;
+        } else if (insn == 0x30200073) {  // mret
+            ascend();
+            pending_call = nodes[current].resume_call;
+            nodes[current].resume_call = false;
+        } else if (opcode == 0x6F && is_link(rd)) {  // jal
+            pending_call = true;
+        } else if (opcode == 0x67) {  // jalr
+            if (is_link(rd)) {
+                pending_call = true;
+            } else if (rd == 0 && is_link(rs1) && (insn >> 20) == 0) {
+                ascend();
+            }
+        }
+    }
+
+    // Sample a Verilated top's io_retire_* port; call just before the rising
+    // edge of every cycle
+    template <typename Top>
+    void sample(uint64_t cycle, Top const &top)
+    {
+        if (top.io_retire_valid) {
+            retire(cycle, top.io_retire_pc, top.io_retire_instruction,
+                   top.io_retire_trap, top.io_retire_interrupt);
+        }
+    }
+
+    void write(std::string const &filename, ElfSymbols const *elf) const
+    {
+        std::FILE *out = std::fopen(filename.c_str(), "w");
+        if (!out) {
+            throw std::runtime_error("Could not open profile " + filename);
+        }
+        auto name_of = [elf](uint32_t pc) {
+            if (elf) {
+                return elf->function_name(pc);
+            }
+            char text[16];
+            std::snprintf(text, sizeof(text), "0x%08x", pc);
+            return std::string(text);
+        };
+        auto percent = [this](uint64_t n) {
+            return total_cycles ? 100.0 * n / total_cycles : 0.0;
+        };
+
+        std::fprintf(out, "%lu cycles, %lu instructions",
+                     (unsigned long) total_cycles,
+                     (unsigned long) total_instructions);
+        if (total_instructions) {
+            std::fprintf(out, ", CPI %.3f",
+                         double(total_cycles) / total_instructions);
+        }
+        std::fprintf(out, "\n");
+
+        // Flat profile: self cycles of every function, by symbol when there
+        // is an ELF, else by the entry address of the call that ran the code
+        struct Flat
+        {
+            uint64_t cycles = 0;
+            uint64_t instructions = 0;
+        };
+        std::map<std::string, Flat> flat;
+        std::map<std::string, Flat> lines;
+        if (elf) {
+            for (auto const &[pc, cost] : pcs) {
+                Flat &f = flat[name_of(pc)];
+                f.cycles += cost.cycles;
+                f.instructions += cost.count;
+                std::string location = elf->location(pc);
+                if (!location.empty()) {
+                    Flat &l = lines[location];
+                    l.cycles += cost.cycles;
+                    l.instructions += cost.count;
+                }
+            }
+        } else {
+            for (auto const &node : nodes) {
+                Flat &f = flat[name_of(node.entry)];
+                f.cycles += node.cycles;
+                f.instructions += node.instructions;
+            }
+        }
+        auto by_cycles = [](auto const &a, auto const &b) {
+            return a.second.cycles > b.second.cycles;
+        };
+        std::vector<std::pair<std::string, Flat>> ranked(flat.begin(),
+                                                         flat.end());
+        std::stable_sort(ranked.begin(), ranked.end(), by_cycles);
+        std::fprintf(out, "\nFlat profile:\n%12s %7s %7s %12s %6s  %s\n",
+                     "self cycles", "%", "cumul%", "instructions", "CPI",
+                     "function");
+        double cumulative = 0;
+        for (auto const &[name, f] : ranked) {
+            cumulative += percent(f.cycles);
+            std::fprintf(out, "%12lu %6.2f%% %6.2f%% %12lu %6.2f  %s\n",
+                         (unsigned long) f.cycles, percent(f.cycles),
+                         cumulative, (unsigned long) f.instructions,
+                         f.instructions ? double(f.cycles) / f.instructions
+                                        : 0.0,
+                         name.c_str());
+        }
+
+        // Call graph: inclusive cycles per function (a recursive call is
+        // counted once, at its outermost frame) and per caller/callee edge
+        std::vector<uint64_t> inclusive = inclusive_cycles();
+        struct Edge
+        {
+            uint64_t calls = 0;
+            uint64_t cycles = 0;
+        };
+        struct Function
+        {
+            uint64_t self = 0;
+            uint64_t inclusive = 0;
+            uint64_t calls = 0;
+            std::map<std::string, Edge> callers;
+            std::map<std::string, Edge> callees;
+        };
+        std::map<std::string, Function> functions;
+        std::vector<std::string> names(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            names[i] = name_of(nodes[i].entry);
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            Function &f = functions[names[i]];
+            f.self += nodes[i].cycles;
+            f.calls += nodes[i].calls;
+            bool outermost = true;
+            for (size_t a = i; a;) {
+                a = nodes[a].parent;
+                if (names[a] == names[i]) {
+                    outermost = false;
+                    break;
+                }
+            }
+            if (outermost) {
+                f.inclusive += inclusive[i];
+            }
+            if (i) {
+                std::string const &caller = names[nodes[i].parent];
+                Edge &in = f.callers[caller];
+                in.calls += nodes[i].calls;
+                in.cycles += inclusive[i];
+                Edge &out = functions[caller].callees[names[i]];
+                out.calls += nodes[i].calls;
+                out.cycles += inclusive[i];
+            }
+        }
+        std::vector<std::pair<std::string, Function const *>> graph;
+        for (auto const &[name, f] : functions) {
+            graph.emplace_back(name, &f);
+        }
+        std::stable_sort(graph.begin(), graph.end(),
+                         [](auto const &a, auto const &b) {
+                             return a.second->inclusive > b.second->inclusive;
+                         });
+        std::fprintf(out,
+                     "\nCall graph (callers above, callees below each "
+                     "function; cycles are inclusive):\n");
+        for (auto const &[name, f] : graph) {
+            std::fprintf(out, "\n");
+            for (auto const &[caller, edge] : f->callers) {
+                std::fprintf(out, "    %12lu %8lu calls  from %s\n",
+                             (unsigned long) edge.cycles,
+                             (unsigned long) edge.calls, caller.c_str());
+            }
+            std::fprintf(out, "%12lu %6.2f%% %8lu calls  %s (self %lu)\n",
+                         (unsigned long) f->inclusive, percent(f->inclusive),
+                         (unsigned long) f->calls, name.c_str(),
+                         (unsigned long) f->self);
+            for (auto const &[callee, edge] : f->callees) {
+                std::fprintf(out, "    %12lu %8lu calls  to %s\n",
+                             (unsigned long) edge.cycles,
+                             (unsigned long) edge.calls, callee.c_str());
+            }
+        }
+
+        if (!lines.empty()) {
+            std::vector<std::pair<std::string, Flat>> hot(lines.begin(),
+                                                          lines.end());
+            std::stable_sort(hot.begin(), hot.end(), by_cycles);
+            if (hot.size() > 30) {
+                hot.resize(30);
+            }
+            std::fprintf(out, "\nHottest source lines:\n");
+            for (auto const &[location, l] : hot) {
+                std::fprintf(out, "%12lu %6.2f%% %12lu  %s\n",
+                             (unsigned long) l.cycles, percent(l.cycles),
+                             (unsigned long) l.instructions,
+                             location.c_str());
+            }
+        }
+
+        std::vector<std::pair<uint32_t, PcCost>> hot_pcs(pcs.begin(),
+                                                         pcs.end());
+        std::sort(hot_pcs.begin(), hot_pcs.end(),
+                  [](auto const &a, auto const &b) {
+                      return a.second.cycles != b.second.cycles
+                                 ? a.second.cycles > b.second.cycles
+                                 : a.first < b.first;
+                  });
+        if (hot_pcs.size() > 30) {
+            hot_pcs.resize(30);
+        }
+        std::fprintf(out, "\nHottest instructions:\n");
+        for (auto const &[pc, cost] : hot_pcs) {
+            std::string where = name_of(pc);
+            if (elf && !elf->location(pc).empty()) {
+                where += " " + elf->location(pc);
+            }
+            std::fprintf(out, "%12lu %6.2f%% %10lu  %08x  %-28s %s\n",
+                         (unsigned long) cost.cycles, percent(cost.cycles),
+                         (unsigned long) cost.count, pc,
+                         disassemble(cost.instruction, pc).c_str(),
+                         where.c_str());
+        }
+        std::fclose(out);
+
+        // Folded stacks: one line per call path with its self cycles
+        std::ofstream folded(filename + ".folded");
+        std::vector<std::string> paths(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            paths[i] = i ? paths[nodes[i].parent] + ";" + names[i] : names[i];
+            if (nodes[i].cycles) {
+                folded << paths[i] << ' ' << nodes[i].cycles << '\n';
+            }
+        }
+    }
+};
+
+}  // namespace rv32
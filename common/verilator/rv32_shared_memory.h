@@ -0,0 +1,218 @@
+// Guest memory that other processes can map while the simulation runs.
+//
+// The harness's Memory keeps its words here. By default this is private
+// anonymous memory; with a name it is a POSIX shared-memory object
+// (/dev/shm/NAME) or, for "memfd:NAME", a memfd that other processes open
+// through /proc/PID/fd/FD. Without memfd_create (anything but Linux),
+// "memfd:NAME" is a temporary file $TMPDIR/NAME.XXXXXX removed on exit, and
+// the POSIX object is reported by its name since there is no /dev/shm to
+// open it through. Either way the mapping starts with one page of
+// header, followed by the guest words (guest byte address A is at offset
+// header_bytes + A). Little-endian header, see scripts/guestmem.py:
+//
+//     0   char[4] "RVSM"         4   u32 version
+//     8   u32 header_bytes       12  u32 pid of the simulator
+//     16  u64 memory_bytes       24  u64 cycle, updated every rising edge
+//     32  u64 instret            40  u32 status, SHM_* below
+//     44  u32 pause_request      48  u64 pause_at_cycle
+//
+// A tool that wants to change memory between two cycles (feed an input
+// buffer, flip a flag the guest polls) sets pause_request, waits for status
+// SHM_PAUSED, writes, and clears pause_request again. pause_at_cycle, when
+// non-zero, makes the simulator raise pause_request itself on that cycle,
+// so a tool can step the guest. Shared fields are accessed atomically.
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+namespace rv32
+{
+
+constexpr char SHM_MAGIC[4] = {'R', 'V', 'S', 'M'};
+constexpr uint32_t SHM_VERSION = 1;
+constexpr size_t SHM_HEADER_BYTES = 4096;
+
+enum ShmStatus : uint32_t {
+    SHM_LOADING = 0,  // before the core starts (loading, -ff)
+    SHM_RUNNING = 1,
+    SHM_PAUSED = 2,   // waiting for pause_request to clear
+    SHM_HALTED = 3,   // the guest wrote the -halt marker
+    SHM_EXITED = 4,   // time limit, $finish or an error stopped the run
+};
+
+struct ShmHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint32_t pid;
+    uint64_t memory_bytes;
+    uint64_t cycle;
+    uint64_t instret;
+    uint32_t status;
+    uint32_t pause_request;
+    uint64_t pause_at_cycle;
+};
+static_assert(sizeof(ShmHeader) == 56, "header layout is shared with tools");
+
+class SharedMemory
+{
+    void *base = MAP_FAILED;
+    size_t mapped_bytes = 0;
+    size_t words;
+    ShmHeader *header_;
+    uint32_t *memory;
+    std::string shm_name;   // POSIX object to unlink on exit
+    std::string file_name;  // memfd stand-in to unlink on exit
+    int fd = -1;
+    std::string path_;
+
+    static std::runtime_error error(std::string const &what)
+    {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    void unlink_names()
+    {
+        if (!shm_name.empty()) {
+            shm_unlink(shm_name.c_str());
+        }
+        if (!file_name.empty()) {
+            unlink(file_name.c_str());
+        }
+    }
+
+public:
+    // Private zero-filled memory, or shared as described above when name is
+    // not empty
+    explicit SharedMemory(size_t words, std::string const &name = "")
+        : mapped_bytes(SHM_HEADER_BYTES + words * 4), words(words)
+    {
+        if (name.empty()) {
+            base = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        } else {
+            if (name.compare(0, 6, "memfd:") == 0) {
+#ifdef __linux__
+                fd = memfd_create(name.substr(6).c_str(), 0);
+                if (fd < 0) {
+                    throw error("memfd_create " + name);
+                }
+                path_ = "/proc/" + std::to_string(getpid()) + "/fd/" +
+                        std::to_string(fd);
+#else
+                char const *tmpdir = std::getenv("TMPDIR");
+                std::string pattern = std::string(tmpdir && *tmpdir ? tmpdir
+                                                                    : "/tmp") +
+                                      "/" + name.substr(6) + ".XXXXXX";
+                fd = mkstemp(&pattern[0]);
+                if (fd < 0) {
+                    throw error("mkstemp " + pattern);
+                }
+                file_name = path_ = pattern;
+#endif
+            } else {
+                shm_name = name[0] == '/' ? name : "/" + name;
+                fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                              0600);
+                if (fd < 0) {
+                    throw error("shm_open " + shm_name);
+                }
+#ifdef __linux__
+                path_ = "/dev/shm" + shm_name;
+#else
+                path_ = shm_name;
+#endif
+            }
+            if (ftruncate(fd, mapped_bytes) != 0) {
+                int saved = errno;
+                close(fd);
+                unlink_names();
+                errno = saved;
+                throw error("Could not size shared memory " + path_);
+            }
+            base = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+        }
+        if (base == MAP_FAILED) {
+            int saved = errno;
+            if (fd >= 0) {
+                close(fd);
+            }
+            unlink_names();
+            errno = saved;
+            throw error("Could not map guest memory");
+        }
+        header_ = static_cast<ShmHeader *>(base);
+        memory = reinterpret_cast<uint32_t *>(static_cast<char *>(base) +
+                                              SHM_HEADER_BYTES);
+        std::memcpy(header_->magic, SHM_MAGIC, 4);
+        header_->version = SHM_VERSION;
+        header_->header_bytes = SHM_HEADER_BYTES;
+        header_->pid = getpid();
+        header_->memory_bytes = uint64_t(words) * 4;
+    }
+
+    SharedMemory(SharedMemory const &) = delete;
+    SharedMemory &operator=(SharedMemory const &) = delete;
+
+    ~SharedMemory()
+    {
+        // Tools that still have it mapped keep reading the final state
+        munmap(base, mapped_bytes);
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink_names();
+    }
+
+    // Path other processes open, empty for private memory
+    std::string const &path() const { return path_; }
+    bool shared() const { return fd >= 0; }
+
+    size_t size() const { return words; }
+    uint32_t &operator[](size_t index) { return memory[index]; }
+    uint32_t const &operator[](size_t index) const { return memory[index]; }
+
+    void set_status(ShmStatus status)
+    {
+        __atomic_store_n(&header_->status, uint32_t(status), __ATOMIC_RELEASE);
+    }
+
+    // Publish the cycle count and honour pause requests; call once per cycle
+    // at the rising edge, with the Verilated top for its retirement port
+    template <typename Top>
+    void sample(uint64_t cycle, Top const &top)
+    {
+        if (top.io_retire_valid) {
+            __atomic_store_n(&header_->instret, header_->instret + 1,
+                             __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&header_->cycle, cycle, __ATOMIC_RELEASE);
+        uint64_t pause_at =
+            __atomic_load_n(&header_->pause_at_cycle, __ATOMIC_RELAXED);
+        if (pause_at && pause_at == cycle) {
+            __atomic_store_n(&header_->pause_request, 1u, __ATOMIC_RELEASE);
+        }
+        if (__atomic_load_n(&header_->pause_request, __ATOMIC_ACQUIRE)) {
+            set_status(SHM_PAUSED);
+            while (__atomic_load_n(&header_->pause_request, __ATOMIC_ACQUIRE)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            set_status(SHM_RUNNING);
+        }
+    }
+};
+
+}  // namespace rv32
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""
+Decode the binary commit log written by `VTop -commit-log <file>`.
+
+The format is described in common/verilator/rv32_commit_log.h: one record per
+retired instruction with a flags byte, LEB128 varints, PCs and data addresses
+delta-encoded, and each instruction word stored only the first time its PC
+retires (or when it changed).
+
+--format text (default) prints one line per instruction:
+
+    <cycle> <pc> (<instruction>) [x<rd> <value>] [load <addr> <data>]
+            [store <addr> <data> mask <strobe>] [trap] [interrupt]
+
+--format spike prints Spike's --log-commits layout, so a run can be diffed
+against `spike --log-commits` (machine mode, RV32):
+
+    core   0: 3 0x00001000 (0x00000297) x5  0x00001000
+    core   0: 3 0x00001004 (0x00812023) mem 0x00002000 0x00000000
+
+Store data is shifted down to the stored bytes as Spike shows it. ecall and
+ebreak get Spike's exception line instead of a commit line; interrupt entry
+has no Spike counterpart and is only marked in text output.
+
+Usage:
+    python3 scripts/commitlog.py commit.log
+    python3 scripts/commitlog.py --format spike commit.log -o commit.spike
+"""
+
+import argparse
+import struct
+import sys
+from typing import BinaryIO, Iterator, NamedTuple, Optional
+
+MAGIC = b'RVCL'
+VERSION = 1
+
+RD = 1 << 0
+LOAD = 1 << 1
+STORE = 1 << 2
+TRAP = 1 << 3
+INTERRUPT = 1 << 4
+JUMP = 1 << 5
+NEW_INSN = 1 << 6
+
+ECALL = 0x00000073
+EBREAK = 0x00100073
+
+
+class Commit(NamedTuple):
+    cycle: int
+    pc: int
+    instruction: int
+    rd: int                 # 0: no register written
+    rd_data: int
+    address: Optional[int]  # data access, if any
+    load_data: Optional[int]
+    strobe: int             # byte lanes written, 0: no store
+    store_data: int
+    trap: bool
+    interrupt: bool
+
+
+class Reader:
+    def __init__(self, f: BinaryIO):
+        self.data = f.read()
+        self.pos = 0
+        if self.data[:4] != MAGIC:
+            raise ValueError('not a commit log (bad magic)')
+        if self.data[4] != VERSION:
+            raise ValueError(f'unsupported commit log version {self.data[4]}')
+        self.pos = 8
+
+    def byte(self) -> int:
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def varint(self) -> int:
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            shift += 7
+            if b < 0x80:
+                return value
+
+    def zigzag(self) -> int:
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def u32(self) -> int:
+        (value,) = struct.unpack_from('<I', self.data, self.pos)
+        self.pos += 4
+        return value
+
+    def __iter__(self) -> Iterator[Commit]:
+        instructions = {}
+        cycle = 0
+        next_pc = 0
+        address = 0
+        while self.pos < len(self.data):
+            flags = self.byte()
+            cycle += self.varint()
+            pc = next_pc
+            if flags & JUMP:
+                pc = (next_pc + self.zigzag()) & 0xFFFFFFFF
+            if flags & NEW_INSN:
+                instructions[pc] = self.u32()
+            if pc not in instructions:
+                raise ValueError(f'record at byte {self.pos}: no instruction '
+                                 f'for pc 0x{pc:08x}')
+            rd = rd_data = 0
+            if flags & RD:
+                rd = self.byte()
+                rd_data = self.varint()
+            record_address = load_data = None
+            if flags & (LOAD | STORE):
+                address = (address + self.zigzag()) & 0xFFFFFFFF
+                record_address = address
+            if flags & LOAD:
+                load_data = self.varint()
+            strobe = store_data = 0
+            if flags & STORE:
+                strobe = self.byte()
+                store_data = self.varint()
+            yield Commit(cycle, pc, instructions[pc], rd, rd_data,
+                         record_address, load_data, strobe, store_data,
+                         bool(flags & TRAP), bool(flags & INTERRUPT))
+            next_pc = (pc + 4) & 0xFFFFFFFF
+
+
+def stored_bytes(c: Commit):
+    """Store data shifted down to its lowest written lane, and its width."""
+    lanes = [lane for lane in range(4) if c.strobe & (1 << lane)]
+    width = len(lanes)
+    value = (c.store_data >> (8 * lanes[0])) & ((1 << (8 * width)) - 1)
+    return value, width
+
+
+def format_text(c: Commit) -> str:
+    line = f'{c.cycle} 0x{c.pc:08x} (0x{c.instruction:08x})'
+    if c.rd:
+        line += f' x{c.rd} 0x{c.rd_data:08x}'
+    if c.load_data is not None:
+        line += f' load 0x{c.address:08x} 0x{c.load_data:08x}'
+    if c.strobe:
+        line += f' store 0x{c.address:08x} 0x{c.store_data:08x} mask 0x{c.strobe:x}'
+    if c.trap:
+        line += ' trap'
+    if c.interrupt:
+        line += ' interrupt'
+    return line
+
+
+def format_spike(c: Commit) -> str:
+    if c.trap:
+        cause = 'trap_breakpoint' if c.instruction == EBREAK else 'trap_machine_ecall'
+        return (f'core   0: exception {cause}, epc 0x{c.pc:08x}\n'
+                f'core   0:           tval 0x00000000')
+    line = f'core   0: 3 0x{c.pc:08x} (0x{c.instruction:08x})'
+    if c.rd:
+        line += f' x{c.rd:<2d} 0x{c.rd_data:08x}'
+    if c.load_data is not None:
+        line += f' mem 0x{c.address:08x}'
+    if c.strobe:
+        value, width = stored_bytes(c)
+        line += f' mem 0x{c.address:08x} 0x{value:0{2 * width}x}'
+    return line
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode a binary commit log',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument('log', help='file written by VTop -commit-log')
+    parser.add_argument('--format', choices=['text', 'spike'], default='text')
+    parser.add_argument('-o', '--output', help='output file (default: stdout)')
+    args = parser.parse_args()
+
+    formatter = format_spike if args.format == 'spike' else format_text
+    with open(args.log, 'rb') as f:
+        try:
+            reader = Reader(f)
+        except ValueError as e:
+            print(f'{args.log}: {e}', file=sys.stderr)
+            sys.exit(1)
+    out = open(args.output, 'w') if args.output else sys.stdout
+    try:
+        for commit in reader:
+            out.write(formatter(commit) + '\n')
+    except (ValueError, IndexError) as e:
+        print(f'{args.log}: truncated or corrupt log ({e})', file=sys.stderr)
+        sys.exit(1)
+    except BrokenPipeError:
+        pass
+    finally:
+        if out is not sys.stdout:
+            out.close()
+
+
+if __name__ == '__main__':
+    main()
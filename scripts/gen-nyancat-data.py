@@ -28,6 +28,18 @@ Delta encoding format (--delta mode):
     0x4Y = Repeat (Y+1)*16 changed pixels (16-256)
     0x5Y = Skip (Y+1)*64 unchanged pixels (64-1024)
     0xFF = EndOfFrame
+
+Word encoding format (--word mode), 32-bit commands over the 512 packed
+words (8 pixels each) of a frame:
+  [31:30]=0 Skip [12:0] unchanged words (VGA blitter SKIP)
+  [31:30]=1 Fill [12:0] words of color [19:16] (VGA blitter FILL)
+  [31:30]=2 Run: the next word, [12:0] times (STREAM_DATA)
+  [31:30]=3 Literal: the next [12:0] words (STREAM_DATA)
+  0x20000000 = Copy the previous frame first (VGA blitter COPY)
+  0x00000000 = EndOfFrame
+Skips need the Copy, which the guest waits for; frames where it does not pay
+off (and frame 0) are coded whole. The encoder picks the commands that
+minimise an estimated guest cycle cost (WORD_* below), not bytes.
 """
 
 import argparse
@@ -35,7 +47,21 @@ import re
 import sys
 import urllib.request
 from pathlib import Path
-from typing import List, Tuple
+from typing import List, Optional, Tuple
+
+# Cost weights for --word: estimated RV32I instruction counts of the decoder
+# steps in csrc/nyancat.c, not measurements. They only rank the encoder's
+# choices; measure real cycles per frame with -commit-log (see README)
+WORD_COMMAND_CYCLES = 8        # Load, decode and dispatch a word command
+WORD_BLIT_CYCLES = 6           # Skip/Fill: status poll and one VGA_BLIT store
+WORD_RUN_CYCLES = 2            # Run: load the word
+WORD_STORE_CYCLES = 3          # Run: one STREAM_DATA store per word
+WORD_LITERAL_CYCLES = 5        # Literal: load and store per word
+WORD_COPY_CYCLES = 2 * 512 + 16  # Copy: wait for the blitter COPY
+
+WORD_SKIP, WORD_FILL, WORD_RUN, WORD_LITERAL = range(4)
+WORD_MAX_COUNT = 0x1FFF
+WORD_COPY = 0x20000000
 
 
 def download_animation_data(url: str) -> str:
@@ -265,6 +291,188 @@ def compress_delta_frame(prev_pixels: List[str], curr_pixels: List[str]) -> List
     return opcodes
 
 
+def pack_frame_words(pixels: List[str]) -> List[int]:
+    """Pack a frame into 512 words of 8 pixels, pixel 0 in bits 3:0."""
+    colors = [map_color_to_palette(p) for p in pixels]
+    words = []
+    for i in range(0, 4096, 8):
+        word = 0
+        for j in range(8):
+            word |= colors[i + j] << (4 * j)
+        words.append(word)
+    return words
+
+
+def compress_frame_words(prev_words: Optional[List[int]], words: List[int]) -> List[int]:
+    """
+    Compress a packed frame into word commands (see the module docstring).
+
+    A dynamic program over the 512 words picks the command sequence with the
+    lowest estimated guest cost. Skips are only available with prev_words.
+    """
+    n = len(words)
+    best = [(0, 0, None)] + [None] * n  # best[j] = (cycles, start, command) covering words[:j]
+    for i in range(n):
+        base = best[i][0]
+
+        def offer(j, cycles, command):
+            if best[j] is None or base + cycles < best[j][0]:
+                best[j] = (base + cycles, i, command)
+
+        for j in range(i + 1, min(n, i + WORD_MAX_COUNT) + 1):
+            offer(j, WORD_COMMAND_CYCLES + WORD_LITERAL_CYCLES * (j - i), WORD_LITERAL)
+        j = i
+        while j < n and words[j] == words[i]:
+            j += 1
+            offer(j, WORD_COMMAND_CYCLES + WORD_RUN_CYCLES + WORD_STORE_CYCLES * (j - i), WORD_RUN)
+            if words[i] == (words[i] & 0xF) * 0x11111111:
+                offer(j, WORD_COMMAND_CYCLES + WORD_BLIT_CYCLES, WORD_FILL)
+        if prev_words is not None:
+            j = i
+            while j < n and words[j] == prev_words[j]:
+                j += 1
+                offer(j, WORD_COMMAND_CYCLES + WORD_BLIT_CYCLES, WORD_SKIP)
+
+    # Walk back from the end of the frame
+    segments = []
+    j = n
+    while j > 0:
+        _, i, command = best[j]
+        segments.append((i, j, command))
+        j = i
+
+    stream = [WORD_COPY] if prev_words is not None else []
+    for i, j, command in reversed(segments):
+        stream.append((command << 30) | (j - i))
+        if command == WORD_FILL:
+            stream[-1] |= (words[i] & 0xF) << 16
+        elif command == WORD_RUN:
+            stream.append(words[i])
+        elif command == WORD_LITERAL:
+            stream.extend(words[i:j])
+    stream.append(0)
+    return stream
+
+
+def decompress_words(prev_words: Optional[List[int]], stream: List[int]) -> List[int]:
+    """
+    Decode word commands the way vga_upload_frame_words() does.
+
+    Without a Copy the frame starts from garbage, so every word must be coded.
+    """
+    words = [0xDEADBEEF] * 512
+    pos = 0
+    i = 0
+    if stream[0] == WORD_COPY:
+        words = list(prev_words)
+        i = 1
+    while stream[i] != 0:
+        command, count = stream[i] >> 30, stream[i] & WORD_MAX_COUNT
+        i += 1
+        if command == WORD_FILL:
+            words[pos:pos + count] = [((stream[i - 1] >> 16) & 0xF) * 0x11111111] * count
+        elif command == WORD_RUN:
+            words[pos:pos + count] = [stream[i]] * count
+            i += 1
+        elif command == WORD_LITERAL:
+            words[pos:pos + count] = stream[i:i + count]
+            i += count
+        pos += count
+    return words[:512]
+
+
+def word_frame_cycles(stream: List[int]) -> int:
+    """Estimated guest cycles of vga_upload_frame_words() for one frame."""
+    cycles = 0
+    i = 0
+    if stream[0] == WORD_COPY:
+        cycles += WORD_COMMAND_CYCLES + WORD_BLIT_CYCLES + WORD_COPY_CYCLES
+        i = 1
+    while stream[i] != 0:
+        command, count = stream[i] >> 30, stream[i] & WORD_MAX_COUNT
+        i += 1
+        cycles += WORD_COMMAND_CYCLES
+        if command in (WORD_SKIP, WORD_FILL):
+            cycles += WORD_BLIT_CYCLES
+        elif command == WORD_RUN:
+            cycles += WORD_RUN_CYCLES + WORD_STORE_CYCLES * count
+            i += 1
+        else:
+            cycles += WORD_LITERAL_CYCLES * count
+            i += count
+    return cycles + WORD_COMMAND_CYCLES  # EndOfFrame
+
+
+def compress_words(frames: List[List[str]]) -> List[List[int]]:
+    """Word-compress all frames, against the one before where that is cheaper."""
+    packed = [pack_frame_words(frame) for frame in frames]
+    streams = []
+    for i, words in enumerate(packed):
+        candidates = [compress_frame_words(None, words)]
+        if i > 0:
+            candidates.append(compress_frame_words(packed[i - 1], words))
+        streams.append(min(candidates, key=word_frame_cycles))
+    return streams
+
+
+def generate_word_header(frames: List[List[str]], output_path: Path) -> None:
+    """Generate nyancat-data.h with word-encoded frame data."""
+    streams = compress_words(frames)
+    for i, stream in enumerate(streams):
+        kind = 'delta' if stream[0] == WORD_COPY else 'whole'
+        print(f"Frame {i:2d} ({kind}): 512 words → {len(stream)} words")
+
+    offsets = [0]
+    for stream in streams[:-1]:
+        offsets.append(offsets[-1] + len(stream))
+    all_data = [word for stream in streams for word in stream]
+    print(f"\nTotal: {12 * 512} words → {len(all_data)} words ({len(all_data) * 4} bytes)")
+
+    with open(output_path, 'w') as f:
+        f.write(f"""// SPDX-License-Identifier: MIT
+// Auto-generated nyancat animation data with word compression
+// DO NOT EDIT - Generated by scripts/gen-nyancat-data.py
+
+#ifndef NYANCAT_DATA_H
+#define NYANCAT_DATA_H
+
+#include <stdint.h>
+
+// Compression type: word
+#define NYANCAT_COMPRESSION_DELTA 0
+#define NYANCAT_COMPRESSION_WORD 1
+
+// Frame index into nyancat_word_data (12 frames)
+static const uint16_t nyancat_frame_offsets[12] = {{
+""")
+        for i in range(0, len(offsets), 6):
+            chunk = offsets[i:i+6]
+            f.write("    " + ", ".join(f"{offset:5d}" for offset in chunk))
+            if i + 6 < len(offsets):
+                f.write(",")
+            f.write("\n")
+
+        f.write("};\n\n")
+        f.write(f"// Word commands ({len(all_data)} words):\n")
+        f.write("//   [31:30]=0 Skip [12:0] words, 1 Fill [12:0] words of color [19:16],\n")
+        f.write("//   2 Run: next word [12:0] times, 3 Literal: next [12:0] words,\n")
+        f.write("//   0x20000000=Copy previous frame first, 0x00000000=EndOfFrame\n")
+        f.write(f"static const uint32_t nyancat_word_data[{len(all_data)}] = {{\n")
+
+        for i in range(0, len(all_data), 6):
+            chunk = all_data[i:i+6]
+            f.write("    " + ", ".join(f"0x{word:08x}" for word in chunk))
+            if i + 6 < len(all_data):
+                f.write(",")
+            f.write("\n")
+
+        f.write("};\n\n")
+        f.write("#endif // NYANCAT_DATA_H\n")
+
+    print(f"\nGenerated: {output_path}")
+    print(f"Header size: {output_path.stat().st_size} bytes")
+
+
 def generate_header(frames: List[List[str]], output_path: Path, use_delta: bool = False) -> None:
     """Generate nyancat-data.h with compressed frame data."""
 
@@ -319,6 +527,7 @@ def generate_header(frames: List[List[str]], output_path: Path, use_delta: bool
 
 // Compression type: {"delta" if use_delta else "baseline"}
 #define NYANCAT_COMPRESSION_DELTA {1 if use_delta else 0}
+#define NYANCAT_COMPRESSION_WORD 0
 
 // Frame offset table (12 frames)
 static const uint16_t nyancat_frame_offsets[12] = {{
@@ -365,7 +574,8 @@ static const uint16_t nyancat_frame_offsets[12] = {{
     print(f"Header size: {output_path.stat().st_size} bytes")
 
 
-def decompress_and_verify(frames: List[List[str]], use_delta: bool = False) -> bool:
+def decompress_and_verify(frames: List[List[str]], use_delta: bool = False,
+                          use_word: bool = False) -> bool:
     """
     Decompress compressed frames and verify against originals.
 
@@ -375,7 +585,19 @@ def decompress_and_verify(frames: List[List[str]], use_delta: bool = False) -> b
 
     all_match = True
 
-    if use_delta:
+    if use_word:
+        # Verify word compression, decoding each frame on top of the last
+        prev_words = None
+        for frame_idx, stream in enumerate(compress_words(frames)):
+            decoded = decompress_words(prev_words, stream)
+            mismatches = sum(1 for a, b in zip(pack_frame_words(frames[frame_idx]), decoded) if a != b)
+            if mismatches > 0:
+                print(f"Frame {frame_idx}: {mismatches} word mismatches")
+                all_match = False
+            else:
+                print(f"Frame {frame_idx}: ✓ Perfect match ({len(stream)} words)")
+            prev_words = decoded
+    elif use_delta:
         # Verify delta compression
         prev_frame = None
         for frame_idx, original_frame in enumerate(frames):
@@ -501,11 +723,17 @@ def main():
         default='https://raw.githubusercontent.com/klange/nyancat/master/src/animation.c',
         help='URL to animation.c (default: klange/nyancat master)'
     )
-    parser.add_argument(
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument(
         '--delta',
         action='store_true',
         help='Use delta frame compression (default: baseline RLE)'
     )
+    mode.add_argument(
+        '--word',
+        action='store_true',
+        help='Use word commands decoded straight to the VGA, for fewest guest cycles'
+    )
     parser.add_argument(
         '--verify',
         action='store_true',
@@ -525,17 +753,21 @@ def main():
 
     # Verify mode
     if args.verify:
-        success = decompress_and_verify(frames, args.delta)
+        success = decompress_and_verify(frames, args.delta, args.word)
         sys.exit(0 if success else 1)
 
     # Generate header
-    compression_mode = "delta-RLE" if args.delta else "opcode-RLE"
-    print(f"\nCompressing frames with {compression_mode}...")
-    generate_header(frames, args.output, args.delta)
+    if args.word:
+        print("\nCompressing frames with word commands...")
+        generate_word_header(frames, args.output)
+    else:
+        compression_mode = "delta-RLE" if args.delta else "opcode-RLE"
+        print(f"\nCompressing frames with {compression_mode}...")
+        generate_header(frames, args.output, args.delta)
 
     # Run verification
     print("\nVerifying compression...")
-    if decompress_and_verify(frames, args.delta):
+    if decompress_and_verify(frames, args.delta, args.word):
         print("\n✓ All frames verified successfully")
     else:
         print("\n✗ Verification failed")
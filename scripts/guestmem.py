@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""
+Inspect or poke the guest memory of a running `VTop -shm <name>`.
+
+The layout is described in common/verilator/rv32_shared_memory.h: one page of
+header (cycle count, retired instructions, run status, pause handshake)
+followed by the guest words, mapped here without copying. Pass the path the
+simulator prints (/dev/shm/NAME, or /proc/PID/fd/FD for memfd:NAME, or the
+temporary file memfd:NAME becomes outside Linux); a bare NAME means
+/dev/shm/NAME.
+
+    status              cycle, instret, status and memory size
+    read ADDR [WORDS]   hex words starting at ADDR
+    write ADDR WORD...  store words between two cycles (pauses the core)
+    watch [SECONDS]     print cycle and instruction rates until the run ends
+    step CYCLES         let the core run CYCLES more cycles, then pause it
+
+From Python, GuestMemory gives the same access, e.g. for a dashboard:
+
+    import guestmem
+    g = guestmem.GuestMemory('/dev/shm/sim')
+    with g.paused():
+        g.write(0x2000, b'input')
+
+Usage:
+    python3 scripts/guestmem.py sim status
+    python3 scripts/guestmem.py sim read 0x1000 16
+    python3 scripts/guestmem.py sim write 0x2000 0x1 0x2
+"""
+
+import argparse
+import contextlib
+import mmap
+import os
+import struct
+import sys
+import time
+
+MAGIC = b'RVSM'
+VERSION = 1
+
+CYCLE = 24
+INSTRET = 32
+STATUS = 40
+PAUSE_REQUEST = 44
+PAUSE_AT_CYCLE = 48
+
+STATUS_NAMES = ['loading', 'running', 'paused', 'halted', 'exited']
+RUNNING, PAUSED, HALTED, EXITED = 1, 2, 3, 4
+
+
+class GuestMemory:
+    def __init__(self, path: str):
+        if os.sep not in path:
+            path = os.path.join('/dev/shm', path)
+        with open(path, 'r+b') as f:
+            self.map = mmap.mmap(f.fileno(), 0)
+        magic, version, self.header_bytes, self.pid, self.memory_bytes = \
+            struct.unpack_from('<4sIIIQ', self.map)
+        if magic != MAGIC:
+            raise ValueError('not guest memory (bad magic)')
+        if version != VERSION:
+            raise ValueError(f'unsupported guest memory version {version}')
+        self.memory = memoryview(self.map)[self.header_bytes:]
+
+    def field(self, offset: int, fmt: str = '<Q') -> int:
+        return struct.unpack_from(fmt, self.map, offset)[0]
+
+    def set_field(self, offset: int, value: int, fmt: str = '<Q'):
+        struct.pack_into(fmt, self.map, offset, value)
+
+    @property
+    def cycle(self) -> int:
+        return self.field(CYCLE)
+
+    @property
+    def instret(self) -> int:
+        return self.field(INSTRET)
+
+    @property
+    def status(self) -> int:
+        return self.field(STATUS, '<I')
+
+    def status_name(self) -> str:
+        status = self.status
+        if status < len(STATUS_NAMES):
+            return STATUS_NAMES[status]
+        return f'unknown ({status})'
+
+    def read(self, address: int, size: int) -> bytes:
+        return bytes(self.memory[address:address + size])
+
+    def write(self, address: int, data: bytes):
+        self.memory[address:address + len(data)] = data
+
+    def read_words(self, address: int, count: int):
+        return struct.unpack_from(f'<{count}I', self.memory, address)
+
+    def wait(self, statuses, poll: float = 0.001) -> int:
+        while self.status not in statuses:
+            time.sleep(poll)
+        return self.status
+
+    @contextlib.contextmanager
+    def paused(self):
+        """Hold the core between two cycles; yields False if it has ended."""
+        self.set_field(PAUSE_REQUEST, 1, '<I')
+        try:
+            status = self.wait((PAUSED, HALTED, EXITED))
+            yield status == PAUSED
+        finally:
+            self.set_field(PAUSE_REQUEST, 0, '<I')
+
+    def step(self, cycles: int) -> int:
+        """Run the core until `cycles` more rising edges and pause it there."""
+        self.set_field(PAUSE_AT_CYCLE, self.cycle + cycles)
+        self.set_field(PAUSE_REQUEST, 0, '<I')
+        while True:
+            status = self.wait((PAUSED, HALTED, EXITED))
+            if status != PAUSED or self.cycle >= self.field(PAUSE_AT_CYCLE):
+                return status
+            time.sleep(0.001)
+
+
+def number(text: str) -> int:
+    return int(text, 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Inspect or poke the guest memory of a running simulation',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument('memory', help='shared memory path or /dev/shm name')
+    parser.add_argument('command',
+                        choices=['status', 'read', 'write', 'watch', 'step'])
+    parser.add_argument('args', nargs='*')
+    args = parser.parse_args()
+    try:
+        convert = float if args.command == 'watch' else number
+        values = [convert(a) for a in args.args]
+    except ValueError as e:
+        parser.error(str(e))
+
+    try:
+        g = GuestMemory(args.memory)
+    except (OSError, ValueError) as e:
+        print(f'{args.memory}: {e}', file=sys.stderr)
+        sys.exit(1)
+
+    if args.command == 'status':
+        print(f'pid {g.pid}, {g.status_name()}, cycle {g.cycle}, '
+              f'instret {g.instret}, {g.memory_bytes} bytes of memory')
+    elif args.command == 'read':
+        address = values[0] if values else 0
+        count = values[1] if len(values) > 1 else 1
+        if address % 4 or address + 4 * count > g.memory_bytes:
+            parser.error('read needs an aligned address within memory')
+        words = g.read_words(address, count)
+        for i in range(0, count, 4):
+            row = ' '.join(f'{word:08x}' for word in words[i:i + 4])
+            print(f'{address + 4 * i:08x}: {row}')
+    elif args.command == 'write':
+        if len(values) < 2:
+            parser.error('write needs an address and at least one word')
+        address, words = values[0], values[1:]
+        if address % 4 or address + 4 * len(words) > g.memory_bytes:
+            parser.error('write needs an aligned address within memory')
+        with g.paused() as running:
+            g.write(address, struct.pack(f'<{len(words)}I', *words))
+        print(f'wrote {len(words)} words at cycle {g.cycle}'
+              f'{"" if running else " (run had ended)"}')
+    elif args.command == 'watch':
+        interval = values[0] if values else 1
+        cycle, instret = g.cycle, g.instret
+        while g.status not in (HALTED, EXITED):
+            time.sleep(interval)
+            now_cycle, now_instret = g.cycle, g.instret
+            print(f'cycle {now_cycle}: '
+                  f'{(now_cycle - cycle) / interval:,.0f} cycles/s, '
+                  f'{(now_instret - instret) / interval:,.0f} instructions/s, '
+                  f'{g.status_name()}', flush=True)
+            cycle, instret = now_cycle, now_instret
+        print(f'{g.status_name()} at cycle {g.cycle}')
+    elif args.command == 'step':
+        if len(values) != 1:
+            parser.error('step needs a cycle count')
+        g.step(values[0])
+        print(f'{g.status_name()} at cycle {g.cycle}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""
+Read the columnar probe file written by `VTop -probe <file>`.
+
+The format is described in common/verilator/rv32_probe.h: a header naming
+each column and its width, then blocks in which every column is a contiguous
+little-endian array. Column 0 is the cycle of each sample.
+
+From Python, load() returns one array per signal in .data: NumPy arrays when
+NumPy is installed (each block is a zero-copy view of the file, joined once),
+otherwise array.array:
+
+    import probes
+    cols = probes.load('run.probe').data
+    writes = cols['io_memory_bundle_write_enable'].sum()
+
+From the shell, the default prints a summary per signal (samples, distinct
+values, minimum and maximum); --csv dumps the samples instead.
+
+Usage:
+    python3 scripts/probes.py run.probe
+    python3 scripts/probes.py --csv -s cycle,io_vga_x_pos run.probe -o x.csv
+"""
+
+import argparse
+import array
+import struct
+import sys
+from typing import Dict, List, NamedTuple
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+MAGIC = b'RVPR'
+VERSION = 1
+HEADER = struct.Struct('<4sHHIIQQ')
+COLUMN_BYTES = 64
+WIDTHS = (1, 2, 4, 8)
+
+
+class Column(NamedTuple):
+    name: str
+    width: int  # bytes per value
+
+
+class ProbeFile(NamedTuple):
+    interval: int
+    block_rows: int
+    columns: List[Column]
+    data: Dict[str, object]  # column name -> numpy array or array.array
+
+
+def padded(n: int) -> int:
+    return (n + 7) & ~7
+
+
+def typecode(width: int) -> str:
+    # array.array sizes are native; pick the code that has this width
+    return next(c for c in 'BHILQ' if array.array(c).itemsize == width)
+
+
+def load(path: str) -> ProbeFile:
+    with open(path, 'rb') as f:
+        raw = f.read()
+    if len(raw) < HEADER.size:
+        raise ValueError('not a probe file (too short)')
+    magic, version, count, block_rows, header_bytes, interval, _ = \
+        HEADER.unpack_from(raw)
+    if magic != MAGIC:
+        raise ValueError('not a probe file (bad magic)')
+    if version != VERSION:
+        raise ValueError(f'unsupported probe file version {version}')
+
+    columns = []
+    for i in range(count):
+        entry = raw[HEADER.size + i * COLUMN_BYTES:
+                    HEADER.size + (i + 1) * COLUMN_BYTES]
+        name = entry[1:].split(b'\0', 1)[0].decode()
+        if entry[0] not in WIDTHS:
+            raise ValueError(f'column {name}: bad width {entry[0]}')
+        columns.append(Column(name, entry[0]))
+
+    parts: Dict[str, list] = {c.name: [] for c in columns}
+    pos = header_bytes
+    while pos < len(raw):
+        if pos + 8 > len(raw):
+            raise ValueError(f'truncated block at byte {pos}')
+        rows = struct.unpack_from('<Q', raw, pos)[0]
+        pos += 8
+        for c in columns:
+            size = rows * c.width
+            if pos + size > len(raw):
+                raise ValueError(f'truncated column {c.name} at byte {pos}')
+            if numpy is not None:
+                parts[c.name].append(numpy.frombuffer(
+                    raw, dtype=f'<u{c.width}', count=rows, offset=pos))
+            else:
+                values = array.array(typecode(c.width))
+                values.frombytes(raw[pos:pos + size])
+                if sys.byteorder != 'little':
+                    values.byteswap()
+                parts[c.name].append(values)
+            pos += padded(size)
+
+    data: Dict[str, object] = {}
+    for c in columns:
+        if numpy is not None:
+            blocks = parts[c.name]
+            data[c.name] = (numpy.concatenate(blocks) if blocks else
+                            numpy.zeros(0, dtype=f'<u{c.width}'))
+        else:
+            values = array.array(typecode(c.width))
+            for block in parts[c.name]:
+                values.extend(block)
+            data[c.name] = values
+    return ProbeFile(interval, block_rows, columns, data)
+
+
+def summary(probe: ProbeFile, names: List[str], out):
+    cycles = probe.data['cycle']
+    samples = len(cycles)
+    span = f'cycles {cycles[0]}..{cycles[-1]}, ' if samples else ''
+    out.write(f'{samples} samples, {span}every {probe.interval} cycles\n')
+    width = max((len(n) for n in names), default=0)
+    for name in names:
+        values = probe.data[name]
+        if numpy is not None:
+            distinct = len(numpy.unique(values))
+        else:
+            distinct = len(set(values))
+        lo = min(values) if samples else 0
+        hi = max(values) if samples else 0
+        out.write(f'{name:<{width}}  {distinct:>8} distinct  '
+                  f'min 0x{lo:x}  max 0x{hi:x}\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Read a columnar probe file',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument('probe', help='file written by VTop -probe')
+    parser.add_argument('--csv', action='store_true',
+                        help='dump samples as CSV instead of a summary')
+    parser.add_argument('-s', '--signals',
+                        help='comma-separated columns (default: all)')
+    parser.add_argument('-o', '--output', help='output file (default: stdout)')
+    args = parser.parse_args()
+
+    try:
+        probe = load(args.probe)
+    except (OSError, ValueError) as e:
+        print(f'{args.probe}: {e}', file=sys.stderr)
+        sys.exit(1)
+    names = [c.name for c in probe.columns]
+    if args.signals:
+        wanted = args.signals.split(',')
+        unknown = [n for n in wanted if n not in probe.data]
+        if unknown:
+            print(f'{args.probe}: no column {", ".join(unknown)}',
+                  file=sys.stderr)
+            sys.exit(1)
+        names = wanted
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    try:
+        if args.csv:
+            out.write(','.join(names) + '\n')
+            columns = [probe.data[n] for n in names]
+            for row in zip(*columns):
+                out.write(','.join(str(int(v)) for v in row) + '\n')
+        else:
+            summary(probe, [n for n in names if n != 'cycle'], out)
+    except BrokenPipeError:
+        pass
+    finally:
+        if out is not sys.stdout:
+            out.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""
+SimPoint-style simulation point selection for the 3-pipeline simulator.
+
+Input is the basic-block vector file written by `VTop -bbv <file>`: one line
+per fixed-size instruction interval, in SimPoint's .bb format
+
+    T:<block>:<count> :<block>:<count> ...
+
+`select` normalises each vector, reduces it to --dim dimensions by random
+projection and runs k-means for k = 1..--max-k. As in SimPoint 3.0, it keeps
+the smallest k whose BIC score reaches --bic-threshold of the best
+score. Each cluster is represented by the interval closest to its centroid
+and weighted by the share of instructions its intervals executed. Results are
+written next to the input as <name>.simpoints ("<interval> <cluster>") and
+<name>.weights ("<weight> <cluster>"), and the simulator command for each
+point is printed:
+
+    VTop -ff <interval * size> -detail <size> ...
+
+-detail turns on the ISS checker, which counts instructions; the run ends with
+a "CPI <x>" line. `estimate` reads one such log per simulation point, in
+.simpoints order, and prints the weighted whole-program CPI.
+
+Usage:
+    python3 scripts/simpoint.py select simpoint.bb --interval 100000
+    python3 scripts/simpoint.py estimate simpoint.bb sp0.log sp1.log ...
+"""
+
+import argparse
+import math
+import random
+import re
+import sys
+from pathlib import Path
+from typing import Dict, List, Tuple
+
+Vector = List[float]
+
+
+def parse_bbv(path: Path) -> List[Dict[int, int]]:
+    """Read a .bb file into one {block: count} dict per interval."""
+    intervals = []
+    with open(path) as f:
+        for line in f:
+            if not line.startswith('T'):
+                continue
+            counts = {}
+            for field in line[1:].split():
+                _, block, count = field.split(':')
+                counts[int(block)] = int(count)
+            intervals.append(counts)
+    return intervals
+
+
+def project(intervals: List[Dict[int, int]], dim: int, seed: int) -> List[Vector]:
+    """Normalise each interval and project it to dim random dimensions."""
+    rng = random.Random(seed)
+    basis: Dict[int, Vector] = {}
+    points = []
+    for counts in intervals:
+        total = sum(counts.values())
+        point = [0.0] * dim
+        for block, count in counts.items():
+            if block not in basis:
+                basis[block] = [rng.uniform(-1.0, 1.0) for _ in range(dim)]
+            row = basis[block]
+            share = count / total
+            for d in range(dim):
+                point[d] += share * row[d]
+        points.append(point)
+    return points
+
+
+def distance2(a: Vector, b: Vector) -> float:
+    return sum((x - y) * (x - y) for x, y in zip(a, b))
+
+
+def kmeans(points: List[Vector], k: int, rng: random.Random,
+           iterations: int = 100) -> Tuple[List[int], List[Vector], float]:
+    """k-means with k-means++ seeding; returns labels, centroids, SSE."""
+    centroids = [list(rng.choice(points))]
+    while len(centroids) < k:
+        weights = [min(distance2(p, c) for c in centroids) for p in points]
+        if sum(weights) == 0:
+            break
+        centroids.append(list(rng.choices(points, weights)[0]))
+
+    labels = [0] * len(points)
+    for iteration in range(iterations):
+        changed = False
+        for i, p in enumerate(points):
+            best = min(range(len(centroids)), key=lambda c: distance2(p, centroids[c]))
+            if best != labels[i]:
+                labels[i] = best
+                changed = True
+        for c in range(len(centroids)):
+            members = [p for p, label in zip(points, labels) if label == c]
+            if members:
+                centroids[c] = [sum(x) / len(members) for x in zip(*members)]
+        if not changed and iteration > 0:
+            break
+
+    sse = sum(distance2(p, centroids[label]) for p, label in zip(points, labels))
+    return labels, centroids, sse
+
+
+def bic(points: List[Vector], labels: List[int], k: int, sse: float) -> float:
+    """Bayesian information criterion of a clustering (Pelleg and Moore)."""
+    r = len(points)
+    d = len(points[0])
+    if r <= k:
+        return -math.inf
+    variance = max(sse / (r - k), 1e-12)
+    likelihood = 0.0
+    for c in range(k):
+        rn = labels.count(c)
+        if rn == 0:
+            continue
+        likelihood += (-rn / 2 * math.log(2 * math.pi)
+                       - rn * d / 2 * math.log(variance)
+                       - (rn - k) / 2
+                       + rn * math.log(rn) - rn * math.log(r))
+    parameters = (k - 1) + k * d + 1
+    return likelihood - parameters / 2 * math.log(r)
+
+
+def cluster(points: List[Vector], max_k: int, seeds: int, threshold: float,
+            seed: int) -> Tuple[List[int], List[Vector]]:
+    """Pick the smallest k whose BIC reaches threshold of the best."""
+    rng = random.Random(seed)
+    results = []
+    for k in range(1, min(max_k, len(points)) + 1):
+        best = None
+        for _ in range(seeds):
+            labels, centroids, sse = kmeans(points, k, rng)
+            if best is None or sse < best[2]:
+                best = (labels, centroids, sse)
+        labels, centroids, sse = best
+        results.append((k, labels, centroids, bic(points, labels, k, sse)))
+
+    scores = [score for _, _, _, score in results if score != -math.inf]
+    if not scores:
+        return results[0][1], results[0][2]
+    low, high = min(scores), max(scores)
+    for k, labels, centroids, score in results:
+        if high == low or score >= low + threshold * (high - low):
+            return labels, centroids
+    return results[-1][1], results[-1][2]
+
+
+def select(args) -> int:
+    intervals = parse_bbv(args.bbv)
+    if not intervals:
+        print(f'{args.bbv}: no intervals', file=sys.stderr)
+        return 1
+    points = project(intervals, args.dim, args.seed)
+    labels, centroids = cluster(points, args.max_k, args.seeds,
+                                args.bic_threshold, args.seed)
+
+    sizes = [sum(counts.values()) for counts in intervals]
+    total = sum(sizes)
+    chosen = []
+    for c, centroid in enumerate(centroids):
+        members = [i for i, label in enumerate(labels) if label == c]
+        if not members:
+            continue
+        representative = min(members, key=lambda i: distance2(points[i], centroid))
+        weight = sum(sizes[i] for i in members) / total
+        chosen.append((representative, weight, len(members)))
+    chosen.sort()
+
+    simpoints = args.bbv.with_suffix('.simpoints')
+    weights = args.bbv.with_suffix('.weights')
+    with open(simpoints, 'w') as sp, open(weights, 'w') as wt:
+        for c, (interval, weight, _) in enumerate(chosen):
+            sp.write(f'{interval} {c}\n')
+            wt.write(f'{weight:.6f} {c}\n')
+
+    print(f'{len(intervals)} intervals, {total} instructions, '
+          f'{len(chosen)} simulation points')
+    print(f'{"point":>5} {"interval":>8} {"weight":>8} {"members":>8}  command')
+    for c, (interval, weight, members) in enumerate(chosen):
+        print(f'{c:>5} {interval:>8} {weight:>8.4f} {members:>8}  '
+              f'-ff {interval * args.interval} -detail {args.interval}')
+    print(f'Wrote {simpoints} and {weights}')
+    return 0
+
+
+def estimate(args) -> int:
+    simpoints = args.bbv.with_suffix('.simpoints')
+    weights = args.bbv.with_suffix('.weights')
+    points = [line.split() for line in open(simpoints) if line.strip()]
+    weight_of = {int(c): float(w) for w, c in
+                 (line.split() for line in open(weights) if line.strip())}
+    if len(args.logs) != len(points):
+        print(f'Expected {len(points)} logs (one per line of {simpoints}), '
+              f'got {len(args.logs)}', file=sys.stderr)
+        return 1
+
+    cpi = 0.0
+    for (interval, c), log in zip(points, args.logs):
+        match = re.findall(r'CPI ([0-9.eE+-]+)', Path(log).read_text())
+        if not match:
+            print(f'{log}: no "CPI" line (run with -detail)', file=sys.stderr)
+            return 1
+        point_cpi = float(match[-1])
+        print(f'point {c} (interval {interval}): CPI {point_cpi:.4f} '
+              f'weight {weight_of[int(c)]:.4f}')
+        cpi += weight_of[int(c)] * point_cpi
+    print(f'Estimated CPI: {cpi:.4f}')
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='SimPoint-style simulation point selection',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    p = commands.add_parser('select', help='cluster intervals and pick points')
+    p.add_argument('bbv', type=Path, help='.bb file written by VTop -bbv')
+    p.add_argument('--interval', type=int, default=100000,
+                   help='instructions per interval, as passed to -bbv-interval')
+    p.add_argument('--max-k', type=int, default=10, help='largest cluster count tried')
+    p.add_argument('--dim', type=int, default=15, help='random projection dimensions')
+    p.add_argument('--seeds', type=int, default=5, help='k-means restarts per k')
+    p.add_argument('--bic-threshold', type=float, default=0.9,
+                   help='fraction of the BIC range the chosen k must reach')
+    p.add_argument('--seed', type=int, default=1, help='random seed')
+    p.set_defaults(func=select)
+
+    p = commands.add_parser('estimate', help='weighted CPI from per-point runs')
+    p.add_argument('bbv', type=Path, help='.bb file the points were selected from')
+    p.add_argument('logs', nargs='+', help='simulator output, one per point')
+    p.set_defaults(func=estimate)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,422 @@
+// cachesim: replay memory traces (-mem-trace) against cache configurations.
+//
+// Every trace is replayed once, and every configuration given on the command
+// line sees it at the same time: -icache configurations the fetch stream,
+// -dcache configurations the loads and stores. A configuration is
+//
+//     SIZE:WAYS:LINE[:REPLACEMENT[:WRITE]]
+//
+// SIZE and LINE in bytes (k/K suffix allowed), WAYS 1 for direct mapped;
+// REPLACEMENT lru (default), fifo or random; WRITE wb (default; write-back
+// with write-allocate) or wt (write-through without write-allocate, stores
+// drain through a write buffer and never stall).
+//
+// The latency model charges -miss-penalty cycles per line fill, and
+// -writeback-penalty more when the fill evicts a dirty line; hits cost
+// -hit-latency extra cycles, 0 for the single-cycle memories of our cores.
+// The trace's own cycles per instruction is the base; each cache adds its
+// stall cycles per instruction to it, the other side being a perfect cache.
+// Accesses at or above -uncached (devices, 0x20000000 by default) bypass
+// the data caches.
+//
+// Output is a table per trace, or one CSV line per trace and configuration
+// with -csv.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../common/verilator/rv32_mem_trace.h"
+#include "mapped_file.h"
+
+namespace
+{
+
+enum Replacement { REPLACE_LRU, REPLACE_FIFO, REPLACE_RANDOM };
+
+struct CacheConfig
+{
+    std::string text;
+    uint32_t size;
+    uint32_t ways;
+    uint32_t line;
+    Replacement replacement = REPLACE_LRU;
+    bool write_back = true;
+};
+
+struct Latency
+{
+    uint64_t hit = 0;
+    uint64_t miss = 20;
+    uint64_t writeback = 20;
+};
+
+uint32_t parse_size(std::string const &text)
+{
+    size_t used = 0;
+    uint64_t value = std::stoull(text, &used, 0);
+    if (used < text.size() && (text[used] == 'k' || text[used] == 'K')) {
+        value <<= 10;
+        ++used;
+    }
+    if (used != text.size() || value == 0 || value > (1u << 30)) {
+        throw std::runtime_error("bad size '" + text + "'");
+    }
+    return value;
+}
+
+bool power_of_two(uint32_t n) { return n && !(n & (n - 1)); }
+
+CacheConfig parse_config(std::string const &text)
+{
+    std::vector<std::string> fields;
+    for (size_t start = 0;;) {
+        size_t colon = text.find(':', start);
+        fields.push_back(text.substr(start, colon - start));
+        if (colon == std::string::npos) {
+            break;
+        }
+        start = colon + 1;
+    }
+    if (fields.size() < 3 || fields.size() > 5) {
+        throw std::runtime_error("cache '" + text +
+                                 "': expected SIZE:WAYS:LINE[:REPL[:WRITE]]");
+    }
+    CacheConfig c;
+    c.text = text;
+    c.size = parse_size(fields[0]);
+    c.ways = parse_size(fields[1]);
+    c.line = parse_size(fields[2]);
+    if (fields.size() > 3) {
+        if (fields[3] == "lru") {
+            c.replacement = REPLACE_LRU;
+        } else if (fields[3] == "fifo") {
+            c.replacement = REPLACE_FIFO;
+        } else if (fields[3] == "random") {
+            c.replacement = REPLACE_RANDOM;
+        } else {
+            throw std::runtime_error("cache '" + text +
+                                     "': replacement is lru, fifo or random");
+        }
+    }
+    if (fields.size() > 4) {
+        if (fields[4] == "wb") {
+            c.write_back = true;
+        } else if (fields[4] == "wt") {
+            c.write_back = false;
+        } else {
+            throw std::runtime_error("cache '" + text +
+                                     "': write policy is wb or wt");
+        }
+    }
+    if (!power_of_two(c.line) || c.line < 4 ||
+        c.size % (c.ways * c.line) != 0 ||
+        !power_of_two(c.size / (c.ways * c.line))) {
+        throw std::runtime_error("cache '" + text +
+                                 "': line and set count must be powers of 2");
+    }
+    return c;
+}
+
+// One set-associative cache with its statistics
+class Cache
+{
+    struct Line
+    {
+        uint32_t tag;
+        bool valid;
+        bool dirty;
+        uint64_t stamp;  // last use (LRU) or fill (FIFO)
+    };
+
+    CacheConfig config;
+    std::vector<Line> lines;  // sets * ways
+    uint32_t line_shift;
+    uint32_t set_mask;
+    uint64_t clock = 0;
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+
+    uint32_t victim(Line const *set)
+    {
+        for (uint32_t w = 0; w < config.ways; ++w) {
+            if (!set[w].valid) {
+                return w;
+            }
+        }
+        if (config.replacement == REPLACE_RANDOM) {
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 7;
+            random_state ^= random_state << 17;
+            return random_state % config.ways;
+        }
+        uint32_t oldest = 0;
+        for (uint32_t w = 1; w < config.ways; ++w) {
+            if (set[w].stamp < set[oldest].stamp) {
+                oldest = w;
+            }
+        }
+        return oldest;
+    }
+
+public:
+    uint64_t reads = 0, writes = 0;
+    uint64_t read_misses = 0, write_misses = 0;
+    uint64_t fills = 0, writebacks = 0, write_throughs = 0;
+    uint64_t stall_cycles = 0;
+
+    explicit Cache(CacheConfig const &c)
+        : config(c),
+          lines(c.size / c.line, Line{0, false, false, 0}),
+          line_shift(__builtin_ctz(c.line)),
+          set_mask(c.size / (c.ways * c.line) - 1)
+    {
+    }
+
+    CacheConfig const &configuration() const { return config; }
+
+    void access(uint32_t address, bool write, Latency const &latency)
+    {
+        ++clock;
+        ++(write ? writes : reads);
+        uint32_t block = address >> line_shift;
+        uint32_t set_index = block & set_mask;
+        Line *set = &lines[size_t(set_index) * config.ways];
+        for (uint32_t w = 0; w < config.ways; ++w) {
+            Line &l = set[w];
+            if (l.valid && l.tag == block) {
+                if (config.replacement == REPLACE_LRU) {
+                    l.stamp = clock;
+                }
+                if (write) {
+                    if (config.write_back) {
+                        l.dirty = true;
+                    } else {
+                        ++write_throughs;
+                    }
+                }
+                stall_cycles += latency.hit;
+                return;
+            }
+        }
+
+        ++(write ? write_misses : read_misses);
+        if (write && !config.write_back) {
+            ++write_throughs;  // no allocation
+            return;
+        }
+        Line &l = set[victim(set)];
+        if (l.valid && l.dirty) {
+            ++writebacks;
+            stall_cycles += latency.writeback;
+        }
+        ++fills;
+        stall_cycles += latency.miss;
+        l = Line{block, true, write, clock};
+    }
+
+    uint64_t accesses() const { return reads + writes; }
+    uint64_t misses() const { return read_misses + write_misses; }
+    double hit_rate() const
+    {
+        return accesses() ? 100.0 * (accesses() - misses()) / accesses()
+                          : 100.0;
+    }
+};
+
+struct TraceResult
+{
+    std::string name;
+    uint64_t instructions = 0;
+    uint64_t data_accesses = 0;
+    uint64_t uncached = 0;
+    uint64_t cycles = 0;
+    std::vector<Cache> icaches;
+    std::vector<Cache> dcaches;
+
+    double base_cpi() const
+    {
+        return instructions ? double(cycles) / instructions : 0.0;
+    }
+    double added_cpi(Cache const &c) const
+    {
+        return instructions ? double(c.stall_cycles) / instructions : 0.0;
+    }
+};
+
+TraceResult replay(std::string const &filename,
+                   std::vector<CacheConfig> const &icache_configs,
+                   std::vector<CacheConfig> const &dcache_configs,
+                   Latency const &latency, uint32_t uncached_base)
+{
+    MappedFile file(filename);
+    rv32::MemTraceReader in(reinterpret_cast<uint8_t const *>(file.data()),
+                            file.size());
+    TraceResult r;
+    r.name = filename;
+    for (auto const &c : icache_configs) {
+        r.icaches.emplace_back(c);
+    }
+    for (auto const &c : dcache_configs) {
+        r.dcaches.emplace_back(c);
+    }
+
+    rv32::MemAccess a;
+    bool first = true;
+    uint64_t first_cycle = 0;
+    while (in.next(a)) {
+        if (first) {
+            first_cycle = a.cycle;
+            first = false;
+        }
+        r.cycles = a.cycle - first_cycle + 1;
+        if (a.kind == rv32::MEM_FETCH) {
+            ++r.instructions;
+            for (auto &cache : r.icaches) {
+                cache.access(a.address, false, latency);
+            }
+            continue;
+        }
+        ++r.data_accesses;
+        if (a.address >= uncached_base) {
+            ++r.uncached;
+            continue;
+        }
+        bool write = a.kind == rv32::MEM_STORE;
+        for (auto &cache : r.dcaches) {
+            cache.access(a.address, write, latency);
+        }
+    }
+    return r;
+}
+
+void print_table(TraceResult const &r)
+{
+    std::printf("\n%s: %lu instructions, %lu cycles (CPI %.3f), %lu data "
+                "accesses (%lu uncached)\n",
+                r.name.c_str(), (unsigned long) r.instructions,
+                (unsigned long) r.cycles, r.base_cpi(),
+                (unsigned long) r.data_accesses, (unsigned long) r.uncached);
+    std::printf("  %-2s %-24s %12s %10s %8s %10s %10s %8s %8s\n", "", "cache",
+                "accesses", "misses", "hit%", "fills", "writebacks", "+CPI",
+                "CPI");
+    auto row = [&](char const *side, Cache const &c) {
+        std::printf("  %-2s %-24s %12lu %10lu %7.2f%% %10lu %10lu %8.3f "
+                    "%8.3f\n",
+                    side, c.configuration().text.c_str(),
+                    (unsigned long) c.accesses(), (unsigned long) c.misses(),
+                    c.hit_rate(), (unsigned long) c.fills,
+                    (unsigned long) c.writebacks, r.added_cpi(c),
+                    r.base_cpi() + r.added_cpi(c));
+    };
+    for (auto const &c : r.icaches) {
+        row("I", c);
+    }
+    for (auto const &c : r.dcaches) {
+        row("D", c);
+    }
+}
+
+void print_csv(TraceResult const &r)
+{
+    auto row = [&](char const *side, Cache const &c) {
+        std::printf("%s,%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%.4f,%.4f\n",
+                    r.name.c_str(), side, c.configuration().text.c_str(),
+                    (unsigned long) r.instructions, (unsigned long) r.cycles,
+                    (unsigned long) c.accesses(), (unsigned long) c.misses(),
+                    (unsigned long) c.fills, (unsigned long) c.writebacks,
+                    r.base_cpi(), r.added_cpi(c));
+    };
+    for (auto const &c : r.icaches) {
+        row("I", c);
+    }
+    for (auto const &c : r.dcaches) {
+        row("D", c);
+    }
+}
+
+void usage()
+{
+    std::fprintf(
+        stderr,
+        "usage: cachesim [options] TRACE...\n"
+        "  -icache SIZE:WAYS:LINE[:REPL]        instruction cache "
+        "(repeatable)\n"
+        "  -dcache SIZE:WAYS:LINE[:REPL[:WRITE]] data cache (repeatable)\n"
+        "        REPL lru|fifo|random, WRITE wb|wt\n"
+        "  -hit-latency N        extra cycles per hit (0)\n"
+        "  -miss-penalty N       cycles per line fill (20)\n"
+        "  -writeback-penalty N  cycles per dirty eviction (20)\n"
+        "  -uncached ADDR        data accesses from ADDR up bypass the "
+        "D-cache (0x20000000)\n"
+        "  -csv                  trace,side,cache,instructions,cycles,"
+        "accesses,misses,\n"
+        "                        fills,writebacks,base_cpi,added_cpi\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::vector<CacheConfig> icache_configs, dcache_configs;
+    std::vector<std::string> traces;
+    Latency latency;
+    uint32_t uncached_base = 0x20000000;
+    bool csv = false;
+
+    try {
+        for (auto it = args.begin(); it != args.end(); ++it) {
+            bool has_value = std::next(it) != args.end();
+            if (*it == "-icache" && has_value) {
+                icache_configs.push_back(parse_config(*++it));
+            } else if (*it == "-dcache" && has_value) {
+                dcache_configs.push_back(parse_config(*++it));
+            } else if (*it == "-hit-latency" && has_value) {
+                latency.hit = std::stoull(*++it);
+            } else if (*it == "-miss-penalty" && has_value) {
+                latency.miss = std::stoull(*++it);
+            } else if (*it == "-writeback-penalty" && has_value) {
+                latency.writeback = std::stoull(*++it);
+            } else if (*it == "-uncached" && has_value) {
+                uncached_base = std::stoul(*++it, nullptr, 0);
+            } else if (*it == "-csv") {
+                csv = true;
+            } else if ((*it)[0] != '-') {
+                traces.push_back(*it);
+            } else {
+                usage();
+                return 2;
+            }
+        }
+        if (traces.empty() ||
+            (icache_configs.empty() && dcache_configs.empty())) {
+            usage();
+            return 2;
+        }
+
+        uint64_t records = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto const &trace : traces) {
+            TraceResult r = replay(trace, icache_configs, dcache_configs,
+                                   latency, uncached_base);
+            records += r.instructions + r.data_accesses;
+            if (csv) {
+                print_csv(r);
+            } else {
+                print_table(r);
+            }
+        }
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+        std::fprintf(stderr, "%lu accesses replayed in %.2f s\n",
+                     (unsigned long) records, seconds);
+    } catch (std::exception const &e) {
+        std::fprintf(stderr, "cachesim: %s\n", e.what());
+        return 2;
+    }
+    return 0;
+}
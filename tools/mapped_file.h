@@ -0,0 +1,55 @@
+// Read-only mapping of a whole file, for the streaming trace readers.
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class MappedFile
+{
+    int fd = -1;
+    void *base = MAP_FAILED;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(std::string const &filename)
+    {
+        fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error("Could not open " + filename);
+        }
+        length = st.st_size;
+        if (length) {
+            base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map " + filename);
+            }
+            madvise(base, length, MADV_SEQUENTIAL);
+        }
+    }
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+    ~MappedFile()
+    {
+        if (base != MAP_FAILED) {
+            munmap(base, length);
+        }
+        close(fd);
+    }
+    char const *data() const
+    {
+        return length ? static_cast<char const *>(base) : "";
+    }
+    size_t size() const { return length; }
+};
@@ -0,0 +1,1003 @@
+// vcdq: streaming query tool for VCD (and FST) waveforms.
+//
+// Reads a trace once and answers every query given on the command line:
+//
+//     -hist SIG       value histogram of SIG
+//     -changes SIG    number of value changes (and rising edges of 1-bit SIG)
+//     -count EXPR     number of samples where EXPR holds
+//     -first EXPR     time and sample of the first sample where EXPR holds
+//     -last EXPR      time and sample of the last sample where EXPR holds
+//     -ever EXPR      assertion: EXPR holds at some sample
+//     -always EXPR    assertion: EXPR holds at every sample
+//     -never EXPR     assertion: EXPR holds at no sample
+//     -atleast N EXPR assertion: EXPR holds at N samples or more
+//
+// EXPR is one or more comparisons "SIG OP VALUE" (OP one of == != < <= > >=,
+// VALUE decimal, 0x hex or 0b binary; a bare SIG means SIG != 0) joined with
+// && and ||, && binding tighter. A value with x or z bits compares false.
+// SIG is a full dotted name ("TOP.Top.cpu.io_instruction_address") or any
+// dotted suffix of one ("io_instruction_address", "regs.io_write_data");
+// when several signals match, the one closest to the top wins.
+//
+// Samples are taken just before every rising edge of -clock (default: the
+// topmost signal named "clock"), i.e. with the values registers see at the
+// edge, the way the harnesses sample the retirement port. -events samples
+// instead after every timestamp in which a queried signal changes. Values wider than 64 bits keep their low
+// 64 bits.
+//
+// The VCD is mapped into memory and tokenized in place; value changes are
+// decoded straight from the mapping and only signals used by a query are
+// tracked, so large traces are read at close to disk speed. FST traces are
+// read through GTKWave's fstapi when built with VCDQ_FST (see Makefile).
+//
+// Exit status: 0 when every assertion holds, 1 when one fails, 2 on errors.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+
+#ifdef VCDQ_FST
+#include "fstapi.h"
+#endif
+
+namespace
+{
+
+struct Value
+{
+    uint64_t bits = 0;
+    bool known = false;  // no x or z bits
+};
+
+// One declared variable; aliases share an id
+struct Var
+{
+    std::string name;  // dotted path from the top scope
+    std::string id;
+    uint32_t width;
+    int depth;
+    bool real;
+};
+
+enum Op { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE };
+
+struct Term
+{
+    uint32_t slot;
+    Op op;
+    uint64_t constant;
+};
+
+// Disjunction of conjunctions
+using Expr = std::vector<std::vector<Term>>;
+
+enum QueryKind {
+    Q_HIST,
+    Q_CHANGES,
+    Q_COUNT,
+    Q_FIRST,
+    Q_LAST,
+    Q_EVER,
+    Q_ALWAYS,
+    Q_NEVER,
+    Q_ATLEAST,
+};
+
+struct Query
+{
+    QueryKind kind;
+    std::string text;
+    Expr expr;
+    uint32_t slot = 0;  // -hist, -changes
+    uint64_t count = 0;
+    uint64_t threshold = 0;  // -atleast
+    bool hit = false;
+    uint64_t first_time = 0, first_sample = 0;
+    uint64_t last_time = 0, last_sample = 0;
+    std::unordered_map<uint64_t, uint64_t> histogram;
+    uint64_t unknown = 0;  // -hist samples with x/z bits
+};
+
+// A tracked signal: one per distinct id used by a query
+struct Slot
+{
+    std::string name;
+    std::string id;
+    uint32_t width;
+    Value value;
+    bool dumped = false;  // has had a value ($dumpvars)
+    uint64_t changes = 0;
+    uint64_t rises = 0;
+};
+
+uint64_t parse_constant(std::string const &text)
+{
+    size_t used = 0;
+    uint64_t value;
+    if (text.size() > 2 && text[0] == '0' &&
+        (text[1] == 'b' || text[1] == 'B')) {
+        value = std::stoull(text.substr(2), &used, 2);
+        used += 2;
+    } else {
+        value = std::stoull(text, &used, 0);
+    }
+    if (used != text.size()) {
+        throw std::runtime_error("bad number '" + text + "'");
+    }
+    return value;
+}
+
+class Analyzer
+{
+    std::vector<Var> vars;
+    std::vector<Query> queries;
+    std::vector<Slot> slots;
+    std::string clock_name;
+    bool events = false;
+    int clock_slot = -1;
+
+    // id -> slot: ids of up to nine characters map to a base-95 code, looked
+    // up in a flat table when the codes are small (they are for Verilator)
+    std::vector<int32_t> dense;
+    std::unordered_map<uint64_t, uint32_t> sparse;
+    std::unordered_map<std::string, uint32_t> long_ids;
+
+    struct Change
+    {
+        uint32_t slot;
+        Value value;
+    };
+    std::vector<Change> pending;  // changes of the current timestamp
+    bool clock_rises = false;
+    bool have_time = false;
+    uint64_t time = 0;
+    uint64_t timestamps = 0;
+    uint64_t samples = 0;
+    uint64_t end_time = 0;
+
+    static bool id_code(std::string_view id, uint64_t &code)
+    {
+        if (id.empty() || id.size() > 9) {
+            return false;
+        }
+        code = 0;
+        for (size_t i = id.size(); i-- > 0;) {
+            code = code * 95 + uint64_t(uint8_t(id[i]) - 32);
+        }
+        return true;
+    }
+
+    // Signal named by a query: exact name or dotted suffix, shallowest wins
+    Var const &find_var(std::string const &name) const
+    {
+        Var const *best = nullptr;
+        bool ambiguous = false;
+        for (auto const &var : vars) {
+            bool match = var.name == name;
+            if (!match && var.name.size() > name.size()) {
+                size_t at = var.name.size() - name.size();
+                match = var.name[at - 1] == '.' &&
+                        var.name.compare(at, name.size(), name) == 0;
+            }
+            if (!match) {
+                continue;
+            }
+            if (!best || var.depth < best->depth) {
+                best = &var;
+                ambiguous = false;
+            } else if (var.depth == best->depth && var.id != best->id) {
+                ambiguous = true;
+            }
+        }
+        if (!best) {
+            throw std::runtime_error("no signal named '" + name + "'");
+        }
+        if (ambiguous) {
+            throw std::runtime_error("signal name '" + name +
+                                     "' is ambiguous; use a longer path");
+        }
+        if (best->real) {
+            throw std::runtime_error("signal '" + name +
+                                     "' is not a bit vector");
+        }
+        return *best;
+    }
+
+    uint32_t track(std::string const &name)
+    {
+        Var const &var = find_var(name);
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].id == var.id) {
+                return i;
+            }
+        }
+        slots.push_back({var.name, var.id, var.width, Value{}});
+        return slots.size() - 1;
+    }
+
+    Expr compile(std::string const &text)
+    {
+        // Tokens: names, numbers and operators; whitespace separates
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < text.size();) {
+            char c = text[i];
+            if (c == ' ' || c == '\t') {
+                ++i;
+            } else if (std::strchr("=!<>&|", c)) {
+                size_t n = (i + 1 < text.size() &&
+                            std::strchr("=&|", text[i + 1]))
+                               ? 2
+                               : 1;
+                tokens.push_back(text.substr(i, n));
+                i += n;
+            } else {
+                size_t j = i;
+                while (j < text.size() &&
+                       !std::strchr(" \t=!<>&|", text[j])) {
+                    ++j;
+                }
+                tokens.push_back(text.substr(i, j - i));
+                i = j;
+            }
+        }
+
+        Expr expr(1);
+        size_t i = 0;
+        auto error = [&] {
+            return std::runtime_error("cannot parse expression '" + text +
+                                      "'");
+        };
+        while (true) {
+            if (i >= tokens.size()) {
+                throw error();
+            }
+            Term term{0, OP_NE, 0};
+            if (tokens[i] == "!") {
+                term.op = OP_EQ;
+                ++i;
+                if (i >= tokens.size()) {
+                    throw error();
+                }
+                term.slot = track(tokens[i++]);
+            } else {
+                term.slot = track(tokens[i++]);
+                static char const *const ops[] = {"==", "!=", "<",
+                                                  "<=", ">",  ">="};
+                if (i < tokens.size() && tokens[i] != "&&" &&
+                    tokens[i] != "||") {
+                    auto op = std::find(std::begin(ops), std::end(ops),
+                                        std::string_view(tokens[i]));
+                    if (op == std::end(ops) || i + 1 >= tokens.size()) {
+                        throw error();
+                    }
+                    term.op = Op(op - std::begin(ops));
+                    term.constant = parse_constant(tokens[i + 1]);
+                    i += 2;
+                }
+            }
+            expr.back().push_back(term);
+            if (i == tokens.size()) {
+                return expr;
+            }
+            if (tokens[i] == "||") {
+                expr.emplace_back();
+            } else if (tokens[i] != "&&") {
+                throw error();
+            }
+            ++i;
+        }
+    }
+
+    bool evaluate(Expr const &expr) const
+    {
+        for (auto const &conjunction : expr) {
+            bool holds = true;
+            for (auto const &term : conjunction) {
+                Value const &v = slots[term.slot].value;
+                bool ok = v.known;
+                switch (term.op) {
+                case OP_EQ:
+                    ok = ok && v.bits == term.constant;
+                    break;
+                case OP_NE:
+                    ok = ok && v.bits != term.constant;
+                    break;
+                case OP_LT:
+                    ok = ok && v.bits < term.constant;
+                    break;
+                case OP_LE:
+                    ok = ok && v.bits <= term.constant;
+                    break;
+                case OP_GT:
+                    ok = ok && v.bits > term.constant;
+                    break;
+                case OP_GE:
+                    ok = ok && v.bits >= term.constant;
+                    break;
+                }
+                if (!ok) {
+                    holds = false;
+                    break;
+                }
+            }
+            if (holds) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Evaluate every query on the current values
+    void sample()
+    {
+        for (auto &q : queries) {
+            bool holds;
+            switch (q.kind) {
+            case Q_HIST: {
+                Value const &v = slots[q.slot].value;
+                if (v.known) {
+                    ++q.histogram[v.bits];
+                } else {
+                    ++q.unknown;
+                }
+                continue;
+            }
+            case Q_CHANGES:
+                continue;
+            case Q_ALWAYS:
+                holds = !evaluate(q.expr);
+                break;
+            default:
+                holds = evaluate(q.expr);
+                break;
+            }
+            if (!holds) {
+                continue;
+            }
+            ++q.count;
+            if (!q.hit) {
+                q.hit = true;
+                q.first_time = time;
+                q.first_sample = samples;
+            }
+            q.last_time = time;
+            q.last_sample = samples;
+        }
+        ++samples;
+    }
+
+    // Close the current timestamp: sample before a rising clock edge, then
+    // apply its changes
+    void commit()
+    {
+        if (!have_time) {
+            return;
+        }
+        if (clock_rises) {
+            sample();
+            clock_rises = false;
+        }
+        for (auto const &c : pending) {
+            Slot &s = slots[c.slot];
+            if (!s.dumped) {
+                s.value = c.value;
+                s.dumped = true;
+                continue;
+            }
+            if (s.value.known == c.value.known &&
+                s.value.bits == c.value.bits) {
+                continue;
+            }
+            ++s.changes;
+            if (s.value.known && s.value.bits == 0 && c.value.known &&
+                c.value.bits == 1) {
+                ++s.rises;
+            }
+            s.value = c.value;
+        }
+        if (events && !pending.empty()) {
+            sample();
+        }
+        pending.clear();
+    }
+
+public:
+    void set_clock(std::string const &name) { clock_name = name; }
+    void set_events() { events = true; }
+
+    void add_query(QueryKind kind, std::string const &text,
+                   uint64_t threshold = 0)
+    {
+        Query q;
+        q.kind = kind;
+        q.text = text;
+        q.threshold = threshold;
+        queries.push_back(std::move(q));
+    }
+
+    void add_var(std::string name, std::string id, uint32_t width, int depth,
+                 bool real)
+    {
+        vars.push_back(Var{std::move(name), std::move(id), width, depth, real});
+    }
+
+    std::vector<Var> const &variables() const { return vars; }
+
+    // After the declarations: bind queries to signals and pick the clock
+    void resolve()
+    {
+        for (auto &q : queries) {
+            if (q.kind == Q_HIST || q.kind == Q_CHANGES) {
+                q.slot = track(q.text);
+            } else {
+                q.expr = compile(q.text);
+            }
+        }
+        if (!events) {
+            if (clock_name.empty()) {
+                bool found = std::any_of(
+                    vars.begin(), vars.end(), [](Var const &var) {
+                        return var.name == "clock" ||
+                               (var.name.size() > 6 &&
+                                var.name.compare(var.name.size() - 6, 6,
+                                                 ".clock") == 0);
+                    });
+                if (found) {
+                    clock_name = "clock";
+                } else {
+                    events = true;
+                }
+            }
+            if (!events) {
+                clock_slot = track(clock_name);
+            }
+        }
+
+        uint64_t max_code = 0;
+        bool all_short = true;
+        for (auto const &s : slots) {
+            uint64_t code;
+            if (id_code(s.id, code)) {
+                max_code = std::max(max_code, code);
+            } else {
+                all_short = false;
+            }
+        }
+        bool use_dense = all_short && max_code < (1u << 22);
+        if (use_dense) {
+            dense.assign(max_code + 1, -1);
+        }
+        for (size_t i = 0; i < slots.size(); ++i) {
+            uint64_t code;
+            if (!id_code(slots[i].id, code)) {
+                long_ids[slots[i].id] = i;
+            } else if (use_dense) {
+                dense[code] = i;
+            } else {
+                sparse[code] = i;
+            }
+        }
+        pending.reserve(slots.size() * 2);
+    }
+
+    bool tracking() const { return !slots.empty(); }
+
+    // Slot of an id, or -1 when no query uses it
+    int lookup(std::string_view id) const
+    {
+        uint64_t code;
+        if (!id_code(id, code)) {
+            auto it = long_ids.find(std::string(id));
+            return it == long_ids.end() ? -1 : int(it->second);
+        }
+        if (!dense.empty() || sparse.empty()) {
+            return code < dense.size() ? dense[code] : -1;
+        }
+        auto it = sparse.find(code);
+        return it == sparse.end() ? -1 : int(it->second);
+    }
+
+    void at(uint64_t t)
+    {
+        if (have_time && t == time) {
+            return;
+        }
+        commit();
+        have_time = true;
+        time = t;
+        ++timestamps;
+    }
+
+    void change(uint32_t slot, Value value)
+    {
+        if (int(slot) == clock_slot && value.known && value.bits == 1 &&
+            !(slots[slot].value.known && slots[slot].value.bits == 1)) {
+            clock_rises = true;
+        }
+        pending.push_back({slot, value});
+    }
+
+    void finish(uint64_t last_time)
+    {
+        commit();
+        end_time = std::max(time, last_time);
+    }
+
+    // Print the results; false when an assertion failed
+    bool report(std::FILE *out) const
+    {
+        bool ok = true;
+        if (events) {
+            std::fprintf(out, "%lu samples (every timestamp), ",
+                         (unsigned long) samples);
+        } else {
+            std::fprintf(out, "%lu samples (rising edges of %s), ",
+                         (unsigned long) samples,
+                         slots[clock_slot].name.c_str());
+        }
+        std::fprintf(out, "%lu timestamps, end time %lu\n",
+                     (unsigned long) timestamps, (unsigned long) end_time);
+
+        for (auto const &q : queries) {
+            Slot const *s = q.kind == Q_HIST || q.kind == Q_CHANGES
+                                ? &slots[q.slot]
+                                : nullptr;
+            switch (q.kind) {
+            case Q_HIST: {
+                std::vector<std::pair<uint64_t, uint64_t>> rows(
+                    q.histogram.begin(), q.histogram.end());
+                std::sort(rows.begin(), rows.end(),
+                          [](auto const &a, auto const &b) {
+                              return a.second != b.second ? a.second > b.second
+                                                          : a.first < b.first;
+                          });
+                std::fprintf(out, "hist    %s: %zu distinct values\n",
+                             s->name.c_str(), rows.size());
+                int digits = std::max(1, int(std::min(s->width, 64u) + 3) / 4);
+                for (size_t i = 0; i < rows.size() && i < 16; ++i) {
+                    std::fprintf(out, "          0x%0*lx %12lu %6.2f%%\n",
+                                 digits, (unsigned long) rows[i].first,
+                                 (unsigned long) rows[i].second,
+                                 samples ? 100.0 * rows[i].second / samples
+                                         : 0.0);
+                }
+                if (rows.size() > 16) {
+                    std::fprintf(out, "          ... %zu more\n",
+                                 rows.size() - 16);
+                }
+                if (q.unknown) {
+                    std::fprintf(out, "          %*s %12lu %6.2f%%\n",
+                                 digits + 2, "x", (unsigned long) q.unknown,
+                                 samples ? 100.0 * q.unknown / samples : 0.0);
+                }
+                break;
+            }
+            case Q_CHANGES:
+                std::fprintf(out, "changes %s: %lu", s->name.c_str(),
+                             (unsigned long) s->changes);
+                if (s->width == 1) {
+                    std::fprintf(out, " (%lu rising)",
+                                 (unsigned long) s->rises);
+                }
+                std::fprintf(out, "\n");
+                break;
+            case Q_COUNT:
+                std::fprintf(out, "count   %s: %lu of %lu samples\n",
+                             q.text.c_str(), (unsigned long) q.count,
+                             (unsigned long) samples);
+                break;
+            case Q_FIRST:
+            case Q_LAST:
+                std::fprintf(out, "%-7s %s: ",
+                             q.kind == Q_FIRST ? "first" : "last",
+                             q.text.c_str());
+                if (!q.hit) {
+                    std::fprintf(out, "never\n");
+                } else {
+                    std::fprintf(
+                        out, "time %lu, sample %lu\n",
+                        (unsigned long) (q.kind == Q_FIRST ? q.first_time
+                                                           : q.last_time),
+                        (unsigned long) (q.kind == Q_FIRST ? q.first_sample
+                                                           : q.last_sample));
+                }
+                break;
+            case Q_EVER:
+                ok &= q.hit;
+                std::fprintf(out, "ever    %s: ", q.text.c_str());
+                if (q.hit) {
+                    std::fprintf(out, "PASS (first at time %lu, sample %lu)\n",
+                                 (unsigned long) q.first_time,
+                                 (unsigned long) q.first_sample);
+                } else {
+                    std::fprintf(out, "FAIL\n");
+                }
+                break;
+            case Q_ALWAYS:
+            case Q_NEVER:
+                ok &= !q.hit;
+                std::fprintf(out, "%-7s %s: ",
+                             q.kind == Q_ALWAYS ? "always" : "never",
+                             q.text.c_str());
+                if (!q.hit) {
+                    std::fprintf(out, "PASS\n");
+                } else {
+                    std::fprintf(out,
+                                 "FAIL (%lu samples, first at time %lu, "
+                                 "sample %lu)\n",
+                                 (unsigned long) q.count,
+                                 (unsigned long) q.first_time,
+                                 (unsigned long) q.first_sample);
+                }
+                break;
+            case Q_ATLEAST:
+                ok &= q.count >= q.threshold;
+                std::fprintf(out, "atleast %lu %s: %s (%lu of %lu samples)\n",
+                             (unsigned long) q.threshold, q.text.c_str(),
+                             q.count >= q.threshold ? "PASS" : "FAIL",
+                             (unsigned long) q.count,
+                             (unsigned long) samples);
+                break;
+            }
+        }
+        return ok;
+    }
+};
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// In-place tokenizer over the mapping; tokens are views, nothing is copied
+class Tokenizer
+{
+    char const *p;
+    char const *end;
+
+public:
+    Tokenizer(char const *data, size_t size) : p(data), end(data + size) {}
+
+    bool next(std::string_view &token)
+    {
+        while (p < end && is_space(*p)) {
+            ++p;
+        }
+        if (p == end) {
+            return false;
+        }
+        char const *start = p;
+        while (p < end && !is_space(*p)) {
+            ++p;
+        }
+        token = std::string_view(start, p - start);
+        return true;
+    }
+
+    // Skip to just after the next "$end"
+    void skip_section()
+    {
+        std::string_view token;
+        while (next(token) && token != "$end") {
+        }
+    }
+};
+
+// Bits of a VCD value ("0101", "x", "1z0") as a Value
+inline Value parse_bits(std::string_view bits)
+{
+    Value v{0, true};
+    for (char c : bits) {
+        v.bits = (v.bits << 1) | uint64_t(c == '1');
+        v.known &= c == '0' || c == '1';
+    }
+    return v;
+}
+
+uint64_t read_vcd(std::string const &filename, Analyzer &analyzer)
+{
+    MappedFile file(filename);
+    Tokenizer in(file.data(), file.size());
+    std::string_view token;
+    std::vector<std::string> scopes;
+
+    // Declarations
+    bool declarations = true;
+    while (declarations && in.next(token)) {
+        if (token == "$scope") {
+            std::string_view type, name;
+            in.next(type);
+            in.next(name);
+            scopes.emplace_back(name);
+            in.skip_section();
+        } else if (token == "$upscope") {
+            if (!scopes.empty()) {
+                scopes.pop_back();
+            }
+            in.skip_section();
+        } else if (token == "$var") {
+            std::string_view type, width, id, reference;
+            in.next(type);
+            in.next(width);
+            in.next(id);
+            in.next(reference);
+            std::string name;
+            for (auto const &scope : scopes) {
+                name += scope;
+                name += '.';
+            }
+            // "name[7:0]" or "name [7:0]": the bit range is not part of it
+            name += reference.substr(0, reference.find('['));
+            analyzer.add_var(name, std::string(id),
+                             std::stoul(std::string(width)), scopes.size(),
+                             type == "real" || type == "realtime");
+            in.skip_section();
+        } else if (token == "$enddefinitions") {
+            in.skip_section();
+            declarations = false;
+        } else if (token[0] == '$' && token != "$end") {
+            in.skip_section();
+        }
+    }
+    analyzer.resolve();
+    if (!analyzer.tracking()) {
+        return 0;
+    }
+
+    // Value changes
+    uint64_t time = 0;
+    while (in.next(token)) {
+        char c = token[0];
+        switch (c) {
+        case '#':
+            time = std::strtoull(std::string(token.substr(1)).c_str(),
+                                 nullptr, 10);
+            analyzer.at(time);
+            break;
+        case '0':
+        case '1':
+        case 'x':
+        case 'X':
+        case 'z':
+        case 'Z':
+            if (int slot = analyzer.lookup(token.substr(1)); slot >= 0) {
+                analyzer.change(slot, Value{uint64_t(c == '1'),
+                                            c == '0' || c == '1'});
+            }
+            break;
+        case 'b':
+        case 'B': {
+            std::string_view id;
+            if (!in.next(id)) {
+                break;
+            }
+            if (int slot = analyzer.lookup(id); slot >= 0) {
+                analyzer.change(slot, parse_bits(token.substr(1)));
+            }
+            break;
+        }
+        case 'r':
+        case 'R':
+        case 's':
+        case 'S':
+            in.next(token);  // id of a real or string change
+            break;
+        default:
+            if (token == "$comment") {
+                in.skip_section();
+            }
+            // $dumpvars, $dumpon, $end, ... only bracket value changes
+            break;
+        }
+    }
+    return time;
+}
+
+#ifdef VCDQ_FST
+struct FstContext
+{
+    Analyzer *analyzer;
+    std::vector<int32_t> slots;  // fstHandle -> slot
+    std::vector<uint32_t> widths;
+};
+
+void fst_change(void *user, uint64_t time, fstHandle handle,
+                unsigned char const *value)
+{
+    auto *ctx = static_cast<FstContext *>(user);
+    int slot = handle < ctx->slots.size() ? ctx->slots[handle] : -1;
+    if (slot < 0) {
+        return;
+    }
+    ctx->analyzer->at(time);
+    ctx->analyzer->change(
+        slot, parse_bits(std::string_view(reinterpret_cast<char const *>(value),
+                                          ctx->widths[handle])));
+}
+
+uint64_t read_fst(std::string const &filename, Analyzer &analyzer)
+{
+    void *fst = fstReaderOpen(filename.c_str());
+    if (!fst) {
+        throw std::runtime_error("Could not open FST " + filename);
+    }
+    std::vector<std::string> scopes;
+    FstContext ctx{&analyzer, {}, {}};
+    fstReaderIterateHierRewind(fst);
+    while (fstHier *h = fstReaderIterateHier(fst)) {
+        switch (h->htyp) {
+        case FST_HT_SCOPE:
+            scopes.emplace_back(h->u.scope.name);
+            break;
+        case FST_HT_UPSCOPE:
+            if (!scopes.empty()) {
+                scopes.pop_back();
+            }
+            break;
+        case FST_HT_VAR: {
+            std::string name;
+            for (auto const &scope : scopes) {
+                name += scope;
+                name += '.';
+            }
+            std::string reference = h->u.var.name;
+            name += reference.substr(0, reference.find_first_of(" ["));
+            fstHandle handle = h->u.var.handle;
+            bool real = h->u.var.typ == FST_VT_VCD_REAL ||
+                        h->u.var.typ == FST_VT_VCD_REAL_PARAMETER ||
+                        h->u.var.typ == FST_VT_VCD_REALTIME ||
+                        h->u.var.typ == FST_VT_SV_SHORTREAL ||
+                        h->u.var.typ == FST_VT_GEN_STRING;
+            analyzer.add_var(name, std::to_string(handle), h->u.var.length,
+                             scopes.size(), real);
+            if (ctx.widths.size() <= handle) {
+                ctx.widths.resize(handle + 1, 0);
+            }
+            ctx.widths[handle] = h->u.var.length;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    analyzer.resolve();
+
+    ctx.slots.assign(ctx.widths.size(), -1);
+    fstReaderClrFacProcessMaskAll(fst);
+    for (fstHandle handle = 1; handle < ctx.widths.size(); ++handle) {
+        int slot = analyzer.lookup(std::to_string(handle));
+        if (slot >= 0) {
+            ctx.slots[handle] = slot;
+            fstReaderSetFacProcessMask(fst, handle);
+        }
+    }
+    if (analyzer.tracking()) {
+        fstReaderIterBlocks(fst, fst_change, &ctx, nullptr);
+    }
+    uint64_t end_time = fstReaderGetEndTime(fst);
+    fstReaderClose(fst);
+    return end_time;
+}
+#endif
+
+bool ends_with(std::string const &s, char const *suffix)
+{
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+void usage()
+{
+    std::fprintf(
+        stderr,
+        "usage: vcdq [options] TRACE.vcd|TRACE.fst\n"
+        "  -hist SIG       value histogram\n"
+        "  -changes SIG    number of value changes\n"
+        "  -count EXPR     samples where EXPR holds\n"
+        "  -first EXPR     first sample where EXPR holds\n"
+        "  -last EXPR      last sample where EXPR holds\n"
+        "  -ever EXPR      assert EXPR holds at some sample\n"
+        "  -always EXPR    assert EXPR holds at every sample\n"
+        "  -never EXPR     assert EXPR holds at no sample\n"
+        "  -atleast N EXPR assert EXPR holds at N samples or more\n"
+        "  -clock SIG      sample before rising edges of SIG (default clock)\n"
+        "  -events         sample after every change instead\n"
+        "  -list           list the signals in the trace\n"
+        "EXPR: SIG [OP VALUE] joined with && and ||; OP: == != < <= > >=\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    Analyzer analyzer;
+    std::string filename;
+    bool list = false;
+
+    static struct
+    {
+        char const *flag;
+        QueryKind kind;
+    } const query_flags[] = {
+        {"-hist", Q_HIST},   {"-changes", Q_CHANGES}, {"-count", Q_COUNT},
+        {"-first", Q_FIRST}, {"-last", Q_LAST},       {"-ever", Q_EVER},
+        {"-always", Q_ALWAYS}, {"-never", Q_NEVER},
+    };
+
+    for (auto it = args.begin(); it != args.end(); ++it) {
+        auto query = std::find_if(
+            std::begin(query_flags), std::end(query_flags),
+            [&](auto const &q) { return *it == q.flag; });
+        if (query != std::end(query_flags) && std::next(it) != args.end()) {
+            analyzer.add_query(query->kind, *++it);
+        } else if (*it == "-atleast" && args.end() - it > 2) {
+            uint64_t threshold;
+            try {
+                threshold = parse_constant(*++it);
+            } catch (std::exception const &) {
+                usage();
+                return 2;
+            }
+            analyzer.add_query(Q_ATLEAST, *++it, threshold);
+        } else if (*it == "-clock" && std::next(it) != args.end()) {
+            analyzer.set_clock(*++it);
+        } else if (*it == "-events") {
+            analyzer.set_events();
+        } else if (*it == "-list") {
+            list = true;
+            analyzer.set_events();
+        } else if ((*it)[0] != '-' && filename.empty()) {
+            filename = *it;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (filename.empty()) {
+        usage();
+        return 2;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t end_time;
+        if (ends_with(filename, ".fst")) {
+#ifdef VCDQ_FST
+            end_time = read_fst(filename, analyzer);
+#else
+            throw std::runtime_error(
+                "built without FST support (see tools/Makefile)");
+#endif
+        } else {
+            end_time = read_vcd(filename, analyzer);
+        }
+        analyzer.finish(end_time);
+
+        if (list) {
+            for (auto const &var : analyzer.variables()) {
+                std::printf("%-60s %4u  %s\n", var.name.c_str(), var.width,
+                            var.id.c_str());
+            }
+            return 0;
+        }
+        bool ok = analyzer.report(stdout);
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+        std::fprintf(stderr, "%s read in %.2f s\n", filename.c_str(), seconds);
+        return ok ? 0 : 1;
+    } catch (std::exception const &e) {
+        std::fprintf(stderr, "vcdq: %s\n", e.what());
+        return 2;
+    }
+}